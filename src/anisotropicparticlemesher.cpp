@@ -46,7 +46,7 @@ void AnisotropicParticleMesher::setNumPolygonizationSlices(int n) {
     _numPolygonizationSlices = n;
 }
 
-TriangleMesh AnisotropicParticleMesher::meshParticles(FragmentedVector<MarkerParticle> &particles, 
+TriangleMesh AnisotropicParticleMesher::meshParticles(MarkerParticleVector &particles, 
                                                       LevelSet &levelset,
                                                       FluidMaterialGrid &materialGrid,
                                                       double particleRadius) {
@@ -70,7 +70,7 @@ TriangleMesh AnisotropicParticleMesher::meshParticles(FragmentedVector<MarkerPar
     return _polygonizeSlices(filteredParticles, levelset, materialGrid);
 }
 
-void AnisotropicParticleMesher::_filterHighDensityParticles(FragmentedVector<MarkerParticle> &particles,
+void AnisotropicParticleMesher::_filterHighDensityParticles(MarkerParticleVector &particles,
                                                             FragmentedVector<vmath::vec3> &filtered) {
     filtered.reserve(particles.size());
 
@@ -79,7 +79,7 @@ void AnisotropicParticleMesher::_filterHighDensityParticles(FragmentedVector<Mar
     vmath::vec3 p;
     GridIndex g;
     for (unsigned int i = 0; i < particles.size(); i++) {
-        p = particles[i].position;
+        p = particles.getPosition(i);
         g = Grid3d::positionToGridIndex(p, _dx);
 
         if (countGrid(g) >= _maxParticlesPerCell) {
@@ -87,7 +87,7 @@ void AnisotropicParticleMesher::_filterHighDensityParticles(FragmentedVector<Mar
         }
         countGrid.add(g, 1);
 
-        filtered.push_back(particles[i].position);
+        filtered.push_back(particles.getPosition(i));
     }
 
 }
@@ -98,6 +98,8 @@ void AnisotropicParticleMesher::_clear() {
     _farSurfaceParticleRefs.clear();
     _pointGrid = SpatialPointGrid();
     _smoothedPositions.clear();
+    _releaseNearSurfaceParticleNeighbours();
+    _anisotropicParticles.clear();
 }
 
 void AnisotropicParticleMesher::_initializeSurfaceParticles(FragmentedVector<vmath::vec3> &particles, 
@@ -204,6 +206,14 @@ void AnisotropicParticleMesher::_smoothSurfaceParticlePositions() {
     _smoothedPositions.shrink_to_fit();
 }
 
+/*
+    Positions are smoothed in chunks of _anisotropicParticleChunkSize near 
+    surface particles. The neighbour lists of a chunk are released before 
+    the next chunk is processed. If every near surface particle fits in a 
+    single chunk, the neighbour lists are kept and shared with the 
+    anisotropic kernel computation. Both use the spatial grid positions, 
+    which are not moved by smoothing.
+*/
 void AnisotropicParticleMesher::_computeSmoothedNearSurfaceParticlePositions() {
     
     double supportRadius = _supportRadiusFactor*_particleRadius;
@@ -211,27 +221,67 @@ void AnisotropicParticleMesher::_computeSmoothedNearSurfaceParticlePositions() {
 
     int numElements = _nearSurfaceParticleRefs.size();
     _smoothedPositions = FragmentedVector<vmath::vec3>(numElements);
-    
-    _smoothRangeOfSurfaceParticlePositions(0, _nearSurfaceParticleRefs.size() - 1);
+    if (numElements == 0) {
+        return;
+    }
+
+    int n = _anisotropicParticleChunkSize;
+    std::vector<GridPointReference> chunkRefs;
+    for (int chunkidx = 0; chunkidx < numElements; chunkidx += n) {
+        int chunkSize = (int)fmin(n, numElements - chunkidx);
+
+        chunkRefs.clear();
+        for (int i = 0; i < chunkSize; i++) {
+            chunkRefs.push_back(_nearSurfaceParticleRefs[chunkidx + i]);
+        }
+        _findNearSurfaceParticleNeighbours(chunkRefs);
+
+        int numthreads = _getNumThreads(chunkSize);
+        std::vector<std::thread> threads(numthreads);
+        std::vector<int> intervals = ThreadUtils::splitRangeIntoIntervals(0, chunkSize, numthreads);
+        for (int i = 0; i < numthreads; i++) {
+            threads[i] = std::thread(&AnisotropicParticleMesher::_smoothRangeOfSurfaceParticlePositions, this,
+                                     chunkidx, intervals[i], intervals[i + 1] - 1);
+        }
+        for (int i = 0; i < numthreads; i++) {
+            threads[i].join();
+        }
+    }
+
+    _isNearSurfaceNeighbourListComplete = numElements <= n;
+    if (!_isNearSurfaceNeighbourListComplete) {
+        _releaseNearSurfaceParticleNeighbours();
+    }
 }
 
-void AnisotropicParticleMesher::_smoothRangeOfSurfaceParticlePositions(int startidx, int endidx) {
-    std::vector<GridPointReference> neighbourRefs;
-    GridPointReference ref;
-    vmath::vec3 newp;
+void AnisotropicParticleMesher::_findNearSurfaceParticleNeighbours(std::vector<GridPointReference> &refs) {
+    _pointGrid.queryPointReferencesInsideSphere(refs, _kernelRadius,
+                                                _nearSurfaceNeighbourOffsets, 
+                                                _nearSurfaceNeighbours);
+}
+
+void AnisotropicParticleMesher::_releaseNearSurfaceParticleNeighbours() {
+    std::vector<int>().swap(_nearSurfaceNeighbourOffsets);
+    std::vector<GridPointReference>().swap(_nearSurfaceNeighbours);
+    _isNearSurfaceNeighbourListComplete = false;
+}
+
+/*
+    Smooths near surface particles chunkidx + startidx to chunkidx + endidx,
+    whose neighbour lists are entries startidx to endidx.
+*/
+void AnisotropicParticleMesher::_smoothRangeOfSurfaceParticlePositions(int chunkidx, 
+                                                                       int startidx, int endidx) {
     for (int i = startidx; i <= endidx; i++) {
-        ref = _nearSurfaceParticleRefs[i];
-        newp = _getSmoothedParticlePosition(ref, _kernelRadius, neighbourRefs);
-        _smoothedPositions[i] = newp;
+        _smoothedPositions[chunkidx + i] = _getSmoothedParticlePosition(chunkidx + i, i);
     }
 }
 
-vmath::vec3 AnisotropicParticleMesher::_getSmoothedParticlePosition(GridPointReference ref,
-                                                                    double radius,
-                                                                    std::vector<GridPointReference> &neighbourRefs) {
-    neighbourRefs.clear();
-    _pointGrid.queryPointReferencesInsideSphere(ref, radius, neighbourRefs);
-    vmath::vec3 mean = _getWeightedMeanParticlePosition(ref, neighbourRefs);
+vmath::vec3 AnisotropicParticleMesher::_getSmoothedParticlePosition(int nearidx, int neighbouridx) {
+    GridPointReference ref = _nearSurfaceParticleRefs[nearidx];
+    vmath::vec3 mean = _getWeightedMeanParticlePosition(ref, 
+                                                        _nearSurfaceNeighbourOffsets[neighbouridx],
+                                                        _nearSurfaceNeighbourOffsets[neighbouridx + 1]);
 
     SurfaceParticle spi = _surfaceParticles[ref.id]; 
     float k = (float)_smoothingConstant;
@@ -239,7 +289,8 @@ vmath::vec3 AnisotropicParticleMesher::_getSmoothedParticlePosition(GridPointRef
 }
 
 vmath::vec3 AnisotropicParticleMesher::_getWeightedMeanParticlePosition(GridPointReference ref,
-                                                                        std::vector<GridPointReference> &neighbours) {
+                                                                        int neighbourStart, 
+                                                                        int neighbourEnd) {
     SurfaceParticle spi = _surfaceParticles[ref.id]; 
     SurfaceParticle spj;
 
@@ -252,8 +303,8 @@ vmath::vec3 AnisotropicParticleMesher::_getWeightedMeanParticlePosition(GridPoin
 
     GridPointReference refj;
     double eps = 1e-9;
-    for (unsigned int i = 0; i < neighbours.size(); i++) {
-        refj = neighbours[i];
+    for (int i = neighbourStart; i < neighbourEnd; i++) {
+        refj = _nearSurfaceNeighbours[i];
         spj = _surfaceParticles[refj.id];
 
         kernalVal = _evaluateKernel(spi, spj);
@@ -270,12 +321,19 @@ vmath::vec3 AnisotropicParticleMesher::_getWeightedMeanParticlePosition(GridPoin
     return vmath::vec3(xsum, ysum, zsum) / (float)weightSum;
 }
 
+int AnisotropicParticleMesher::_getNumThreads(int numElements) {
+    int numthreads = (int)fmin(ThreadUtils::getMaxThreadCount(), 
+                               ceil((double)numElements / (double)_minParticlesPerThread));
+    return (int)fmax(numthreads, 1);
+}
+
 TriangleMesh AnisotropicParticleMesher::_polygonizeAll(FragmentedVector<vmath::vec3> &particles, 
                                                        LevelSet &levelset,
                                                        FluidMaterialGrid &materialGrid) {
-    _computeScalarField(materialGrid, particles, levelset);
+    _initializeScalarField(materialGrid);
    
     Polygonizer3d polygonizer = Polygonizer3d(&_scalarField);
+    _computeScalarField(particles, levelset, polygonizer);
     polygonizer.polygonizeSurface();
 
     return polygonizer.getTriangleMesh();
@@ -298,6 +356,8 @@ TriangleMesh AnisotropicParticleMesher::_polygonizeSlices(FragmentedVector<vmath
         return _polygonizeAll(particles, levelset, materialGrid);
     }
 
+    _initializeSliceAnisotropicParticles();
+
     TriangleMesh mesh;
     for (int i = 0; i < numSlices; i++) {
         int startidx = i*sliceWidth;
@@ -313,9 +373,30 @@ TriangleMesh AnisotropicParticleMesher::_polygonizeSlices(FragmentedVector<vmath
         mesh.join(sliceMesh);
     }
 
+    std::vector<AnisotropicParticle>().swap(_anisotropicParticles);
+    _isAnisotropicParticleListComplete = false;
+
     return mesh;
 }
 
+/*
+    Slices overlap, and a kernel near a slice boundary is added to the 
+    scalar field of each slice it reaches. If the kernels of all particles 
+    fit within _anisotropicParticleChunkSize, they are computed once here
+    and shared by every slice. Otherwise each slice computes the kernels of
+    its own particles in chunks.
+*/
+void AnisotropicParticleMesher::_initializeSliceAnisotropicParticles() {
+    std::vector<int> nearIndices;
+    _getAnisotropicParticleIndices(nearIndices);
+    if ((int)nearIndices.size() <= _anisotropicParticleChunkSize) {
+        _computeAnisotropicParticles(nearIndices, 0, nearIndices.size());
+        _isAnisotropicParticleListComplete = true;
+    }
+
+    _releaseNearSurfaceParticleNeighbours();
+}
+
 TriangleMesh AnisotropicParticleMesher::_polygonizeSlice(int startidx, int endidx, 
                                                          FragmentedVector<vmath::vec3> &particles, 
                                                          LevelSet &levelset,
@@ -337,13 +418,17 @@ TriangleMesh AnisotropicParticleMesher::_polygonizeSlice(int startidx, int endid
         gridWidth += 2;
     }
 
-    _computeSliceScalarField(startidx, endidx, particles, levelset, materialGrid);
+    _initializeSliceScalarField(startidx, endidx, materialGrid);
 
     Array3d<bool> mask(gridWidth, gridHeight, gridDepth);
     _getSliceMask(startidx, endidx, mask);
 
     Polygonizer3d polygonizer(&_scalarField);
     polygonizer.setSurfaceCellMask(&mask);
+
+    FragmentedVector<vmath::vec3> sliceParticles;
+    _getSliceParticles(startidx, endidx, particles, sliceParticles);
+    _computeSliceScalarField(startidx, endidx, sliceParticles, levelset, polygonizer);
     polygonizer.polygonizeSurface();
 
     return polygonizer.getTriangleMesh();
@@ -494,12 +579,17 @@ void AnisotropicParticleMesher::_getSliceMask(int startidx, int endidx, Array3d<
     }
 }
 
-void AnisotropicParticleMesher::_computeScalarField(FluidMaterialGrid &materialGrid,
-                                                    FragmentedVector<vmath::vec3> &particles,
-                                                    LevelSet &levelset) {
-    _initializeScalarField(materialGrid);
-    _addAnisotropicParticlesToScalarField();
-    _addIsotropicParticlesToScalarField(particles, levelset);
+/*
+    The polygonizer is seeded with each particle that is added to the scalar
+    field.
+*/
+void AnisotropicParticleMesher::_computeScalarField(FragmentedVector<vmath::vec3> &particles,
+                                                    LevelSet &levelset,
+                                                    Polygonizer3d &polygonizer) {
+    std::vector<int> nearIndices;
+    _getAnisotropicParticleIndices(nearIndices);
+    _addAnisotropicParticlesToScalarField(nearIndices, polygonizer);
+    _addIsotropicParticlesToScalarField(particles, levelset, polygonizer);
 }
 
 void AnisotropicParticleMesher::_getSliceParticles(int startidx, int endidx,
@@ -514,15 +604,11 @@ void AnisotropicParticleMesher::_getSliceParticles(int startidx, int endidx,
 }
 
 void AnisotropicParticleMesher::_computeSliceScalarField(int startidx, int endidx,
-                                                         FragmentedVector<vmath::vec3> &particles,
+                                                         FragmentedVector<vmath::vec3> &sliceParticles,
                                                          LevelSet &levelset,
-                                                         FluidMaterialGrid &materialGrid) {
-    _initializeSliceScalarField(startidx, endidx, materialGrid);
-    _addAnisotropicParticlesToSliceScalarField(startidx, endidx);
-
-    FragmentedVector<vmath::vec3> sliceParticles;
-    _getSliceParticles(startidx, endidx, particles, sliceParticles);
-    _addIsotropicParticlesToScalarField(sliceParticles, levelset);
+                                                         Polygonizer3d &polygonizer) {
+    _addAnisotropicParticlesToSliceScalarField(startidx, endidx, polygonizer);
+    _addIsotropicParticlesToScalarField(sliceParticles, levelset, polygonizer);
 
 
     _updateScalarFieldSeam(startidx, endidx);
@@ -576,93 +662,177 @@ void AnisotropicParticleMesher::_initializeSliceScalarField(int startidx, int en
     _scalarField.setOffset(fieldOffset);
 }
 
-void AnisotropicParticleMesher::_computeRangeOfAnisotropicParticles(int startidx, int endidx, 
-                                                                    std::vector<AnisotropicParticle> &particles) {
+/*
+    Indices of the near surface particles that are given anisotropic 
+    kernels. Particles in components that are too small are left out.
+*/
+void AnisotropicParticleMesher::_getAnisotropicParticleIndices(std::vector<int> &indices) {
     GridPointReference ref;
-    for (int i = startidx; i <= endidx; i++) {
+    for (unsigned int i = 0; i < _nearSurfaceParticleRefs.size(); i++) {
         ref = _nearSurfaceParticleRefs[i];
-
         if (_surfaceParticles[ref.id].componentID != -1) {
-            particles.push_back(_computeAnisotropicParticle(ref));
+            indices.push_back(i);
         }
     }
 }
 
-void AnisotropicParticleMesher::_computeRangeOfSliceAnisotropicParticles(int refstartidx, int refendidx, 
-                                                                         int slicestartidx, int sliceendidx,
-                                                                         std::vector<AnisotropicParticle> &particles) {
-    AABB bbox = _getSliceAABB(slicestartidx, sliceendidx);
+void AnisotropicParticleMesher::_getSliceAnisotropicParticleIndices(int startidx, int endidx,
+                                                                    std::vector<int> &indices) {
+    AABB bbox = _getSliceAABB(startidx, endidx);
 
     GridPointReference ref;
-    for (int i = refstartidx; i <= refendidx; i++) {
+    for (unsigned int i = 0; i < _nearSurfaceParticleRefs.size(); i++) {
         ref = _nearSurfaceParticleRefs[i];
-
-        if (_surfaceParticles[ref.id].componentID == -1) {
-            continue;
+        if (_surfaceParticles[ref.id].componentID != -1 &&
+                bbox.isPointInside(_surfaceParticles[ref.id].position)) {
+            indices.push_back(i);
         }
+    }
+}
 
-        if (bbox.isPointInside(_surfaceParticles[ref.id].position)) {
-            particles.push_back(_computeAnisotropicParticle(ref));
+/*
+    Computes the anisotropic kernels of near surface particles
+    nearIndices[startidx] to nearIndices[endidx - 1]. The neighbour lists of
+    the chunk are found first, unless the lists of every near surface 
+    particle were kept from smoothing.
+*/
+void AnisotropicParticleMesher::_computeAnisotropicParticles(std::vector<int> &nearIndices,
+                                                             int startidx, int endidx) {
+    int numElements = endidx - startidx;
+    _anisotropicParticles.clear();
+    _anisotropicParticles.resize(numElements);
+    if (numElements == 0) {
+        return;
+    }
+
+    if (!_isNearSurfaceNeighbourListComplete) {
+        std::vector<GridPointReference> chunkRefs;
+        chunkRefs.reserve(numElements);
+        for (int i = startidx; i < endidx; i++) {
+            chunkRefs.push_back(_nearSurfaceParticleRefs[nearIndices[i]]);
         }
+        _findNearSurfaceParticleNeighbours(chunkRefs);
+    }
+
+    int numthreads = _getNumThreads(numElements);
+    std::vector<std::thread> threads(numthreads);
+    std::vector<int> intervals = ThreadUtils::splitRangeIntoIntervals(startidx, endidx, numthreads);
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&AnisotropicParticleMesher::_computeRangeOfAnisotropicParticles, this,
+                                 &nearIndices, startidx, intervals[i], intervals[i + 1] - 1);
+    }
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
+
+    if (!_isNearSurfaceNeighbourListComplete) {
+        _releaseNearSurfaceParticleNeighbours();
     }
 }
 
-void AnisotropicParticleMesher::_addAnisotropicParticlesToScalarField() {
-    
-    double r = _particleRadius*_anisotropicParticleScale;
-    _scalarField.setPointRadius(r);
+/*
+    Covariance matrices are diagonalized in batches of 
+    CovarianceMatrixBatch::size particles. Kernel chunkidx + i is written 
+    to _anisotropicParticles[i].
+*/
+void AnisotropicParticleMesher::_computeRangeOfAnisotropicParticles(std::vector<int> *nearIndices,
+                                                                    int chunkidx,
+                                                                    int startidx, int endidx) {
+    CovarianceMatrixBatch batch;
+    for (int batchidx = startidx; batchidx <= endidx; batchidx += batch.size) {
+        int batchCount = (int)fmin(batch.size, endidx - batchidx + 1);
+        for (int bidx = 0; bidx < batch.size; bidx++) {
+            vmath::mat3 covariance;
+            if (bidx < batchCount) {
+                int i = batchidx + bidx;
+                int nearidx = nearIndices->at(i);
+                int neighbouridx = _isNearSurfaceNeighbourListComplete ? nearidx : i - chunkidx;
+                covariance = _computeCovarianceMatrix(nearidx, neighbouridx);
+            }
+            batch.setMatrix(bidx, covariance);
+        }
 
-    int n = _anisotropicParticleChunkSize;
-    std::vector<AnisotropicParticle> particles;
-    particles.reserve(n);
+        _diagonalizeCovarianceMatrixBatch(batch);
 
-    for (int startidx = 0; startidx < (int)_nearSurfaceParticleRefs.size(); startidx += n) {
-        int endidx = startidx + n - 1;
-        endidx = fmin(endidx, _nearSurfaceParticleRefs.size() - 1);
+        for (int bidx = 0; bidx < batchCount; bidx++) {
+            int i = batchidx + bidx;
+            GridPointReference ref = _nearSurfaceParticleRefs[nearIndices->at(i)];
 
-        particles.clear();
-        _computeRangeOfAnisotropicParticles(startidx, endidx, particles);
+            SVD svd;
+            _eigenDecompositionToSVD(batch.getEigenvalues(bidx), batch.getEigenvectors(bidx), svd);
+            vmath::mat3 G = _SVDToAnisotropicMatrix(svd);
 
-        for (unsigned int pidx = 0; pidx < particles.size(); pidx++) {
-            _addAnisotropicParticleToScalarField(particles[pidx]);
+            vmath::vec3 p = _surfaceParticles[ref.id].position;
+            _anisotropicParticles[i - chunkidx] = AnisotropicParticle(p, G);
         }
     }
 }
 
-void AnisotropicParticleMesher::_addAnisotropicParticlesToSliceScalarField(int slicestartidx,
-                                                                           int sliceendidx) {
-    
-    double r = _particleRadius*_anisotropicParticleScale;
-    _scalarField.setPointRadius(r);
+/*
+    Kernels are computed and added to the scalar field in chunks of 
+    _anisotropicParticleChunkSize particles. The neighbour lists and kernels
+    of a chunk are released before the next chunk is computed, so that their
+    memory stays bounded for large particle counts.
+*/
+void AnisotropicParticleMesher::_addAnisotropicParticlesToScalarField(std::vector<int> &nearIndices,
+                                                                      Polygonizer3d &polygonizer) {
+    _scalarField.setPointRadius(_particleRadius*_anisotropicParticleScale);
 
     int n = _anisotropicParticleChunkSize;
-    std::vector<AnisotropicParticle> particles;
-    particles.reserve(n);
+    int numElements = nearIndices.size();
+    for (int chunkidx = 0; chunkidx < numElements; chunkidx += n) {
+        int chunkend = (int)fmin(chunkidx + n, numElements);
+        _computeAnisotropicParticles(nearIndices, chunkidx, chunkend);
+
+        for (unsigned int pidx = 0; pidx < _anisotropicParticles.size(); pidx++) {
+            _addAnisotropicParticleToScalarField(_anisotropicParticles[pidx], polygonizer);
+        }
+    }
+
+    std::vector<AnisotropicParticle>().swap(_anisotropicParticles);
+}
 
-    for (int refstartidx = 0; refstartidx < (int)_nearSurfaceParticleRefs.size(); refstartidx += n) {
-        int refendidx = refstartidx + n - 1;
-        refendidx = fmin(refendidx, _nearSurfaceParticleRefs.size() - 1);
+void AnisotropicParticleMesher::_addAnisotropicParticlesToSliceScalarField(int startidx, int endidx,
+                                                                           Polygonizer3d &polygonizer) {
+    if (!_isAnisotropicParticleListComplete) {
+        std::vector<int> nearIndices;
+        _getSliceAnisotropicParticleIndices(startidx, endidx, nearIndices);
+        _addAnisotropicParticlesToScalarField(nearIndices, polygonizer);
+        return;
+    }
 
-        particles.clear();
-        _computeRangeOfSliceAnisotropicParticles(refstartidx, refendidx, 
-                                                 slicestartidx, sliceendidx, particles);
+    _scalarField.setPointRadius(_particleRadius*_anisotropicParticleScale);
 
-        for (unsigned int pidx = 0; pidx < particles.size(); pidx++) {
-            _addAnisotropicParticleToScalarField(particles[pidx]);
+    AABB bbox = _getSliceAABB(startidx, endidx);
+    for (unsigned int pidx = 0; pidx < _anisotropicParticles.size(); pidx++) {
+        if (bbox.isPointInside(_anisotropicParticles[pidx].position)) {
+            _addAnisotropicParticleToScalarField(_anisotropicParticles[pidx], polygonizer);
         }
     }
 }
 
-void AnisotropicParticleMesher::_addAnisotropicParticleToScalarField(AnisotropicParticle &aniso) {
+/*
+    An ellipsoid only sets field values inside the bounding box that
+    ImplicitSurfaceScalarField computes from its anisotropy matrix, so the
+    polygonizer is seeded with the half width of that box.
+*/
+void AnisotropicParticleMesher::_addAnisotropicParticleToScalarField(AnisotropicParticle &aniso,
+                                                                     Polygonizer3d &polygonizer) {
     vmath::vec3 p = aniso.position;
     vmath::mat3 G = aniso.anisotropy;
     double scale = _anisotropicParticleFieldScale;
     _scalarField.addEllipsoidValue(p, G, scale);
 
+    double r = _particleRadius*_anisotropicParticleScale;
+    double dx = _dx / (double)_subdivisionLevel;
+    double len = fmax(fmax(vmath::length(G[0]), vmath::length(G[1])), 
+                      vmath::length(G[2]));
+    polygonizer.addSurfaceSeedPoint(p, r*len + dx);
 }
 
 void AnisotropicParticleMesher::_addIsotropicParticlesToScalarField(FragmentedVector<vmath::vec3> &particles, 
-                                                                    LevelSet &levelset) {
+                                                                    LevelSet &levelset,
+                                                                    Polygonizer3d &polygonizer) {
     double r = _particleRadius*_isotropicParticleScale;
     _scalarField.setPointRadius(r);
 
@@ -672,34 +842,21 @@ void AnisotropicParticleMesher::_addIsotropicParticlesToScalarField(FragmentedVe
 
         if (_isInsideParticle(p, levelset)) {
             _scalarField.addPoint(p);
+            polygonizer.addSurfaceSeedPoint(p, r);
         }
     }
 }
 
-AnisotropicParticleMesher::AnisotropicParticle AnisotropicParticleMesher::_computeAnisotropicParticle(
-                                                                            GridPointReference ref) {
-    std::vector<GridPointReference> neighbours;
-    vmath::mat3 covariance = _computeCovarianceMatrix(ref, _kernelRadius, neighbours);
-
-    SVD svd;
-    _covarianceMatrixToSVD(covariance, svd);
-    vmath::mat3 G = _SVDToAnisotropicMatrix(svd);
-
-    vmath::vec3 p = _surfaceParticles[ref.id].position;
-    return AnisotropicParticle(p, G);
-}
-
-vmath::mat3 AnisotropicParticleMesher::_computeCovarianceMatrix(GridPointReference ref, double radius,
-                                                                std::vector<GridPointReference> &neighbours) {
-
-    neighbours.clear();
-    _pointGrid.queryPointReferencesInsideSphere(ref, radius, neighbours);
+vmath::mat3 AnisotropicParticleMesher::_computeCovarianceMatrix(int nearidx, int neighbouridx) {
+    GridPointReference ref = _nearSurfaceParticleRefs[nearidx];
+    int neighbourStart = _nearSurfaceNeighbourOffsets[neighbouridx];
+    int neighbourEnd = _nearSurfaceNeighbourOffsets[neighbouridx + 1];
 
-    if ((int)neighbours.size() <= _minAnisotropicParticleNeighbourThreshold) {
+    if (neighbourEnd - neighbourStart <= _minAnisotropicParticleNeighbourThreshold) {
         return vmath::mat3();
     }
 
-    vmath::vec3 meanpos = _getWeightedMeanParticlePosition(ref, neighbours);
+    vmath::vec3 meanpos = _getWeightedMeanParticlePosition(ref, neighbourStart, neighbourEnd);
 
     SurfaceParticle meansp = SurfaceParticle(meanpos);
     meansp.componentID = _surfaceParticles[ref.id].componentID;
@@ -717,8 +874,8 @@ vmath::mat3 AnisotropicParticleMesher::_computeCovarianceMatrix(GridPointReferen
     double kernelVal;
     double scale = _particleRadius*_anisotropicParticleScale;
     double eps = 1e-9;
-    for (unsigned int i = 0; i < neighbours.size(); i++) {
-        refj = neighbours[i];
+    for (int i = neighbourStart; i < neighbourEnd; i++) {
+        refj = _nearSurfaceNeighbours[i];
         spj = _surfaceParticles[refj.id];
 
         kernelVal = _evaluateKernel(meansp, spj)*scale;
@@ -746,14 +903,13 @@ vmath::mat3 AnisotropicParticleMesher::_computeCovarianceMatrix(GridPointReferen
                      sum02, sum12, sum22) / (float) weightSum;
 }
 
-void AnisotropicParticleMesher::_covarianceMatrixToSVD(vmath::mat3 &covariance, SVD &svd) {
-    vmath::quat q = _diagonalizeMatrix(covariance);
-    vmath::mat3 Q = vmath::mat3_cast(q);
-    vmath::mat3 D = vmath::transpose(Q) * covariance * Q;
-
-    double d0 = D[0][0];
-    double d1 = D[1][1];
-    double d2 = D[2][2];
+void AnisotropicParticleMesher::_eigenDecompositionToSVD(vmath::vec3 eigenvalues,
+                                                         vmath::mat3 eigenvectors, 
+                                                         SVD &svd) {
+    vmath::mat3 Q = eigenvectors;
+    double d0 = eigenvalues[0];
+    double d1 = eigenvalues[1];
+    double d2 = eigenvalues[2];
     int k0 = 0;
     int k1 = 1;
     int k2 = 2;
@@ -779,9 +935,9 @@ void AnisotropicParticleMesher::_covarianceMatrixToSVD(vmath::mat3 &covariance,
     }
 
     double kr = _maxEigenvalueRatio;
-    double sigma0 = (double)D[k0][k0];
-    double sigma1 = std::max((double)D[k1][k1], sigma0 / kr);
-    double sigma2 = std::max((double)D[k2][k2], sigma0 / kr);;
+    double sigma0 = (double)eigenvalues[k0];
+    double sigma1 = std::max((double)eigenvalues[k1], sigma0 / kr);
+    double sigma2 = std::max((double)eigenvalues[k2], sigma0 / kr);
 
     double ks = cbrt(1.0/(sigma0*sigma1*sigma2));          // scale so that det(covariance) == 1
     svd.rotation = vmath::mat3(Q[k0], Q[k1], Q[k2]);
@@ -789,60 +945,67 @@ void AnisotropicParticleMesher::_covarianceMatrixToSVD(vmath::mat3 &covariance,
 }
 
 /*
-    A must be a symmetric matrix.
-	returns quaternion q such that its corresponding matrix Q 
-	can be used to Diagonalize A
-	Diagonal matrix D = Transpose(Q) * A * Q;  and  A = Q * D * Transpose(Q)
-	The columns of Q are the eigenvectors, D's diagonal is the eigenvalues
+    Diagonalizes every matrix of the batch with a fixed number of cyclic 
+    Jacobi sweeps. Each rotation is applied to all matrices of the batch 
+    in a branch free loop over the batch entries so that the compiler can 
+    vectorize it. On return, a00, a11 and a22 hold the eigenvalues and the
+    columns of v hold the corresponding eigenvectors.
 
     Method adapted from:
-        www.melax.com/diag.html?attredirects=0
+        Numerical Recipes in C, 2nd ed., section 11.1
 */
-vmath::quat AnisotropicParticleMesher::_diagonalizeMatrix(vmath::mat3 A) {
-
-    int maxsteps = 24;
-    vmath::quat q(1.0, vmath::vec3());
-    int i = 0;
-
-    for (i = 0; i < maxsteps; i++) {
-        vmath::mat3 Q = vmath::mat3_cast(q);
-        vmath::mat3 D = vmath::transpose(Q) * A * Q;
-        vmath::vec3 offdiag(D[2][1], D[2][0], D[1][0]);
-        vmath::vec3 om(fabsf(offdiag.x), fabsf(offdiag.y), fabsf(offdiag.z));
-        int k = (om.x > om.y && om.x > om.z)?0: (om.y > om.z)? 1 : 2;
-        int k1 = (k+1)%3;
-		int k2 = (k+2)%3;
-
-        if(offdiag[k]==0.0f) {
-            break;
-        }
-
-        float thet = (D[k2][k2]-D[k1][k1])/(2.0f*offdiag[k]);
-		float sgn = (thet > 0.0f)?1.0f:-1.0f;
-		thet *= sgn;
-        float t = sgn /(thet +((thet < 1.E6f)?sqrtf(thet*thet+1.0f):thet));
-		float c = 1.0f/sqrtf(t*t+1.0f);
+void AnisotropicParticleMesher::_diagonalizeCovarianceMatrixBatch(CovarianceMatrixBatch &b) {
+    for (int sweep = 0; sweep < _numJacobiSweeps; sweep++) {
+        _jacobiRotateBatch(b.a00, b.a11, b.a01, b.a02, b.a12, b.v0, b.v1);
+        _jacobiRotateBatch(b.a00, b.a22, b.a02, b.a01, b.a12, b.v0, b.v2);
+        _jacobiRotateBatch(b.a11, b.a22, b.a12, b.a01, b.a02, b.v1, b.v2);
+    }
+}
 
-        if(c==1.0f) { 
-            break; 
-        }
+/*
+    Applies the rotation that zeroes apq to each matrix of the batch. arp and
+    arq are the entries of the remaining row r in columns p and q. vp and vq
+    are eigenvector columns p and q. The rotations are found first so that 
+    each loop only touches a few arrays.
+*/
+void AnisotropicParticleMesher::_jacobiRotateBatch(float *app, float *aqq, float *apq,
+                                                   float *arp, float *arq,
+                                                   float vp[3][CovarianceMatrixBatch::size], 
+                                                   float vq[3][CovarianceMatrixBatch::size]) {
+    const int n = CovarianceMatrixBatch::size;
+    float tan[n], cos[n], sin[n];
+    for (int i = 0; i < n; i++) {
+        // Selects are written as arithmetic, which GCC will vectorize
+        float isNonZero = (float)(apq[i] != 0.0f);
+        float theta = (aqq[i] - app[i]) / (2.0f*apq[i] + 1.0f - isNonZero);
+        float t = copysignf(1.0f, theta) / (fabsf(theta) + sqrtf(theta*theta + 1.0f));
+        tan[i] = isNonZero*t;
+        cos[i] = 1.0f / sqrtf(tan[i]*tan[i] + 1.0f);
+        sin[i] = tan[i]*cos[i];
+    }
 
-        float jrtemp[3] = {0.0f, 0.0f, 0.0f};
-        jrtemp[k] = sgn*sqrtf((1.0f-c)/2.0f);
-        jrtemp[k] *= -1.0f;
+    for (int i = 0; i < n; i++) {
+        float tapq = tan[i]*apq[i];
+        app[i] -= tapq;
+        aqq[i] += tapq;
+        apq[i] = 0.0f;
+    }
 
-        vmath::quat jr(sqrtf(1.0f - jrtemp[k]*jrtemp[k]), 
-                     vmath::vec3(jrtemp[0], jrtemp[1], jrtemp[2]));
+    for (int i = 0; i < n; i++) {
+        float rp = arp[i];
+        float rq = arq[i];
+        arp[i] = cos[i]*rp - sin[i]*rq;
+        arq[i] = sin[i]*rp + cos[i]*rq;
+    }
 
-        if(jr.w==1.0f) {
-            break; 
+    for (int j = 0; j < 3; j++) {
+        for (int i = 0; i < n; i++) {
+            float p = vp[j][i];
+            float q = vq[j][i];
+            vp[j][i] = cos[i]*p - sin[i]*q;
+            vq[j][i] = sin[i]*p + cos[i]*q;
         }
-
-        q = vmath::cross(q,jr); 
-		q = vmath::normalize(q);
     }
-
-    return q;
 }
 
 vmath::mat3 AnisotropicParticleMesher::_SVDToAnisotropicMatrix(SVD &svd) {
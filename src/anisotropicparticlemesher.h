@@ -22,6 +22,8 @@ freely, subject to the following restrictions:
 
 #include <stdio.h>
 #include <iostream>
+#include <vector>
+#include <thread>
 
 #include "array3d.h"
 #include "grid3d.h"
@@ -36,6 +38,8 @@ freely, subject to the following restrictions:
 #include "fluidmaterialgrid.h"
 #include "fragmentedvector.h"
 #include "markerparticle.h"
+#include "markerparticlevector.h"
+#include "threadutils.h"
 
 class AnisotropicParticleMesher
 {
@@ -47,7 +51,7 @@ public:
     void setSubdivisionLevel(int n);
     void setNumPolygonizationSlices(int n);
 
-    TriangleMesh meshParticles(FragmentedVector<MarkerParticle> &particles, 
+    TriangleMesh meshParticles(MarkerParticleVector &particles, 
                                LevelSet &levelset,
                                FluidMaterialGrid &materialGrid,
                                double particleRadius);
@@ -100,6 +104,40 @@ private:
         SVD(vmath::vec3 d, vmath::mat3 rot) : rotation(rot), diag(d) {}
     };
 
+    /*
+        Symmetric matrices stored with one array per matrix entry so that a 
+        batch of matrices can be diagonalized together with vector 
+        instructions. v0, v1 and v2 are the eigenvector columns, indexed by
+        row and then by batch entry.
+    */
+    struct CovarianceMatrixBatch {
+        static const int size = 16;
+
+        float a00[size], a11[size], a22[size];
+        float a01[size], a02[size], a12[size];
+        float v0[3][size], v1[3][size], v2[3][size];
+
+        void setMatrix(int i, vmath::mat3 &m) {
+            a00[i] = m[0][0]; a11[i] = m[1][1]; a22[i] = m[2][2];
+            a01[i] = m[1][0]; a02[i] = m[2][0]; a12[i] = m[2][1];
+            for (int j = 0; j < 3; j++) {
+                v0[j][i] = j == 0 ? 1.0f : 0.0f;
+                v1[j][i] = j == 1 ? 1.0f : 0.0f;
+                v2[j][i] = j == 2 ? 1.0f : 0.0f;
+            }
+        }
+
+        vmath::vec3 getEigenvalues(int i) {
+            return vmath::vec3(a00[i], a11[i], a22[i]);
+        }
+
+        vmath::mat3 getEigenvectors(int i) {
+            return vmath::mat3(vmath::vec3(v0[0][i], v0[1][i], v0[2][i]),
+                               vmath::vec3(v1[0][i], v1[1][i], v1[2][i]),
+                               vmath::vec3(v2[0][i], v2[1][i], v2[2][i]));
+        }
+    };
+
     enum class ParticleLocation : char { 
         Inside   = 0x00, 
         NearSurface = 0x01, 
@@ -110,7 +148,7 @@ private:
 
     void _initializeSurfaceParticles(FragmentedVector<vmath::vec3> &particles, 
                                      LevelSet &levelset);
-    void _filterHighDensityParticles(FragmentedVector<MarkerParticle> &particles, 
+    void _filterHighDensityParticles(MarkerParticleVector &particles, 
                                      FragmentedVector<vmath::vec3> &filtered);
     ParticleLocation _getParticleLocationType(vmath::vec3 p, LevelSet &levelset);
 
@@ -132,14 +170,15 @@ private:
 
     void _initializeSurfaceParticleSpatialGrid();
     void _updateSurfaceParticleComponentIDs();
+    void _findNearSurfaceParticleNeighbours(std::vector<GridPointReference> &refs);
+    void _releaseNearSurfaceParticleNeighbours();
     void _smoothSurfaceParticlePositions();
     void _computeSmoothedNearSurfaceParticlePositions();
-    void _smoothRangeOfSurfaceParticlePositions(int startidx, int endidx);
-    vmath::vec3 _getSmoothedParticlePosition(GridPointReference ref,
-                                           double radius,
-                                           std::vector<GridPointReference> &refs);
+    void _smoothRangeOfSurfaceParticlePositions(int chunkidx, int startidx, int endidx);
+    vmath::vec3 _getSmoothedParticlePosition(int nearidx, int neighbouridx);
     vmath::vec3 _getWeightedMeanParticlePosition(GridPointReference ref,
-                                               std::vector<GridPointReference> &neighbours);
+                                               int neighbourStart, int neighbourEnd);
+    int _getNumThreads(int numElements);
     TriangleMesh _polygonizeAll(FragmentedVector<vmath::vec3> &particles, 
                                 LevelSet &levelset,
                                 FluidMaterialGrid &materialGrid);
@@ -152,10 +191,11 @@ private:
                                   FluidMaterialGrid &materialGrid);
 
     void _getSubdividedGridDimensions(int *i, int *j, int *k, double *dx);
+    void _initializeSliceAnisotropicParticles();
     void _computeSliceScalarField(int startidx, int endidx, 
-                                  FragmentedVector<vmath::vec3> &particles,
+                                  FragmentedVector<vmath::vec3> &sliceParticles,
                                   LevelSet &levelset,
-                                  FluidMaterialGrid &materialGrid);
+                                  Polygonizer3d &polygonizer);
     vmath::vec3 _getSliceGridPositionOffset(int startidx, int endidx);
     void _getSliceParticles(int startidx, int endidx, 
                             FragmentedVector<vmath::vec3> &markerParticles,
@@ -169,27 +209,35 @@ private:
     void _saveScalarFieldSliceSeamData();
     void _getSliceMask(int startidx, int endidx, Array3d<bool> &mask);
 
-    void _computeScalarField(FluidMaterialGrid &materialGrid,
-                             FragmentedVector<vmath::vec3> &particles,
-                             LevelSet &levelset);
+    void _computeScalarField(FragmentedVector<vmath::vec3> &particles,
+                             LevelSet &levelset,
+                             Polygonizer3d &polygonizer);
     void _initializeScalarField(FluidMaterialGrid &materialGrid);
     void _initializeSliceScalarField(int startidx, int endidx, 
                                      FluidMaterialGrid &materialGrid);
-    void _addAnisotropicParticlesToScalarField();
-    void _addAnisotropicParticlesToSliceScalarField(int startidx, int endidx);
-    void _computeRangeOfAnisotropicParticles(int startidx, int endidx, 
-                                             std::vector<AnisotropicParticle> &particles);
-    void _computeRangeOfSliceAnisotropicParticles(int refstartidx, int refendidx, 
-                                                  int slicestartidx, int sliceendidx,
-                                                  std::vector<AnisotropicParticle> &particles);
-    void _addAnisotropicParticleToScalarField(AnisotropicParticle &aniso);
-    void _addIsotropicParticlesToScalarField(FragmentedVector<vmath::vec3> &particles, LevelSet &levelset);
-    AnisotropicParticle _computeAnisotropicParticle(GridPointReference ref);
-    void _getUnprocessedParticlesFromStack(int num, std::vector<GridPointReference> &refs);
-    vmath::mat3 _computeCovarianceMatrix(GridPointReference ref, double radius,
-                                       std::vector<GridPointReference> &neighbours);
-    void _covarianceMatrixToSVD(vmath::mat3 &covariance, SVD &svd);
-    vmath::quat _diagonalizeMatrix(vmath::mat3 A);
+    void _getAnisotropicParticleIndices(std::vector<int> &indices);
+    void _getSliceAnisotropicParticleIndices(int startidx, int endidx,
+                                             std::vector<int> &indices);
+    void _addAnisotropicParticlesToScalarField(std::vector<int> &nearIndices,
+                                               Polygonizer3d &polygonizer);
+    void _addAnisotropicParticlesToSliceScalarField(int startidx, int endidx,
+                                                    Polygonizer3d &polygonizer);
+    void _computeAnisotropicParticles(std::vector<int> &nearIndices,
+                                      int startidx, int endidx);
+    void _computeRangeOfAnisotropicParticles(std::vector<int> *nearIndices,
+                                             int chunkidx, int startidx, int endidx);
+    void _addAnisotropicParticleToScalarField(AnisotropicParticle &aniso,
+                                              Polygonizer3d &polygonizer);
+    void _addIsotropicParticlesToScalarField(FragmentedVector<vmath::vec3> &particles, 
+                                             LevelSet &levelset,
+                                             Polygonizer3d &polygonizer);
+    vmath::mat3 _computeCovarianceMatrix(int nearidx, int neighbouridx);
+    void _diagonalizeCovarianceMatrixBatch(CovarianceMatrixBatch &batch);
+    void _jacobiRotateBatch(float *app, float *aqq, float *apq,
+                            float *arp, float *arq,
+                            float vp[3][CovarianceMatrixBatch::size], 
+                            float vq[3][CovarianceMatrixBatch::size]);
+    void _eigenDecompositionToSVD(vmath::vec3 eigenvalues, vmath::mat3 eigenvectors, SVD &svd);
     vmath::mat3 _SVDToAnisotropicMatrix(SVD &svd);
 
     void _setParticleRadius(double r);
@@ -210,6 +258,7 @@ private:
 
     int _minAnisotropicParticleNeighbourThreshold = 6;
     double _maxEigenvalueRatio = 5.5;
+    int _numJacobiSweeps = 6;
 
     int _isize = 0;
     int _jsize = 0;
@@ -225,10 +274,20 @@ private:
     FragmentedVector<GridPointReference> _farSurfaceParticleRefs;
     FragmentedVector<vmath::vec3> _smoothedPositions;
 
-    ImplicitSurfaceScalarField _scalarField;
+    // Neighbours of the i'th particle of the current chunk within the kernel 
+    // radius are stored in _nearSurfaceNeighbours over the range 
+    // [_nearSurfaceNeighbourOffsets[i], _nearSurfaceNeighbourOffsets[i + 1]).
+    // When the lists are complete, i indexes _nearSurfaceParticleRefs.
+    std::vector<int> _nearSurfaceNeighbourOffsets;
+    std::vector<GridPointReference> _nearSurfaceNeighbours;
+    bool _isNearSurfaceNeighbourListComplete = false;
+    std::vector<AnisotropicParticle> _anisotropicParticles;
+    bool _isAnisotropicParticleListComplete = false;
+    int _minParticlesPerThread = 2000;
+    int _anisotropicParticleChunkSize = 1000000;  // Max number of near surface particles
+                                                   // with neighbour lists or kernels in memory
 
-    int _anisotropicParticleChunkSize = 1000000;  // Max number of particles to add to scalar
-                                                  // field at once.
+    ImplicitSurfaceScalarField _scalarField;
 
     int _subdivisionLevel = 1;
     int _numPolygonizationSlices = 1;
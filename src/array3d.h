@@ -25,6 +25,10 @@ freely, subject to the following restrictions:
 #include <iostream>
 #include <functional>
 #include <string>
+#include <algorithm>
+#include <utility>
+
+#include "gridlayout.h"
 
 struct GridIndex {
     int i, j, k;
@@ -58,7 +62,7 @@ struct GridIndexHasher {
     }
 };
 
-template <class T>
+template <class T, class Layout = RowMajorLayout>
 class Array3d
 {
 public:
@@ -82,57 +86,82 @@ public:
         _numElements = obj._numElements;
 
         _initializeGrid();
+        std::copy(obj._grid, obj._grid + obj._storageSize, _grid);
 
-        T val;
-        for (int k = 0; k < depth; k++) {
-            for (int j = 0; j < height; j++) {
-                for (int i = 0; i < width; i++) {
-                    val = obj._grid[_getFlatIndex(i, j, k)];
-                    set(i, j, k, val);
-                }
-            }
-        }
+        _isOutOfRangeValueSet = obj._isOutOfRangeValueSet;
+        _outOfRangeValue = obj._outOfRangeValue;
+    }
 
-        if (obj._isOutOfRangeValueSet) {
-            _outOfRangeValue = obj._outOfRangeValue;
-            _isOutOfRangeValueSet = true;
-        }
+    Array3d(Array3d &&obj) {
+        width = obj.width;
+        height = obj.height;
+        depth = obj.depth;
+        _numElements = obj._numElements;
+        _storageSize = obj._storageSize;
+        _layout = obj._layout;
+        _grid = obj._grid;
+
+        _isOutOfRangeValueSet = obj._isOutOfRangeValueSet;
+        _outOfRangeValue = obj._outOfRangeValue;
+
+        obj.width = 0;
+        obj.height = 0;
+        obj.depth = 0;
+        obj._numElements = 0;
+        obj._storageSize = 0;
+        obj._grid = nullptr;
     }
 
-    Array3d operator=(const Array3d &rhs) {
-        delete[] _grid;
+    Array3d& operator=(const Array3d &rhs) {
+        if (this == &rhs) {
+            return *this;
+        }
+
+        // Storage is reused when the grid size has not changed
+        if (_storageSize != rhs._storageSize) {
+            delete[] _grid;
+            _storageSize = rhs._storageSize;
+            _grid = new T[_storageSize];
+        }
 
         width = rhs.width;
         height = rhs.height;
         depth = rhs.depth;
         _numElements = rhs._numElements;
+        _layout = rhs._layout;
+        std::copy(rhs._grid, rhs._grid + rhs._storageSize, _grid);
 
-        _initializeGrid();
+        _isOutOfRangeValueSet = rhs._isOutOfRangeValueSet;
+        _outOfRangeValue = rhs._outOfRangeValue;
 
-        T val;
-        for (int k = 0; k < depth; k++) {
-            for (int j = 0; j < height; j++) {
-                for (int i = 0; i < width; i++) {
-                    val = rhs._grid[_getFlatIndex(i, j, k)];
-                    set(i, j, k, val);
-                }
-            }
-        }
+        return *this;
+    }
 
-        if (rhs._isOutOfRangeValueSet) {
-            _outOfRangeValue = rhs._outOfRangeValue;
-            _isOutOfRangeValueSet = true;
+    Array3d& operator=(Array3d &&rhs) {
+        if (this != &rhs) {
+            swap(rhs);
         }
-
         return *this;
     }
 
+    void swap(Array3d &other) {
+        std::swap(width, other.width);
+        std::swap(height, other.height);
+        std::swap(depth, other.depth);
+        std::swap(_numElements, other._numElements);
+        std::swap(_storageSize, other._storageSize);
+        std::swap(_layout, other._layout);
+        std::swap(_grid, other._grid);
+        std::swap(_isOutOfRangeValueSet, other._isOutOfRangeValueSet);
+        std::swap(_outOfRangeValue, other._outOfRangeValue);
+    }
+
     ~Array3d() {
         delete[] _grid;
     }
 
     void fill(T value) {
-        for (int idx = 0; idx < width*height*depth; idx++) {
+        for (int idx = 0; idx < _storageSize; idx++) {
             _grid[idx] = value;
         }
     }
@@ -158,7 +187,7 @@ public:
     }
 
     T operator()(int flatidx) {
-        bool isInRange = flatidx >= 0 && flatidx < _numElements;
+        bool isInRange = flatidx >= 0 && flatidx < _storageSize;
         if (!isInRange && _isOutOfRangeValueSet) {
             return _outOfRangeValue;
         }
@@ -188,7 +217,7 @@ public:
     }
 
     T get(int flatidx) {
-        bool isInRange = flatidx >= 0 && flatidx < _numElements;
+        bool isInRange = flatidx >= 0 && flatidx < _storageSize;
         if (!isInRange && _isOutOfRangeValueSet) {
             return _outOfRangeValue;
         }
@@ -214,7 +243,7 @@ public:
     }
 
     void set(int flatidx, T value) {
-        assert(flatidx >= 0 && flatidx < _numElements);
+        assert(flatidx >= 0 && flatidx < _storageSize);
         _grid[flatidx] = value;
     }
 
@@ -229,7 +258,7 @@ public:
     }
 
     void add(int flatidx, T value) {
-        assert(flatidx >= 0 && flatidx < _numElements);
+        assert(flatidx >= 0 && flatidx < _storageSize);
         _grid[flatidx] += value;
     }
 
@@ -254,7 +283,7 @@ public:
     }
 
     T *getPointer(int flatidx) {
-        bool isInRange = flatidx >= 0 && flatidx < _numElements;
+        bool isInRange = flatidx >= 0 && flatidx < _storageSize;
         if (!isInRange && _isOutOfRangeValueSet) {
             return &_outOfRangeValue;
         }
@@ -300,7 +329,9 @@ public:
 
 private:
     void _initializeGrid() {
-        _grid = new T[width*height*depth];
+        _layout.initialize(width, height, depth);
+        _storageSize = _layout.getStorageSize();
+        _grid = new T[_storageSize];
     }
 
     inline bool _isIndexInRange(int i, int j, int k) {
@@ -308,20 +339,20 @@ private:
     }
 
     inline unsigned int _getFlatIndex(int i, int j, int k) {
-        return (unsigned int)i + (unsigned int)width *
-               ((unsigned int)j + (unsigned int)height * (unsigned int)k);
+        return _layout.getIndex(i, j, k);
     }
 
     inline unsigned int _getFlatIndex(GridIndex g) {
-        return (unsigned int)g.i + (unsigned int)width *
-               ((unsigned int)g.j + (unsigned int)height * (unsigned int)g.k);
+        return _layout.getIndex(g.i, g.j, g.k);
     }
 
     T *_grid;
 
     bool _isOutOfRangeValueSet = false;
-    T _outOfRangeValue;
+    T _outOfRangeValue = T();
     int _numElements = 0;
+    int _storageSize = 0;
+    Layout _layout;
 };
 
 #endif
@@ -25,7 +25,12 @@ freely, subject to the following restrictions:
 
 #include "array3d.h"
 
-template <class T>
+/*
+    A window into a parent grid. The parent is an Array3d by default, but 
+    may be any grid with the same element access methods, such as a 
+    SparseArray3d.
+*/
+template <class T, class Layout = RowMajorLayout, class Grid = Array3d<T, Layout> >
 class ArrayView3d
 {
 public:
@@ -36,27 +41,27 @@ public:
         setArray3d(&_dummyGrid);
     }
 
-    ArrayView3d(Array3d<T> *grid) {
+    ArrayView3d(Grid *grid) {
         setDimensions(0, 0, 0);
         setOffset(0, 0, 0);
         setArray3d(grid);
     }
 
-    ArrayView3d(int isize, int jsize, int ksize, Array3d<T> *grid) {
+    ArrayView3d(int isize, int jsize, int ksize, Grid *grid) {
         setDimensions(isize, jsize, ksize);
         setOffset(0, 0, 0);
         setArray3d(grid);
     }
 
     ArrayView3d(int isize, int jsize, int ksize, 
-                int offi, int offj, int offk, Array3d<T> *grid) {
+                int offi, int offj, int offk, Grid *grid) {
         setDimensions(isize, jsize, ksize);
         setOffset(offi, offj, offk);
         setArray3d(grid);
     }
 
     ArrayView3d(int isize, int jsize, int ksize, 
-                GridIndex offset, Array3d<T> *grid) {
+                GridIndex offset, Grid *grid) {
         setDimensions(isize, jsize, ksize);
         setOffset(offset);
         setArray3d(grid);
@@ -71,7 +76,7 @@ public:
         _joffset = obj._joffset;
         _koffset = obj._koffset;
 
-        _dummyGrid = Array3d<T>();
+        _dummyGrid = Grid();
 
         if (obj._parent == &obj._dummyGrid) {
             _parent = &_dummyGrid;
@@ -89,7 +94,7 @@ public:
         _joffset = rhs._joffset;
         _koffset = rhs._koffset;
 
-        _dummyGrid = Array3d<T>();
+        _dummyGrid = Grid();
 
         if (rhs._parent == &rhs._dummyGrid) {
             _parent = &_dummyGrid;
@@ -142,11 +147,11 @@ public:
         return GridIndex(_ioffset, _joffset, _koffset);
     }
 
-    void setArray3d(Array3d<T> *grid) {
+    void setArray3d(Grid *grid) {
         _parent = grid;
     }
 
-    Array3d<T> *getArray3d() {
+    Grid *getArray3d() {
         return _parent;
     }
 
@@ -165,7 +170,7 @@ public:
     }
 
     void getViewAsArray3d(Array3d<T> &view) {
-        assert(view.width == width && view.height == height && view.depth = depth);
+        assert(view.width == width && view.height == height && view.depth == depth);
 
         for (int k = 0; k < depth; k++) {
             for (int j = 0; j < height; j++) {
@@ -174,8 +179,6 @@ public:
                 }
             }
         }
-
-        return view;
     }
 
     void fill(T value) {
@@ -322,8 +325,8 @@ private:
     int _joffset = 0;
     int _koffset = 0;
 
-    Array3d<T> *_parent;
-    Array3d<T> _dummyGrid;
+    Grid *_parent;
+    Grid _dummyGrid;
 
 };
 
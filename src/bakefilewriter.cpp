@@ -0,0 +1,178 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "bakefilewriter.h"
+
+BakeFileWriter::BakeFileWriter() {
+}
+
+BakeFileWriter::~BakeFileWriter() {
+    _stopWriterThread();
+}
+
+void BakeFileWriter::writeMeshToPLY(TriangleMesh &mesh, std::string filename) {
+    WriteJob job;
+    job.type = WriteType::mesh;
+    job.filename = filename;
+    job.bytes = _getMeshByteCount(mesh);
+    job.mesh = std::move(mesh);
+    mesh = TriangleMesh();
+
+    _queueJob(job);
+}
+
+void BakeFileWriter::writeDataToFile(std::vector<char> &data, std::string filename) {
+    WriteJob job;
+    job.type = WriteType::data;
+    job.filename = filename;
+    job.bytes = (long long)data.size();
+    job.data = std::move(data);
+    data = std::vector<char>();
+
+    _queueJob(job);
+}
+
+void BakeFileWriter::flush() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (!_jobQueue.empty() || _numJobsInProgress > 0) {
+        _jobFinishedCondition.wait(lock);
+    }
+}
+
+void BakeFileWriter::enableAsynchronousWrites() {
+    _isAsynchronousWritesEnabled = true;
+}
+
+void BakeFileWriter::disableAsynchronousWrites() {
+    flush();
+    _isAsynchronousWritesEnabled = false;
+}
+
+bool BakeFileWriter::isAsynchronousWritesEnabled() {
+    return _isAsynchronousWritesEnabled;
+}
+
+void BakeFileWriter::setMaxQueuedBytes(long long n) {
+    assert(n >= 0);
+    std::unique_lock<std::mutex> lock(_mutex);
+    _maxQueuedBytes = n;
+}
+
+long long BakeFileWriter::getMaxQueuedBytes() {
+    return _maxQueuedBytes;
+}
+
+void BakeFileWriter::_queueJob(WriteJob &job) {
+    if (!_isAsynchronousWritesEnabled) {
+        _writeJob(job);
+        return;
+    }
+
+    _startWriterThread();
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (_queuedBytes > 0 && _queuedBytes + job.bytes > _maxQueuedBytes) {
+        _jobFinishedCondition.wait(lock);
+    }
+
+    _queuedBytes += job.bytes;
+    _jobQueue.push_back(std::move(job));
+    _jobQueuedCondition.notify_one();
+}
+
+void BakeFileWriter::_writeJob(WriteJob &job) {
+    if (job.type == WriteType::mesh) {
+        job.mesh.writeMeshToPLY(job.filename);
+    } else if (job.type == WriteType::data) {
+        std::ofstream file(job.filename.c_str(), 
+                           std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!job.data.empty()) {
+            file.write(&(job.data[0]), job.data.size());
+        }
+        file.close();
+    }
+}
+
+long long BakeFileWriter::_getMeshByteCount(TriangleMesh &mesh) {
+    long long vertexBytes = sizeof(vmath::vec3) * (mesh.vertices.size() + 
+                                                   mesh.normals.size() + 
+                                                   mesh.vertexcolors.size());
+    long long triangleBytes = sizeof(Triangle) * mesh.triangles.size();
+    return vertexBytes + triangleBytes;
+}
+
+void BakeFileWriter::_startWriterThread() {
+    if (_isWriterThreadRunning) {
+        return;
+    }
+
+    _isStopRequested = false;
+    _thread = std::thread(&BakeFileWriter::_writerThread, this);
+    _isWriterThreadRunning = true;
+}
+
+void BakeFileWriter::_stopWriterThread() {
+    if (!_isWriterThreadRunning) {
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _isStopRequested = true;
+        _jobQueuedCondition.notify_one();
+    }
+
+    _thread.join();
+    _isWriterThreadRunning = false;
+}
+
+void BakeFileWriter::_writerThread() {
+    for (;;) {
+        WriteJob job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (_jobQueue.empty() && !_isStopRequested) {
+                _jobQueuedCondition.wait(lock);
+            }
+
+            // Remaining jobs are still written when a stop is requested so
+            // that no output is lost at shutdown
+            if (_jobQueue.empty()) {
+                return;
+            }
+
+            job = std::move(_jobQueue.front());
+            _jobQueue.pop_front();
+            _numJobsInProgress++;
+        }
+
+        _writeJob(job);
+
+        // The job's memory is counted against the budget until it has been
+        // written and released
+        long long bytes = job.bytes;
+        job = WriteJob();
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _queuedBytes -= bytes;
+            _numJobsInProgress--;
+            _jobFinishedCondition.notify_all();
+        }
+    }
+}
@@ -0,0 +1,112 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef BAKEFILEWRITER_H
+#define BAKEFILEWRITER_H
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <assert.h>
+
+#include "trianglemesh.h"
+
+/*
+    Writes simulation output files on a background thread so that the 
+    simulation does not wait on disk I/O. Files are written in the order 
+    that they are queued. 
+
+    Queued meshes and data buffers are moved into the writer and the 
+    arguments are left empty. When the queued data would exceed the memory 
+    budget, queueing blocks until enough of the queue has been written.
+*/
+class BakeFileWriter
+{
+public:
+    BakeFileWriter();
+    ~BakeFileWriter();
+
+    void writeMeshToPLY(TriangleMesh &mesh, std::string filename);
+    void writeDataToFile(std::vector<char> &data, std::string filename);
+
+    /*
+        Blocks until every queued file has been written.
+    */
+    void flush();
+
+    /*
+        Enable/disable writing files on the background thread. When 
+        disabled, files are written before the write method returns. 
+
+        Enabled by default.
+    */
+    void enableAsynchronousWrites();
+    void disableAsynchronousWrites();
+    bool isAsynchronousWritesEnabled();
+
+    /*
+        Maximum number of bytes of mesh and file data that may be queued or 
+        in the process of being written. A single file larger than the 
+        budget is still queued once the writer is idle.
+    */
+    void setMaxQueuedBytes(long long n);
+    long long getMaxQueuedBytes();
+
+private:
+
+    enum class WriteType { 
+        mesh, 
+        data
+    };
+
+    struct WriteJob {
+        WriteType type = WriteType::data;
+        std::string filename;
+        TriangleMesh mesh;
+        std::vector<char> data;
+        long long bytes = 0;
+    };
+
+    void _queueJob(WriteJob &job);
+    void _writeJob(WriteJob &job);
+    long long _getMeshByteCount(TriangleMesh &mesh);
+    void _startWriterThread();
+    void _stopWriterThread();
+    void _writerThread();
+
+    bool _isAsynchronousWritesEnabled = true;
+    long long _maxQueuedBytes = 1073741824LL;
+
+    std::deque<WriteJob> _jobQueue;
+    long long _queuedBytes = 0;
+    int _numJobsInProgress = 0;
+    bool _isWriterThreadRunning = false;
+    bool _isStopRequested = false;
+
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _jobQueuedCondition;
+    std::condition_variable _jobFinishedCondition;
+};
+
+#endif
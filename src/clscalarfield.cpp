@@ -27,15 +27,25 @@ CLScalarField::CLScalarField() {
 }
 
 bool CLScalarField::initialize() {
+    if (_isNativeDevicePreferred) {
+        _initializeNativeBackend();
+        return true;
+    }
+
+#if WITH_OPENCL
+    // Fall back to the native multithreaded backend if the host does
+    // not have an OpenCL device
     cl_int err;
     cl::Context context = _getCLContext(&err);
     if (err != CL_SUCCESS) {
-        return false;
+        _initializeNativeBackend();
+        return true;
     }
 
     cl::Device device = _getCLDevice(context, &err);
     if (err != CL_SUCCESS) {
-        return false;
+        _initializeNativeBackend();
+        return true;
     }
     _CLContext = context;
     _CLDevice = device;
@@ -58,6 +68,10 @@ bool CLScalarField::initialize() {
 
     _isInitialized = true;
     return true;
+#else
+    _initializeNativeBackend();
+    return true;
+#endif
 }
 
 void CLScalarField::addPoints(std::vector<vmath::vec3> &points, 
@@ -87,6 +101,15 @@ void CLScalarField::addPoints(std::vector<vmath::vec3> &points,
 
     _initializeWorkGroupGrid(pointValues, field, workGroupGrid);
 
+    if (_isUsingNative) {
+        _computeScalarFieldNative(workGroupGrid, false, false);
+        if (!isOutOfRangeValueSet) {
+            field->setOutOfRangeValue();
+        }
+        return;
+    }
+
+#if WITH_OPENCL
     std::vector<WorkChunk> workChunkQueue;
     _initializeWorkChunks(workGroupGrid, workChunkQueue);
 
@@ -110,6 +133,7 @@ void CLScalarField::addPoints(std::vector<vmath::vec3> &points,
         field->setOutOfRangeValue();
     }
     
+#endif
 }
 
 void CLScalarField::addPoints(std::vector<vmath::vec3> &points, 
@@ -160,7 +184,16 @@ void CLScalarField::addPointValues(std::vector<vmath::vec3> &points,
     GridIndex workGroupDims = _getWorkGroupGridDimensions();
     Array3d<WorkGroup> workGroupGrid(workGroupDims.i, workGroupDims.j, workGroupDims.k);
     _initializeWorkGroupGrid(pointValues, field, workGroupGrid);
+
+    if (_isUsingNative) {
+        _computeScalarFieldNative(workGroupGrid, true, false);
+        if (!isOutOfRangeValueSet) {
+            field->setOutOfRangeValue();
+        }
+        return;
+    }
     
+#if WITH_OPENCL
     std::vector<WorkChunk> workChunkQueue;
     _initializeWorkChunks(workGroupGrid, workChunkQueue);
 
@@ -181,6 +214,7 @@ void CLScalarField::addPointValues(std::vector<vmath::vec3> &points,
     if (!isOutOfRangeValueSet) {
         field->setOutOfRangeValue();
     }
+#endif
 }
 
 void CLScalarField::addPointValues(std::vector<vmath::vec3> &points, 
@@ -219,7 +253,19 @@ void CLScalarField::addPointValues(std::vector<vmath::vec3> &points,
     Array3d<WorkGroup> workGroupGrid(workGroupDims.i, workGroupDims.j, workGroupDims.k);
 
     _initializeWorkGroupGrid(pointValues, scalarfield, weightfield, workGroupGrid);
+
+    if (_isUsingNative) {
+        _computeScalarFieldNative(workGroupGrid, true, true);
+        if (!isScalarFieldOutOfRangeValueSet) {
+            scalarfield->setOutOfRangeValue();
+        }
+        if (!isWeightFieldOutOfRangeValueSet) {
+            weightfield->setOutOfRangeValue();
+        }
+        return;
+    }
     
+#if WITH_OPENCL
     std::vector<WorkChunk> workChunkQueue;
     _initializeWorkChunks(workGroupGrid, workChunkQueue);
 
@@ -244,6 +290,7 @@ void CLScalarField::addPointValues(std::vector<vmath::vec3> &points,
         weightfield->setOutOfRangeValue();
     }
     
+#endif
 }
 
 void CLScalarField::addPointValues(std::vector<vmath::vec3> &points, 
@@ -304,17 +351,29 @@ void CLScalarField::setDevicePreference(std::string devtype) {
         setDevicePreferenceGPU();
     } else if (devtype == "cpu") {
         setDevicePreferenceCPU();
+    } else if (devtype == "native") {
+        setDevicePreferenceNative();
     }
 }
 
 void CLScalarField::setDevicePreferenceGPU() {
+#if WITH_OPENCL
     _devicePreference1 = CL_DEVICE_TYPE_GPU;
     _devicePreference2 = CL_DEVICE_TYPE_CPU;
+#endif
+    _isNativeDevicePreferred = false;
 }
 
 void CLScalarField::setDevicePreferenceCPU() {
+#if WITH_OPENCL
     _devicePreference1 = CL_DEVICE_TYPE_CPU;
     _devicePreference2 = CL_DEVICE_TYPE_GPU;
+#endif
+    _isNativeDevicePreferred = false;
+}
+
+void CLScalarField::setDevicePreferenceNative() {
+    _isNativeDevicePreferred = true;
 }
 
 void CLScalarField::printDeviceInfo() {
@@ -322,6 +381,17 @@ void CLScalarField::printDeviceInfo() {
         return;
     }
 
+    if (_isUsingNative) {
+        std::cout << "NATIVE_DEVICE_TYPE:            CPU" << std::endl;
+        std::cout << "NATIVE_MAX_THREADS:            " << 
+                     ThreadUtils::getMaxThreadCount() << std::endl;
+        std::cout << "NATIVE_CHUNK_SIZE:             " << _chunkWidth << " x " << 
+                                                          _chunkHeight << " x " << 
+                                                          _chunkDepth << std::endl;
+        return;
+    }
+
+#if WITH_OPENCL
     std::cout << "CL_DEVICE_NAME:                " << 
                  _deviceInfo.cl_device_name << std::endl;
     std::cout << "CL_DEVICE_VENDOR:              " << 
@@ -367,8 +437,10 @@ void CLScalarField::printDeviceInfo() {
     std::cout << "CL_DEVICE_MAX_WORK_ITEM_SIZES: " << g.i << " x " << 
                                                       g.j << " x " << 
                                                       g.k << std::endl;
+#endif
 }
 
+#if WITH_OPENCL
 cl_int CLScalarField::_initializeChunkDimensions() {
     int groupsize = (int)_deviceInfo.cl_device_max_work_group_size;
     groupsize = fmin(groupsize, _maxWorkGroupSize);
@@ -410,21 +482,45 @@ cl_int CLScalarField::_initializeChunkDimensions() {
 
     return CL_SUCCESS;
 }
+#endif
 
 bool CLScalarField::isUsingGPU() {
-    if (!_isInitialized) {
+    if (!_isInitialized || _isUsingNative) {
         return false;
     }
+#if WITH_OPENCL
     return _deviceInfo.device_type == CL_DEVICE_TYPE_GPU;
+#else
+    return false;
+#endif
 }
 
 bool CLScalarField::isUsingCPU() {
-    if (!_isInitialized) {
+    if (!_isInitialized || _isUsingNative) {
         return false;
     }
+#if WITH_OPENCL
     return _deviceInfo.device_type == CL_DEVICE_TYPE_CPU;
+#else
+    return false;
+#endif
+}
+
+bool CLScalarField::isUsingNative() {
+    return _isInitialized && _isUsingNative;
+}
+
+void CLScalarField::_initializeNativeBackend() {
+    _chunkWidth = _nativeChunkWidth;
+    _chunkHeight = _nativeChunkWidth;
+    _chunkDepth = _nativeChunkWidth;
+    _workGroupSize = _chunkWidth * _chunkHeight * _chunkDepth;
+
+    _isUsingNative = true;
+    _isInitialized = true;
 }
 
+#if WITH_OPENCL
 void CLScalarField::_checkError(cl_int err, const char * name) {
     if (err != CL_SUCCESS) {
         std::cerr << "ERROR: " << name  << " (" << err << ")" << std::endl;
@@ -580,6 +676,7 @@ cl_int CLScalarField::_initializeCLCommandQueue() {
 
     return CL_SUCCESS;
 }
+#endif
 
 /*  
     The scalarfield.cl kernels calculate field values at cell centers. We want
@@ -833,6 +930,7 @@ void CLScalarField::_insertParticlesIntoWorkGroupGrid(std::vector<PointValue> &p
 }
 
 
+#if WITH_OPENCL
 bool CLScalarField::_compareWorkChunkByNumParticles(const WorkChunk &c1, const WorkChunk &c2) {
     return c1.particlesEnd - c1.particlesBegin < c2.particlesEnd - c2.particlesBegin;
 }
@@ -1333,6 +1431,8 @@ void CLScalarField::_setWeightPointValueComputationOutputFieldData(std::vector<f
     }
 }
 
+#endif
+
 void CLScalarField::_updateWorkGroupMinimumValues(Array3d<WorkGroup> &grid) {
     WorkGroup *g;
     for (int k = 0; k < grid.depth; k++) {
@@ -1361,4 +1461,162 @@ float CLScalarField::_getWorkGroupMinimumValue(WorkGroup *g) {
     return minval;
 }
 
+/*
+    The native backend computes the scalar field on the host. Each work group
+    covers a unique chunk of the field, so every work group is computed 
+    entirely by a single thread and no synchronization is needed when
+    writing field values.
+*/
+void CLScalarField::_computeScalarFieldNative(Array3d<WorkGroup> &workGroupGrid,
+                                              bool isPointValueField,
+                                              bool isWeightField) {
+    std::vector<WorkGroup*> groups;
+    WorkGroup *group;
+    for (int k = 0; k < workGroupGrid.depth; k++) {
+        for (int j = 0; j < workGroupGrid.height; j++) {
+            for (int i = 0; i < workGroupGrid.width; i++) {
+                group = workGroupGrid.getPointer(i, j, k);
+                if (group->particles.size() > 0) {
+                    groups.push_back(group);
+                }
+            }
+        }
+    }
+
+    if (groups.empty()) {
+        return;
+    }
+
+    // Work groups are distributed to threads in a round robin order. Sorting 
+    // by decreasing particle count keeps the load balanced between threads.
+    std::sort(groups.begin(), groups.end(), _compareWorkGroupByNumParticles);
+
+    int numthreads = (int)fmin(ThreadUtils::getMaxThreadCount(), groups.size());
+    std::vector<std::thread> threads(numthreads);
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&CLScalarField::_computeWorkGroupsNativeThread, this,
+                                 &groups, i, numthreads, 
+                                 isPointValueField, isWeightField);
+    }
+
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
+}
+
+bool CLScalarField::_compareWorkGroupByNumParticles(const WorkGroup *g1, 
+                                                    const WorkGroup *g2) {
+    return g1->particles.size() > g2->particles.size();
+}
+
+void CLScalarField::_computeWorkGroupsNativeThread(std::vector<WorkGroup*> *groups,
+                                                   int startidx, int stride,
+                                                   bool isPointValueField,
+                                                   bool isWeightField) {
+    int numCells = _chunkWidth * _chunkHeight * _chunkDepth;
+    std::vector<float> scalarData(numCells, 0.0f);
+    std::vector<float> weightData;
+    if (isWeightField) {
+        weightData.assign(numCells, 0.0f);
+    }
+
+    WorkGroup *group;
+    for (unsigned int gidx = startidx; gidx < groups->size(); gidx += stride) {
+        group = groups->at(gidx);
+
+        if (_isMaxScalarFieldValueThresholdSet && 
+                _getWorkGroupMinimumValue(group) >= _maxScalarFieldValueThreshold) {
+            continue;
+        }
+
+        std::fill(scalarData.begin(), scalarData.end(), 0.0f);
+        if (isWeightField) {
+            std::fill(weightData.begin(), weightData.end(), 0.0f);
+        }
+
+        _computeWorkGroupNative(group, isPointValueField, isWeightField,
+                                scalarData, weightData);
+
+        ArrayView3d<float> fieldview = group->fieldview;
+        ArrayView3d<float> weightfieldview = group->weightfieldview;
+        int dataidx = 0;
+        for (int k = 0; k < fieldview.depth; k++) {
+            for (int j = 0; j < fieldview.height; j++) {
+                for (int i = 0; i < fieldview.width; i++) {
+                    fieldview.add(i, j, k, scalarData[dataidx]);
+                    if (isWeightField) {
+                        weightfieldview.add(i, j, k, weightData[dataidx]);
+                    }
+                    dataidx++;
+                }
+            }
+        }
+    }
+}
+
+/*
+    Evaluates the same kernel as scalarfield.cl but only visits the cells
+    that lie inside of the radius of each particle.
+*/
+void CLScalarField::_computeWorkGroupNative(WorkGroup *group,
+                                            bool isPointValueField,
+                                            bool isWeightField,
+                                            std::vector<float> &scalarData,
+                                            std::vector<float> &weightData) {
+    float r = (float)_radius;
+    float dx = (float)_dx;
+    float invdx = 1.0f / dx;
+    float maxrsq = r * r;
+    float coef1 = (4.0f / 9.0f) * (1.0f / (r*r*r*r*r*r));
+    float coef2 = (17.0f / 9.0f) * (1.0f / (r*r*r*r));
+    float coef3 = (22.0f / 9.0f) * (1.0f / (r*r));
+
+    GridIndex offset = group->indexOffset;
+    int cw = _chunkWidth;
+    int ch = _chunkHeight;
+    int cd = _chunkDepth;
+
+    vmath::vec3 p;
+    float value, kern, rsq, cx, cy, cz, dxsq, dysq;
+    for (unsigned int pidx = 0; pidx < group->particles.size(); pidx++) {
+        p = group->particles[pidx].position;
+        value = isPointValueField ? group->particles[pidx].value : 1.0f;
+
+        // Cell centers lie at (index + 0.5) * dx in internal coordinates
+        int imin = (int)fmax(floor((p.x - r) * invdx - 0.5f) - offset.i, 0);
+        int jmin = (int)fmax(floor((p.y - r) * invdx - 0.5f) - offset.j, 0);
+        int kmin = (int)fmax(floor((p.z - r) * invdx - 0.5f) - offset.k, 0);
+        int imax = (int)fmin(ceil((p.x + r) * invdx - 0.5f) - offset.i, cw - 1);
+        int jmax = (int)fmin(ceil((p.y + r) * invdx - 0.5f) - offset.j, ch - 1);
+        int kmax = (int)fmin(ceil((p.z + r) * invdx - 0.5f) - offset.k, cd - 1);
+
+        for (int k = kmin; k <= kmax; k++) {
+            cz = ((float)(offset.k + k) + 0.5f) * dx - p.z;
+            for (int j = jmin; j <= jmax; j++) {
+                cy = ((float)(offset.j + j) + 0.5f) * dx - p.y;
+                dysq = cy*cy + cz*cz;
+                if (dysq >= maxrsq) {
+                    continue;
+                }
+
+                int flatidx = imin + cw * (j + ch * k);
+                for (int i = imin; i <= imax; i++, flatidx++) {
+                    cx = ((float)(offset.i + i) + 0.5f) * dx - p.x;
+                    dxsq = cx*cx;
+                    rsq = dxsq + dysq;
+                    if (rsq >= maxrsq) {
+                        continue;
+                    }
+
+                    kern = 1.0f - coef1*rsq*rsq*rsq + coef2*rsq*rsq - coef3*rsq;
+                    scalarData[flatidx] += value * kern;
+                    if (isWeightField) {
+                        weightData[flatidx] += kern;
+                    }
+                }
+            }
+        }
+    }
+}
+
 #pragma GCC diagnostic pop
\ No newline at end of file
@@ -24,16 +24,25 @@ freely, subject to the following restrictions:
 #ifndef CLSCALARFIELD_H
 #define CLSCALARFIELD_H
 
-#if defined(__APPLE__) || defined(__MACOSX)
-    #include <OpenCL/cl.hpp>
-#else
-    #include <CL/cl.hpp>
+// Build with WITH_OPENCL=0 to compile without the OpenCL library. Scalar
+// fields will then always be computed with the native backend.
+#ifndef WITH_OPENCL
+    #define WITH_OPENCL 1
+#endif
+
+#if WITH_OPENCL
+    #if defined(__APPLE__) || defined(__MACOSX)
+        #include <OpenCL/cl.hpp>
+    #else
+        #include <CL/cl.hpp>
+    #endif
 #endif
 
 #include <vector>
 #include <fstream>
 #include <algorithm>
 #include <string>
+#include <thread>
 
 #include "macvelocityfield.h"
 #include "implicitsurfacescalarfield.h"
@@ -42,6 +51,7 @@ freely, subject to the following restrictions:
 #include "grid3d.h"
 #include "collision.h"
 #include "stopwatch.h"
+#include "threadutils.h"
 
 class CLScalarField
 {
@@ -93,13 +103,16 @@ public:
     void setDevicePreference(std::string devtype);
     void setDevicePreferenceGPU();
     void setDevicePreferenceCPU();
+    void setDevicePreferenceNative();
 
     void printDeviceInfo();
     bool isUsingGPU();
     bool isUsingCPU();
+    bool isUsingNative();
 
 private:
 
+#if WITH_OPENCL
     struct CLDeviceInfo {
         std::string cl_device_name;
         std::string cl_device_vendor;
@@ -125,6 +138,7 @@ private:
         cl::Buffer scalarFieldDataCL;
         cl::Buffer offsetDataCL;
     };
+#endif
 
     struct PointValue {
         PointValue() {}
@@ -153,15 +167,6 @@ private:
         std::vector<PointValue>::iterator particlesEnd;
     };
 
-    void _checkError(cl_int err, const char * name);
-    cl::Context _getCLContext(cl_int *err);
-    cl::Device _getCLDevice(cl::Context &context, cl_int *err);
-    CLDeviceInfo _initializeDeviceInfo(cl::Device &device);
-    cl_int _initializeChunkDimensions();
-    cl_int _initializeCLKernels();
-    std::string _getProgramString(std::string filename);
-    cl_int _initializeCLCommandQueue();
-
     vmath::vec3 _getInternalOffset();
     void _initializePointValues(std::vector<vmath::vec3> &points,
                                 std::vector<PointValue> &pvs);
@@ -187,6 +192,35 @@ private:
                                      Array3d<int> &countGrid);
     void _insertParticlesIntoWorkGroupGrid(std::vector<PointValue> &points,
                                            Array3d<WorkGroup> &grid);
+    void _updateWorkGroupMinimumValues(Array3d<WorkGroup> &grid);
+    float _getWorkGroupMinimumValue(WorkGroup *g);
+
+    void _initializeNativeBackend();
+    void _computeScalarFieldNative(Array3d<WorkGroup> &workGroupGrid,
+                                   bool isPointValueField,
+                                   bool isWeightField);
+    static bool _compareWorkGroupByNumParticles(const WorkGroup *g1, 
+                                                const WorkGroup *g2);
+    void _computeWorkGroupsNativeThread(std::vector<WorkGroup*> *groups,
+                                        int startidx, int stride,
+                                        bool isPointValueField,
+                                        bool isWeightField);
+    void _computeWorkGroupNative(WorkGroup *group,
+                                 bool isPointValueField,
+                                 bool isWeightField,
+                                 std::vector<float> &scalarData,
+                                 std::vector<float> &weightData);
+
+#if WITH_OPENCL
+    void _checkError(cl_int err, const char * name);
+    cl::Context _getCLContext(cl_int *err);
+    cl::Device _getCLDevice(cl::Context &context, cl_int *err);
+    CLDeviceInfo _initializeDeviceInfo(cl::Device &device);
+    cl_int _initializeChunkDimensions();
+    cl_int _initializeCLKernels();
+    std::string _getProgramString(std::string filename);
+    cl_int _initializeCLCommandQueue();
+
     void _initializeWorkChunks(Array3d<WorkGroup> &grid,
                                std::vector<WorkChunk> &chunks);
     void _getWorkChunksFromWorkGroup(WorkGroup *group, 
@@ -264,11 +298,13 @@ private:
     void _setWeightPointValueComputationOutputFieldData(std::vector<float> &buffer, 
                                                         std::vector<WorkChunk> &chunks,
                                                         Array3d<WorkGroup> &workGroupGrid);
-    void _updateWorkGroupMinimumValues(Array3d<WorkGroup> &grid);
-    float _getWorkGroupMinimumValue(WorkGroup *g);
+#endif
 
     bool _isInitialized = false;
+    bool _isNativeDevicePreferred = false;
+    bool _isUsingNative = false;
 
+#if WITH_OPENCL
     cl_device_type _devicePreference1 = CL_DEVICE_TYPE_GPU;
     cl_device_type _devicePreference2 = CL_DEVICE_TYPE_CPU;
 
@@ -279,6 +315,7 @@ private:
     cl::Kernel _CLKernelPointValues;
     cl::Kernel _CLKernelWeightPointValues;
     cl::CommandQueue _CLQueue;
+#endif
 
     int _isize = 0;
     int _jsize = 0;
@@ -298,6 +335,7 @@ private:
     int _minWorkGroupSize = 32;
     int _maxParticlesPerChunk = 1000;
     int _maxChunksPerComputation = 5000;
+    int _nativeChunkWidth = 8;
 
     bool _isMaxScalarFieldValueThresholdSet = false;
     float _maxScalarFieldValueThreshold = 1.0;
@@ -26,7 +26,7 @@ DiffuseParticleSimulation::~DiffuseParticleSimulation() {
 }
 
 void DiffuseParticleSimulation::update(int isize, int jsize, int ksize, double dx,
-                                       FragmentedVector<MarkerParticle> *markerParticles,
+                                       MarkerParticleVector *markerParticles,
                                        MACVelocityField *vfield,
                                        LevelSet *levelset,
                                        FluidMaterialGrid *mgrid,
@@ -197,7 +197,7 @@ void DiffuseParticleSimulation::
     vmath::vec3 p;
     double width = _diffuseSurfaceNarrowBandSize * _dx;
     for (unsigned int i = 0; i < _markerParticles->size(); i++) {
-        p = _markerParticles->at(i).position;
+        p = _markerParticles->getPosition(i);
         if (_levelset->getDistance(p) < width) {
             surface.push_back(p);
         } else if (_levelset->isPointInInsideCell(p)) {
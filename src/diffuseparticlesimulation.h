@@ -30,6 +30,7 @@ freely, subject to the following restrictions:
 #include "turbulencefield.h"
 #include "particleadvector.h"
 #include "markerparticle.h"
+#include "markerparticlevector.h"
 #include "diffuseparticle.h"
 #include "vmath.h"
 #include "grid3d.h"
@@ -43,7 +44,7 @@ public:
 	~DiffuseParticleSimulation();
 
 	void update(int isize, int jsize, int ksize, double dx,
-              FragmentedVector<MarkerParticle> *markerParticles,
+              MarkerParticleVector *markerParticles,
               MACVelocityField *vfield,
               LevelSet *levelset,
               FluidMaterialGrid *mgrid,
@@ -189,7 +190,7 @@ private:
     double _bubbleDragCoefficient = 1.0;
     int _maxDiffuseParticlesPerCell = 250;
 
-    FragmentedVector<MarkerParticle> *_markerParticles;
+    MarkerParticleVector *_markerParticles;
     MACVelocityField *_vfield;
     LevelSet *_levelset;
     FluidMaterialGrid *_materialGrid;
@@ -0,0 +1,107 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include <iostream>
+#include <stdlib.h>
+
+#include "../array3d.h"
+#include "../grid3d.h"
+#include "../gridlayout.h"
+#include "../stopwatch.h"
+
+/*
+    Averages the 6, 26 and 124 cell neighbourhoods of every cell in a grid,
+    the stencils used by the pressure solver, velocity advection and the
+    turbulence field. Returns the time in seconds of each stencil pass.
+*/
+template <class Layout>
+void _benchmarkGridLayoutStencils(int n, int passes, double times[3]) {
+    Array3d<float, Layout> field(n, n, n);
+    Array3d<float, Layout> result(n, n, n, 0.0f);
+    srand(0);
+    for (int k = 0; k < n; k++) {
+        for (int j = 0; j < n; j++) {
+            for (int i = 0; i < n; i++) {
+                field.set(i, j, k, (float)rand() / (float)RAND_MAX);
+            }
+        }
+    }
+
+    GridIndex nbs6[6];
+    GridIndex nbs26[26];
+    GridIndex nbs124[124];
+    int counts[3] = {6, 26, 124};
+    GridIndex *nbs[3] = {nbs6, nbs26, nbs124};
+    int pad[3] = {1, 1, 2};
+
+    for (int sidx = 0; sidx < 3; sidx++) {
+        StopWatch timer;
+        timer.start();
+        for (int pass = 0; pass < passes; pass++) {
+            for (int k = pad[sidx]; k < n - pad[sidx]; k++) {
+                for (int j = pad[sidx]; j < n - pad[sidx]; j++) {
+                    for (int i = pad[sidx]; i < n - pad[sidx]; i++) {
+                        if (sidx == 0) {
+                            Grid3d::getNeighbourGridIndices6(i, j, k, nbs6);
+                        } else if (sidx == 1) {
+                            Grid3d::getNeighbourGridIndices26(i, j, k, nbs26);
+                        } else {
+                            Grid3d::getNeighbourGridIndices124(i, j, k, nbs124);
+                        }
+
+                        float sum = 0.0f;
+                        for (int nidx = 0; nidx < counts[sidx]; nidx++) {
+                            sum += field(nbs[sidx][nidx]);
+                        }
+                        result.set(i, j, k, sum / (float)counts[sidx]);
+                    }
+                }
+            }
+        }
+        timer.stop();
+        times[sidx] = timer.getTime();
+    }
+}
+
+void example_grid_layout_benchmark() {
+
+    // This example will time the neighbourhood stencils of the
+    // simulation on grids stored in each memory layout. The
+    // layout of the simulation grids is chosen at compile time
+    // with GRID_LAYOUT (CMake) or LAYOUT (Makefile).
+
+    int n = 256;
+    int passes = 1;
+
+    double rowmajor[3], morton[3], bricked[3];
+    _benchmarkGridLayoutStencils<RowMajorLayout>(n, passes, rowmajor);
+    _benchmarkGridLayoutStencils<MortonLayout>(n, passes, morton);
+    _benchmarkGridLayoutStencils<BrickedLayout>(n, passes, bricked);
+
+    std::string names[3] = {"6 neighbours:   ",
+                            "26 neighbours:  ",
+                            "124 neighbours: "};
+    std::cout << "Grid " << n << "^3, " << passes << " passes (seconds)" << std::endl;
+    std::cout << "                RowMajor\tMorton\t\tBricked" << std::endl;
+    for (int i = 0; i < 3; i++) {
+        std::cout << names[i] << rowmajor[i] << "\t" <<
+                                 morton[i] << "\t" <<
+                                 bricked[i] << std::endl;
+    }
+}
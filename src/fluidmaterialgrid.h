@@ -24,6 +24,7 @@ freely, subject to the following restrictions:
 #include <vector>
 
 #include "subdividedarray3d.h"
+#include "sparsearray3d.h"
 #include "grid3d.h"
 #include "gridindexvector.h"
 
@@ -109,7 +110,11 @@ public:
 
 private: 
 
-    SubdividedArray3d<Material> _grid;
+    /*
+        Air is the background value of the sparse grid, so only the tiles 
+        that contain fluid or solid cells are allocated.
+    */
+    SubdividedArray3d<Material, RowMajorLayout, SparseArray3d<Material> > _grid;
 
 
 };
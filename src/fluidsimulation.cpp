@@ -153,6 +153,15 @@ void FluidSimulation::setNumSurfaceReconstructionPolygonizerSlices(int n) {
     _numSurfaceReconstructionPolygonizerSlices = n;
 }
 
+void FluidSimulation::setMaxSurfaceReconstructionPolygonizerSlicesInFlight(int n) {
+    if (n < 1) {
+        _printError("ERROR: number of polygonizer slices in flight must be greater than or equal to 1\n");
+        std::cerr << "polygonizer slices in flight: " << n << std::endl;
+    }
+    assert(n >= 1);
+    _maxSurfaceReconstructionPolygonizerSlicesInFlight = n;
+}
+
 void FluidSimulation::setMinimumPolyhedronTriangleCount(int n) {
     if (n < 1) {
         _printError("ERROR: minimum polyhedron triangle count must be greater than or equal to 0\n");
@@ -399,6 +408,79 @@ bool FluidSimulation::isAutosaveEnabled() {
     return _isAutosaveEnabled;
 }
 
+void FluidSimulation::enableMultigridPressurePreconditioner() {
+    _isMultigridPressurePreconditionerEnabled = true;
+}
+
+void FluidSimulation::disableMultigridPressurePreconditioner() {
+    _isMultigridPressurePreconditionerEnabled = false;
+}
+
+bool FluidSimulation::isMultigridPressurePreconditionerEnabled() {
+    return _isMultigridPressurePreconditionerEnabled;
+}
+
+void FluidSimulation::enablePressureWarmStart() {
+    _isPressureWarmStartEnabled = true;
+}
+
+void FluidSimulation::disablePressureWarmStart() {
+    _isPressureWarmStartEnabled = false;
+}
+
+bool FluidSimulation::isPressureWarmStartEnabled() {
+    return _isPressureWarmStartEnabled;
+}
+
+void FluidSimulation::enableMixedPrecisionPressureSolve() {
+    _isMixedPrecisionPressureSolveEnabled = true;
+}
+
+void FluidSimulation::disableMixedPrecisionPressureSolve() {
+    _isMixedPrecisionPressureSolveEnabled = false;
+}
+
+bool FluidSimulation::isMixedPrecisionPressureSolveEnabled() {
+    return _isMixedPrecisionPressureSolveEnabled;
+}
+
+void FluidSimulation::enableFastMarchingLevelSetRedistancing() {
+    _isFastMarchingLevelSetRedistancingEnabled = true;
+}
+
+void FluidSimulation::disableFastMarchingLevelSetRedistancing() {
+    _isFastMarchingLevelSetRedistancingEnabled = false;
+}
+
+bool FluidSimulation::isFastMarchingLevelSetRedistancingEnabled() {
+    return _isFastMarchingLevelSetRedistancingEnabled;
+}
+
+void FluidSimulation::enableAsynchronousBakeFileOutput() {
+    _bakeFileWriter.enableAsynchronousWrites();
+}
+
+void FluidSimulation::disableAsynchronousBakeFileOutput() {
+    _bakeFileWriter.disableAsynchronousWrites();
+}
+
+bool FluidSimulation::isAsynchronousBakeFileOutputEnabled() {
+    return _bakeFileWriter.isAsynchronousWritesEnabled();
+}
+
+void FluidSimulation::setMaxBakeFileOutputQueueSize(int megabytes) {
+    if (megabytes < 0) {
+        _printError("ERROR: bakefile output queue size must be greater than or equal to 0\n");
+        std::cerr << "queue size (MB): " << megabytes << std::endl;
+    }
+    assert(megabytes >= 0);
+    _bakeFileWriter.setMaxQueuedBytes((long long)megabytes * 1048576LL);
+}
+
+void FluidSimulation::flushBakeFileOutput() {
+    _bakeFileWriter.flush();
+}
+
 void FluidSimulation::addBodyForce(double fx, double fy, double fz) { 
     addBodyForce(vmath::vec3(fx, fy, fz)); 
 }
@@ -566,6 +648,7 @@ void FluidSimulation::addSolidCell(int i, int j, int k) {
     assert(isInRange);
 
     _materialGrid.setSolid(i, j, k);
+    _isNearSolidCellMaskValid = false;
 }
 
 void FluidSimulation::addSolidCell(GridIndex g) {
@@ -593,6 +676,7 @@ void FluidSimulation::removeSolidCell(int i, int j, int k) {
 
     if (_materialGrid.isCellSolid(i, j, k)) {
         _materialGrid.setAir(i, j, k);
+        _isNearSolidCellMaskValid = false;
     }
 }
 
@@ -662,7 +746,7 @@ unsigned int FluidSimulation::getNumMarkerParticles() {
 void FluidSimulation::getMarkerParticles(std::vector<MarkerParticle> &mps) {
     mps.reserve(_markerParticles.size());
     for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        mps.push_back(_markerParticles[i]);
+        mps.push_back(_markerParticles.get(i));
     }
 }
 
@@ -678,7 +762,7 @@ std::vector<vmath::vec3> FluidSimulation::getMarkerParticlePositions(int startid
     particles.reserve(endidx - startidx + 1);
 
     for (int i = startidx; i <= endidx; i++) {
-        particles.push_back(_markerParticles[i].position);
+        particles.push_back(_markerParticles.getPosition(i));
     }
 
     return particles;
@@ -696,7 +780,7 @@ std::vector<vmath::vec3> FluidSimulation::getMarkerParticleVelocities(int starti
     velocities.reserve(endidx - startidx + 1);
 
     for (int i = startidx; i <= endidx; i++) {
-        velocities.push_back(_markerParticles[i].velocity);
+        velocities.push_back(_markerParticles.getVelocity(i));
     }
 
     return velocities;
@@ -836,6 +920,8 @@ void FluidSimulation::_initializeSolidCells() {
             _materialGrid.setSolid(_isize-1, j, k);
         }
     }
+
+    _isNearSolidCellMaskValid = false;
 }
 
 void FluidSimulation::_addMarkerParticlesToCell(GridIndex g) {
@@ -866,7 +952,7 @@ void FluidSimulation::_addMarkerParticlesToCell(GridIndex g, vmath::vec3 velocit
                                   _randomDouble(-jitter, jitter));
 
         vmath::vec3 p = points[idx] + jit;
-        _markerParticles.push_back(MarkerParticle(p, velocity));
+        _markerParticles.push_back(p, velocity);
     }
 }
 
@@ -878,7 +964,7 @@ void FluidSimulation::_addMarkerParticle(vmath::vec3 p, vmath::vec3 velocity) {
     GridIndex g = Grid3d::positionToGridIndex(p, _dx);
     if (Grid3d::isGridIndexInRange(g, _isize, _jsize, _ksize) &&
         !_materialGrid.isCellSolid(g)) {
-        _markerParticles.push_back(MarkerParticle(p, velocity));
+        _markerParticles.push_back(p, velocity);
     }
 }
 
@@ -976,7 +1062,7 @@ void FluidSimulation::_initializeMarkerParticles(GridIndexVector &fullFluidCells
 void FluidSimulation::_initializeFluidCellIndices() {
     GridIndex g;
     for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        g = Grid3d::positionToGridIndex(_markerParticles[i].position, _dx);
+        g = Grid3d::positionToGridIndex(_markerParticles.getPosition(i), _dx);
         if (!_materialGrid.isCellFluid(g)) {
             _materialGrid.setFluid(g);
             _fluidCellIndices.push_back(g);
@@ -1032,11 +1118,9 @@ void FluidSimulation::_initializeSimulation() {
 }
 
 void FluidSimulation::_initializeFluidMaterialParticlesFromSaveState() {
-    MarkerParticle p;
     GridIndex g;
     for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        p = _markerParticles[i];
-        g = Grid3d::positionToGridIndex(p.position, _dx);
+        g = Grid3d::positionToGridIndex(_markerParticles.getPosition(i), _dx);
         assert(!_materialGrid.isCellSolid(g));
         _materialGrid.setFluid(g);
     }
@@ -1072,7 +1156,7 @@ void FluidSimulation::_initializeMarkerParticlesFromSaveState(
 
         vectors = state.getMarkerParticlePositions(startidx, endidx);
         for (unsigned int i = 0; i < vectors.size(); i++) {
-            _markerParticles.push_back(MarkerParticle(vectors[i]));
+            _markerParticles.push_back(vectors[i]);
         }
 
         numRead += vectors.size();
@@ -1088,7 +1172,7 @@ void FluidSimulation::_initializeMarkerParticlesFromSaveState(
 
         vectors = state.getMarkerParticleVelocities(startidx, endidx);
         for (unsigned int i = 0; i < vectors.size(); i++) {
-            _markerParticles[startidx + i].velocity = vectors[i];
+            _markerParticles.setVelocity(startidx + i, vectors[i]);
         }
 
         numRead += vectors.size();
@@ -1214,6 +1298,7 @@ void FluidSimulation::_initializeSimulationFromSaveState(FluidSimulationSaveStat
 
     _MACVelocity = MACVelocityField(_isize, _jsize, _ksize, _dx);
     _materialGrid = FluidMaterialGrid(_isize, _jsize, _ksize);
+    _isNearSolidCellMaskValid = false;
     _levelset = LevelSet(_isize, _jsize, _ksize, _dx);
     _fluidCellIndices = GridIndexVector(_isize, _jsize, _ksize);
     _addedFluidCellQueue = GridIndexVector(_isize, _jsize, _ksize);
@@ -1252,15 +1337,13 @@ void FluidSimulation::_removeMarkerParticlesFromCells(Array3d<bool> &isRemovalCe
     std::vector<bool> isRemoved;
     isRemoved.reserve(_markerParticles.size());
 
-    MarkerParticle p;
     GridIndex g;
     for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        p = _markerParticles[i];
-        g = Grid3d::positionToGridIndex(p.position, _dx);
+        g = Grid3d::positionToGridIndex(_markerParticles.getPosition(i), _dx);
         isRemoved.push_back(isRemovalCell(g));
     }
 
-    _removeItemsFromVector(_markerParticles, isRemoved);
+    _markerParticles.removeItems(isRemoved);
 }
 
 void FluidSimulation::_removeDiffuseParticlesFromCells(Array3d<bool> &isRemovalCell) {
@@ -1344,8 +1427,9 @@ void FluidSimulation::_getNewFluidParticles(FluidSource *source, std::vector<vma
     vmath::vec3 offset = Grid3d::GridIndexToPosition(gmin, _dx);
     vmath::vec3 p;
     for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        if (bbox.isPointInside(_markerParticles[i].position)) {
-            p = _markerParticles[i].position - offset;
+        p = _markerParticles.getPosition(i);
+        if (bbox.isPointInside(p)) {
+            p = p - offset;
             subg = Grid3d::positionToGridIndex(p, 0.5*_dx);
             newParticleGrid.set(subg, false);
         }
@@ -1425,11 +1509,9 @@ void FluidSimulation::_removeMarkerParticlesInSolidCells() {
     isRemoved.reserve(_markerParticles.size());
 
     bool isParticlesInSolidCell = false;
-    MarkerParticle p;
     GridIndex g;
     for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        p = _markerParticles[i];
-        g = Grid3d::positionToGridIndex(p.position, _dx);
+        g = Grid3d::positionToGridIndex(_markerParticles.getPosition(i), _dx);
 
         bool isInSolidCell = _materialGrid.isCellSolid(g);
         if (isInSolidCell) {
@@ -1440,7 +1522,7 @@ void FluidSimulation::_removeMarkerParticlesInSolidCells() {
     }
 
     if (isParticlesInSolidCell) {
-        _removeItemsFromVector(_markerParticles, isRemoved);
+        _markerParticles.removeItems(isRemoved);
     }
 }
 
@@ -1475,6 +1557,13 @@ void FluidSimulation::_removeParticlesInSolidCells() {
     _removeDiffuseParticlesInSolidCells();
 }
 
+/*
+    The fluid cell list is built from the marker particles alone, so the cost
+    of the update depends on the number of particles and not on the size of
+    the domain. Each thread bins a range of particles into a sorted list of 
+    unique flat cell indices. The thread lists are then merged in order, which
+    keeps _fluidCellIndices sorted by flat index as a full grid scan would.
+*/
 void FluidSimulation::_updateFluidCells() {
     _removeParticlesInSolidCells();
     _updateAddedFluidCellQueue();
@@ -1482,38 +1571,60 @@ void FluidSimulation::_updateFluidCells() {
 
     _materialGrid.setAir(_fluidCellIndices);
     _fluidCellIndices.clear();
-    
-    MarkerParticle p;
+
+    int numParticles = _markerParticles.size();
+    int numthreads = (int)fmax(1, fmin(ThreadUtils::getMaxThreadCount(), 
+                               ceil((double)numParticles / (double)_minParticlesPerThread)));
+    if ((int)_threadFluidCells.size() < numthreads) {
+        _threadFluidCells.resize(numthreads);
+    }
+
+    std::vector<int> intervals = ThreadUtils::splitRangeIntoIntervals(0, numParticles, 
+                                                                      numthreads);
+    std::vector<std::thread> threads(numthreads);
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&FluidSimulation::_findFluidCellsThread, this,
+                                 intervals[i], intervals[i + 1], i);
+    }
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
+
+    _mergeFluidCells(numthreads);
+    _fluidCellIndices.insertFlatIndices(_fluidCellFlatIndices);
+    _materialGrid.setFluid(_fluidCellIndices);
+}
+
+void FluidSimulation::_findFluidCellsThread(int startidx, int endidx, int threadidx) {
+    std::vector<int> *cells = &(_threadFluidCells[threadidx]);
+    cells->clear();
+
     GridIndex g;
-    for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        p = _markerParticles[i];
-        g = Grid3d::positionToGridIndex(p.position, _dx);
+    for (int i = startidx; i < endidx; i++) {
+        g = Grid3d::positionToGridIndex(_markerParticles.getPosition(i), _dx);
         assert(!_materialGrid.isCellSolid(g));
-        _materialGrid.setFluid(g);
+        cells->push_back(Grid3d::getFlatIndex(g, _isize, _jsize));
     }
 
-    int count = 0;
-    for (int k = 0; k < _materialGrid.depth; k++) {
-        for (int j = 0; j < _materialGrid.height; j++) {
-            for (int i = 0; i < _materialGrid.width; i++) {
-                if (_materialGrid.isCellFluid(i, j, k)) {
-                    count++;
-                }
-            }
-        }
-    }
+    std::sort(cells->begin(), cells->end());
+    cells->erase(std::unique(cells->begin(), cells->end()), cells->end());
+}
 
-    _fluidCellIndices.reserve(count);
-    for (int k = 0; k < _materialGrid.depth; k++) {
-        for (int j = 0; j < _materialGrid.height; j++) {
-            for (int i = 0; i < _materialGrid.width; i++) {
-                if (_materialGrid.isCellFluid(i, j, k)) {
-                    _fluidCellIndices.push_back(i, j, k);
-                }
-            }
-        }
+void FluidSimulation::_mergeFluidCells(int numthreads) {
+    _fluidCellFlatIndices.clear();
+    for (int i = 0; i < numthreads; i++) {
+        std::vector<int> *cells = &(_threadFluidCells[i]);
+        int offset = _fluidCellFlatIndices.size();
+        _fluidCellFlatIndices.insert(_fluidCellFlatIndices.end(), cells->begin(), cells->end());
+        std::inplace_merge(_fluidCellFlatIndices.begin(), 
+                           _fluidCellFlatIndices.begin() + offset, 
+                           _fluidCellFlatIndices.end());
     }
 
+    // Cells on thread range boundaries may be found by more than one thread
+    _fluidCellFlatIndices.erase(std::unique(_fluidCellFlatIndices.begin(), 
+                                            _fluidCellFlatIndices.end()),
+                                _fluidCellFlatIndices.end());
 }
 
 /********************************************************************************
@@ -1564,6 +1675,12 @@ void FluidSimulation::_updateLevelSetSignedDistanceField() {
         return;
     }
 
+    if (_isFastMarchingLevelSetRedistancingEnabled) {
+        _levelset.enableFastMarchingRedistancing();
+    } else {
+        _levelset.disableFastMarchingRedistancing();
+    }
+
     _levelset.setSurfaceMesh(_surfaceMesh);
     int numLayers = _CFLConditionNumber + 2;
     _levelset.calculateSignedDistanceField(numLayers);
@@ -1600,13 +1717,13 @@ void FluidSimulation::_writeDiffuseMaterialToFile(std::string bubblefile,
     }
 
     if (_isBubbleDiffuseMaterialEnabled) {
-        bubbleMesh.writeMeshToPLY(bubblefile);
+        _bakeFileWriter.writeMeshToPLY(bubbleMesh, bubblefile);
     }
     if (_isFoamDiffuseMaterialEnabled) {
-        foamMesh.writeMeshToPLY(foamfile);
+        _bakeFileWriter.writeMeshToPLY(foamMesh, foamfile);
     }
     if (_isSprayDiffuseMaterialEnabled) {
-        sprayMesh.writeMeshToPLY(sprayfile);
+        _bakeFileWriter.writeMeshToPLY(sprayMesh, sprayfile);
     }
 }
 
@@ -1629,13 +1746,13 @@ void FluidSimulation::_writeDiffuseMaterialToFile(std::string diffusefile) {
         }
     }
 
-    diffuseMesh.writeMeshToPLY(diffusefile);
+    _bakeFileWriter.writeMeshToPLY(diffuseMesh, diffusefile);
 }
 
-void FluidSimulation::_writeBrickColorListToFile(TriangleMesh &mesh, 
-                                                     std::string filename) {
+void FluidSimulation::_getBrickColorListFileData(TriangleMesh &mesh, 
+                                                 std::vector<char> &data) {
     int binsize = 3*sizeof(int)*mesh.vertexcolors.size();
-    char *storage = new char[binsize];
+    data = std::vector<char>(binsize);
 
     int *colordata = new int[3*mesh.vertexcolors.size()];
     vmath::vec3 c;
@@ -1645,22 +1762,14 @@ void FluidSimulation::_writeBrickColorListToFile(TriangleMesh &mesh,
         colordata[3*i + 1] = (int)(c.y*255.0);
         colordata[3*i + 2] = (int)(c.z*255.0);
     }
-    memcpy(storage, colordata, 3*sizeof(int)*mesh.vertexcolors.size());
+    if (binsize > 0) {
+        memcpy(&(data[0]), colordata, binsize);
+    }
     delete[] colordata;
-    
-    std::ofstream erasefile;
-    erasefile.open(filename, std::ofstream::out | std::ofstream::trunc);
-    erasefile.close();
-
-    std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary);
-    file.write(storage, binsize);
-    file.close();
-
-    delete[] storage;
 }
 
-void FluidSimulation::_writeBrickTextureToFile(TriangleMesh &mesh, 
-                                               std::string filename) {
+void FluidSimulation::_getBrickTextureFileData(TriangleMesh &mesh, 
+                                               std::vector<char> &data) {
 
     int bisize, bjsize, bksize;
     _fluidBrickGrid.getBrickGridDimensions(&bisize, &bjsize, &bksize);
@@ -1685,27 +1794,17 @@ void FluidSimulation::_writeBrickTextureToFile(TriangleMesh &mesh,
     }
     
     int binsize = sizeof(unsigned char)*bisize*bjsize*bksize;
-    unsigned char *storage = new unsigned char[binsize];
+    data = std::vector<char>(binsize);
 
     int offset = 0;
     for (int k = 0; k < colorGrid.depth; k++) {
         for (int j = 0; j < colorGrid.height; j++) {
             for (int i = 0; i < colorGrid.width; i++) {
-                storage[offset] = colorGrid(i, j, k);
+                data[offset] = (char)colorGrid(i, j, k);
                 offset++;
             }
         }
     }
-    
-    std::ofstream erasefile;
-    erasefile.open(filename, std::ofstream::out | std::ofstream::trunc);
-    erasefile.close();
-
-    std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary);
-    file.write((char*)storage, binsize);
-    file.close();
-
-    delete[] storage;
 }
 
 void FluidSimulation::_writeBrickMaterialToFile(std::string brickfile,
@@ -1714,9 +1813,14 @@ void FluidSimulation::_writeBrickMaterialToFile(std::string brickfile,
     TriangleMesh brickmesh;
     _fluidBrickGrid.getBrickMesh(_levelset, brickmesh);
 
-    brickmesh.writeMeshToPLY(brickfile);
-    _writeBrickColorListToFile(brickmesh, colorfile);
-    _writeBrickTextureToFile(brickmesh, texturefile);
+    std::vector<char> colordata;
+    std::vector<char> texturedata;
+    _getBrickColorListFileData(brickmesh, colordata);
+    _getBrickTextureFileData(brickmesh, texturedata);
+
+    _bakeFileWriter.writeMeshToPLY(brickmesh, brickfile);
+    _bakeFileWriter.writeDataToFile(colordata, colorfile);
+    _bakeFileWriter.writeDataToFile(texturedata, texturefile);
 }
 
 std::string FluidSimulation::_numberToString(int number) {
@@ -1733,11 +1837,12 @@ void FluidSimulation::_writeSurfaceMeshToFile(TriangleMesh &isomesh,
 
     if (_isSurfaceMeshOutputEnabled) {
         if (_isIsotropicSurfaceMeshReconstructionEnabled) {
-            isomesh.writeMeshToPLY("bakefiles/" + currentFrame + ".ply");
+            _bakeFileWriter.writeMeshToPLY(isomesh, "bakefiles/" + currentFrame + ".ply");
         }
 
         if (_isAnisotropicSurfaceMeshReconstructionEnabled) {
-            anisomesh.writeMeshToPLY("bakefiles/anisotropic" + currentFrame + ".ply");
+            _bakeFileWriter.writeMeshToPLY(anisomesh, 
+                                           "bakefiles/anisotropic" + currentFrame + ".ply");
         }
     }
 
@@ -1762,7 +1867,8 @@ void FluidSimulation::_writeSurfaceMeshToFile(TriangleMesh &isomesh,
     }
 }
 
-bool FluidSimulation::_isVertexNearSolid(vmath::vec3 v, double eps) {
+bool FluidSimulation::_isVertexNearSolid(vmath::vec3 v, double eps,
+                                         Array3d<bool> &nearSolidCells) {
     GridIndex g = Grid3d::positionToGridIndex(v, _dx);
     if (_materialGrid.isCellSolid(g)) {
         return true;
@@ -1784,7 +1890,12 @@ bool FluidSimulation::_isVertexNearSolid(vmath::vec3 v, double eps) {
         }
     }
 
-    // is v near a solid cell?
+    // is v near a solid cell? The points tested below can only fall in
+    // g or one of its 26 neighbours.
+    if (!nearSolidCells(g)) {
+        return false;
+    }
+
     vmath::vec3 gp = Grid3d::GridIndexToPosition(g, _dx);
     AABB bbox = AABB(gp + e, gp + vmath::vec3(_dx, _dx, _dx) - e);
     if (bbox.isPointInside(v)) {
@@ -1813,14 +1924,137 @@ bool FluidSimulation::_isVertexNearSolid(vmath::vec3 v, double eps) {
     return false;
 }
 
+/*
+    Marks each cell that is solid or has a solid cell among its 26 
+    neighbours. The 3x3x3 dilation is separable, so it is applied as 
+    three passes over rows of the grid along each axis.
+
+    The mask and its dilation buffer are kept between frames and are only 
+    rebuilt after solid cells have been added or removed.
+*/
+void FluidSimulation::_updateNearSolidCellMask() {
+    if (_isNearSolidCellMaskValid) {
+        return;
+    }
+
+    if (_nearSolidCellMask.width != _isize || 
+            _nearSolidCellMask.height != _jsize || 
+            _nearSolidCellMask.depth != _ksize) {
+        _nearSolidCellMask = Array3d<bool>(_isize, _jsize, _ksize, false);
+        _nearSolidCellMaskBuffer = Array3d<bool>(_isize, _jsize, _ksize, false);
+    } else {
+        _nearSolidCellMask.fill(false);
+    }
+
+    int numthreads = (int)fmin(ThreadUtils::getMaxThreadCount(), _ksize);
+    numthreads = (int)fmax(numthreads, 1);
+    std::vector<int> intervals = ThreadUtils::splitRangeIntoIntervals(0, _ksize, numthreads);
+    std::vector<std::thread> threads(numthreads);
+
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&FluidSimulation::_findSolidCellsThread, this,
+                                 intervals[i], intervals[i + 1], &_nearSolidCellMask);
+    }
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
+
+    // An odd number of passes leaves the result in the buffer. The two
+    // grids are swapped so that no copy is made.
+    Array3d<bool> *src = &_nearSolidCellMask;
+    Array3d<bool> *dst = &_nearSolidCellMaskBuffer;
+    for (int dir = 0; dir < 3; dir++) {
+        for (int i = 0; i < numthreads; i++) {
+            threads[i] = std::thread(&FluidSimulation::_dilateCellMaskThread, this,
+                                     intervals[i], intervals[i + 1], dir, src, dst);
+        }
+        for (int i = 0; i < numthreads; i++) {
+            threads[i].join();
+        }
+        std::swap(src, dst);
+    }
+
+    if (src != &_nearSolidCellMask) {
+        std::swap(_nearSolidCellMask, _nearSolidCellMaskBuffer);
+    }
+
+    _isNearSolidCellMaskValid = true;
+}
+
+void FluidSimulation::_findSolidCellsThread(int startk, int endk, Array3d<bool> *cells) {
+    for (int k = startk; k < endk; k++) {
+        for (int j = 0; j < _jsize; j++) {
+            for (int i = 0; i < _isize; i++) {
+                if (_materialGrid.isCellSolid(i, j, k)) {
+                    cells->set(i, j, k, true);
+                }
+            }
+        }
+    }
+}
+
+void FluidSimulation::_dilateCellMaskThread(int startk, int endk, int dir,
+                                            Array3d<bool> *src, Array3d<bool> *dst) {
+    GridIndex offset(dir == 0 ? 1 : 0, dir == 1 ? 1 : 0, dir == 2 ? 1 : 0);
+    int size = dir == 0 ? _isize : (dir == 1 ? _jsize : _ksize);
+    for (int k = startk; k < endk; k++) {
+        for (int j = 0; j < _jsize; j++) {
+            for (int i = 0; i < _isize; i++) {
+                int n = dir == 0 ? i : (dir == 1 ? j : k);
+                bool isSet = src->get(i, j, k);
+                if (n > 0) {
+                    isSet = isSet || src->get(i - offset.i, j - offset.j, k - offset.k);
+                }
+                if (n < size - 1) {
+                    isSet = isSet || src->get(i + offset.i, j + offset.j, k + offset.k);
+                }
+                dst->set(i, j, k, isSet);
+            }
+        }
+    }
+}
+
 void FluidSimulation::_getSmoothVertices(TriangleMesh &mesh,
                                          std::vector<int> &smoothVertices) {
+    int numVertices = (int)mesh.vertices.size();
+    if (numVertices == 0) {
+        return;
+    }
+
+    _updateNearSolidCellMask();
+
+    int numthreads = (int)fmin(ThreadUtils::getMaxThreadCount(), 
+                               ceil((double)numVertices / (double)_minVerticesPerThread));
+    numthreads = (int)fmax(numthreads, 1);
+
+    std::vector<std::vector<int> > threadVertices(numthreads);
+    std::vector<std::thread> threads(numthreads);
+    std::vector<int> intervals = ThreadUtils::splitRangeIntoIntervals(0, numVertices, numthreads);
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&FluidSimulation::_getSmoothVerticesThread, this,
+                                 intervals[i], intervals[i + 1], &mesh, 
+                                 &_nearSolidCellMask, &(threadVertices[i]));
+    }
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
+
+    for (int i = 0; i < numthreads; i++) {
+        smoothVertices.insert(smoothVertices.end(), 
+                              threadVertices[i].begin(), threadVertices[i].end());
+    }
+}
+
+void FluidSimulation::_getSmoothVerticesThread(int startidx, int endidx, 
+                                               TriangleMesh *mesh,
+                                               Array3d<bool> *nearSolidCells,
+                                               std::vector<int> *smoothVertices) {
     double eps = 0.02*_dx;
     vmath::vec3 v;
-    for (unsigned int i = 0; i < mesh.vertices.size(); i++) {
-        v = mesh.vertices[i];
-        if (!_isVertexNearSolid(v, eps)) {
-            smoothVertices.push_back(i);
+    for (int i = startidx; i < endidx; i++) {
+        v = mesh->vertices[i];
+        if (!_isVertexNearSolid(v, eps, *nearSolidCells)) {
+            smoothVertices->push_back(i);
         }
     }
 }
@@ -1842,6 +2076,7 @@ TriangleMesh FluidSimulation::_polygonizeIsotropicOutputSurface() {
     mesher.setScalarFieldAccelerator(&_scalarFieldAccelerator);
     mesher.setSubdivisionLevel(_outputFluidSurfaceSubdivisionLevel);
     mesher.setNumPolygonizationSlices(slices);
+    mesher.setMaxPolygonizationSlicesInFlight(_maxSurfaceReconstructionPolygonizerSlicesInFlight);
 
     return mesher.meshParticles(_markerParticles, _materialGrid, r);
 }
@@ -1861,7 +2096,7 @@ void FluidSimulation::_updateBrickGrid(double dt) {
     std::vector<vmath::vec3> points;
     points.reserve(_markerParticles.size());
     for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        points.push_back(_markerParticles[i].position);
+        points.push_back(_markerParticles.getPosition(i));
     }
 
     _fluidBrickGrid.update(_levelset, _materialGrid, points, dt);
@@ -1938,73 +2173,198 @@ void FluidSimulation::_applyFluidSourceToVelocityField(FluidSource *source,
 
 }
 
-void FluidSimulation::_computeVelocityScalarField(Array3d<float> &field, 
-                                                  Array3d<bool> &isValueSet,
-                                                  int dir) {
-    int U = 0; int V = 1; int W = 2;
+void FluidSimulation::_initializeVelocityTransferBuffers() {
+    int sizes[3][3] = {{_isize + 1, _jsize, _ksize},
+                       {_isize, _jsize + 1, _ksize},
+                       {_isize, _jsize, _ksize + 1}};
 
-    ImplicitSurfaceScalarField grid = ImplicitSurfaceScalarField(field.width,
-                                                                 field.height,
-                                                                 field.depth, _dx);
-    grid.enableWeightField();
-    grid.setPointRadius(_dx); 
+    for (int dir = 0; dir < 3; dir++) {
+        int isize = sizes[dir][0];
+        int jsize = sizes[dir][1];
+        int ksize = sizes[dir][2];
+        Array3d<float> *field = &(_velocityTransferFields[dir]);
+        if (field->width == isize && field->height == jsize && field->depth == ksize) {
+            continue;
+        }
 
-    vmath::vec3 offset;
-    if (dir == U) {
-        offset = vmath::vec3(0.0, 0.5*_dx, 0.5*_dx);
-    } else if (dir == V) {
-        offset = vmath::vec3(0.5*_dx, 0.0, 0.5*_dx);
-    } else if (dir == W) {
-        offset = vmath::vec3(0.5*_dx, 0.5*_dx, 0.0);
-    } else {
-        return;
+        _velocityTransferFields[dir] = Array3d<float>(isize, jsize, ksize, 0.0f);
+        _velocityTransferWeights[dir] = Array3d<float>(isize, jsize, ksize, 0.0f);
+        _isVelocityTransferValueSet[dir] = Array3d<bool>(isize, jsize, ksize, false);
     }
-    grid.setOffset(offset);
+}
 
-    int n = _maxParticlesPerVelocityAdvection;
-    std::vector<vmath::vec3> positions;
-    std::vector<float> values;
-    positions.reserve(fmin(n, _markerParticles.size()));
-    values.reserve(fmin(n, _markerParticles.size()));
+void FluidSimulation::_computeVelocityScalarFields() {
+    _initializeVelocityTransferBuffers();
 
-    for (int startidx = 0; startidx < (int)_markerParticles.size(); startidx += n) {
-        int endidx = startidx + n - 1;
-        if (endidx >= (int)_markerParticles.size()) {
-            endidx = _markerParticles.size() - 1;
-        }
+    // Threads own disjoint slabs of face k indices across all three grids
+    // so that no two threads accumulate into the same face
+    int numSlabs = _ksize + 1;
+    int numthreads = (int)fmin(ThreadUtils::getMaxThreadCount(), numSlabs);
+    numthreads = (int)fmin(numthreads, 
+                           ceil((double)_markerParticles.size() / (double)_minParticlesPerThread));
+    numthreads = (int)fmax(numthreads, 1);
 
-        positions.clear();
-        values.clear();
-        for (int i = startidx; i <= endidx; i++) {
-            positions.push_back(_markerParticles[i].position);
-            values.push_back(_markerParticles[i].velocity[dir]);
-        }
+    std::vector<int> particleIndices;
+    std::vector<int> cellLayerOffsets;
+    _sortMarkerParticlesByCellLayer(particleIndices, cellLayerOffsets);
+
+    std::vector<int> intervals = ThreadUtils::splitRangeIntoIntervals(0, numSlabs, numthreads);
+    std::vector<std::thread> threads(numthreads);
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&FluidSimulation::_computeVelocityScalarFieldsThread, this,
+                                 intervals[i], intervals[i + 1],
+                                 &particleIndices, &cellLayerOffsets);
+    }
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
 
-        _scalarFieldAccelerator.addPointValues(positions, values, grid);
+    FluidSource *source;
+    for (unsigned int i = 0; i < _fluidSources.size(); i++) {
+        source = _fluidSources[i];
+        if (source->isInflow() && source->isActive()) {
+            for (int dir = 0; dir < 3; dir++) {
+                _applyFluidSourceToVelocityField(source, dir, 
+                                                 _isVelocityTransferValueSet[dir], 
+                                                 _velocityTransferFields[dir]);
+            }
+        }
     }
-    grid.applyWeightField();
+}
 
-    Array3d<float> *scalarfield = grid.getPointerToScalarField();
-    Array3d<float> *weightfield = grid.getPointerToWeightField();
+/*
+    Counting sort of the marker particle indices by the k index of the cell
+    that contains the particle. The indices of the particles in cell layer k
+    are stored in indices[offsets[k]] to indices[offsets[k + 1] - 1], in 
+    increasing order.
+*/
+void FluidSimulation::_sortMarkerParticlesByCellLayer(std::vector<int> &indices,
+                                                      std::vector<int> &offsets) {
+    int numParticles = _markerParticles.size();
+    std::vector<int> layers(numParticles);
+    offsets.assign(_ksize + 1, 0);
+    for (int pidx = 0; pidx < numParticles; pidx++) {
+        int k = (int)floor(_markerParticles.z[pidx] / _dx);
+        k = (int)fmin(fmax(k, 0), _ksize - 1);
+        layers[pidx] = k;
+        offsets[k + 1]++;
+    }
+
+    for (int k = 1; k <= _ksize; k++) {
+        offsets[k] += offsets[k - 1];
+    }
+
+    std::vector<int> insertPositions(offsets.begin(), offsets.end() - 1);
+    indices.resize(numParticles);
+    for (int pidx = 0; pidx < numParticles; pidx++) {
+        indices[insertPositions[layers[pidx]]++] = pidx;
+    }
+}
+
+void FluidSimulation::_computeVelocityScalarFieldsThread(int startk, int endk,
+                                                         std::vector<int> *particleIndices,
+                                                         std::vector<int> *cellLayerOffsets) {
+    for (int dir = 0; dir < 3; dir++) {
+        Array3d<float> *field = &(_velocityTransferFields[dir]);
+        Array3d<float> *weights = &(_velocityTransferWeights[dir]);
+        int slabsize = field->width*field->height;
+        int start = startk*slabsize;
+        int end = (int)fmin(endk, field->depth)*slabsize;
+        float *rawfield = field->getRawArray();
+        float *rawweights = weights->getRawArray();
+        for (int idx = start; idx < end; idx++) {
+            rawfield[idx] = 0.0f;
+            rawweights[idx] = 0.0f;
+        }
+    }
+
+    vmath::vec3 offsets[3] = {vmath::vec3(0.0, 0.5*_dx, 0.5*_dx),
+                              vmath::vec3(0.5*_dx, 0.0, 0.5*_dx),
+                              vmath::vec3(0.5*_dx, 0.5*_dx, 0.0)};
+    float *values[3] = {_markerParticles.u.data(),
+                        _markerParticles.v.data(),
+                        _markerParticles.w.data()};
+
+    // Tricubic falloff used by ImplicitSurfaceScalarField with a point radius of dx
+    double r = _dx;
+    double rsq = r*r;
+    double coef1 = (4.0 / 9.0)*(1.0 / (r*r*r*r*r*r));
+    double coef2 = (17.0 / 9.0)*(1.0 / (r*r*r*r));
+    double coef3 = (22.0 / 9.0)*(1.0 / (r*r));
+
+    // Faces in this slab lie between these heights for every component. Only
+    // the particles in the cell layers that overlap this range, the slab and
+    // its kernel radius halo, are visited.
+    double zmin = startk*_dx - r;
+    double zmax = (endk - 0.5)*_dx + r;
+    int layermin = (int)fmax(floor(zmin / _dx), 0);
+    int layermax = (int)fmin(floor(zmax / _dx), _ksize - 1);
+    int begin = cellLayerOffsets->at(layermin);
+    int end = cellLayerOffsets->at(layermax + 1);
 
-    double eps = 1e-9;
-    for (int k = 0; k < field.depth; k++) {
-        for (int j = 0; j < field.height; j++) {
-            for (int i = 0; i < field.width; i++) {
-                field.set(i, j, k, scalarfield->get(i, j, k));
+    GridIndex gmin, gmax;
+    vmath::vec3 p;
+    for (int sortidx = begin; sortidx < end; sortidx++) {
+        int pidx = particleIndices->at(sortidx);
+        double z = _markerParticles.z[pidx];
+        if (z < zmin || z > zmax) {
+            continue;
+        }
 
-                if (weightfield->get(i, j, k) > eps) {
-                    isValueSet.set(i, j, k, true);
+        for (int dir = 0; dir < 3; dir++) {
+            Array3d<float> *field = &(_velocityTransferFields[dir]);
+            float *rawfield = field->getRawArray();
+            float *rawweights = _velocityTransferWeights[dir].getRawArray();
+            int width = field->width;
+            int slabsize = field->width*field->height;
+
+            p = vmath::vec3(_markerParticles.x[pidx], 
+                            _markerParticles.y[pidx], 
+                            _markerParticles.z[pidx]) - offsets[dir];
+            Grid3d::getGridIndexBounds(p, r, _dx, field->width, field->height, field->depth,
+                                       &gmin, &gmax);
+            gmin.k = (int)fmax(gmin.k, startk);
+            gmax.k = (int)fmin(gmax.k, endk - 1);
+
+            double value = values[dir][pidx];
+            for (int k = gmin.k; k <= gmax.k; k++) {
+                double dz = k*_dx - p.z;
+                for (int j = gmin.j; j <= gmax.j; j++) {
+                    double dy = j*_dx - p.y;
+                    double dyzsq = dy*dy + dz*dz;
+                    int flatidx = gmin.i + j*width + k*slabsize;
+                    for (int i = gmin.i; i <= gmax.i; i++, flatidx++) {
+                        double dx = i*_dx - p.x;
+                        double distsq = dx*dx + dyzsq;
+                        if (distsq < rsq) {
+                            double weight = 1.0 - coef1*distsq*distsq*distsq + 
+                                                  coef2*distsq*distsq - 
+                                                  coef3*distsq;
+                            rawfield[flatidx] += (float)(weight*value);
+                            rawweights[flatidx] += (float)weight;
+                        }
+                    }
                 }
             }
         }
     }
 
-    FluidSource *source;
-    for (unsigned int i = 0; i < _fluidSources.size(); i++) {
-        source = _fluidSources[i];
-        if (source->isInflow() && source->isActive()) {
-            _applyFluidSourceToVelocityField(source, dir, isValueSet, field);
+    double eps = 1e-9;
+    for (int dir = 0; dir < 3; dir++) {
+        Array3d<float> *field = &(_velocityTransferFields[dir]);
+        Array3d<float> *weights = &(_velocityTransferWeights[dir]);
+        Array3d<bool> *isValueSet = &(_isVelocityTransferValueSet[dir]);
+        int kmax = (int)fmin(endk, field->depth);
+        for (int k = startk; k < kmax; k++) {
+            for (int j = 0; j < field->height; j++) {
+                for (int i = 0; i < field->width; i++) {
+                    float w = weights->get(i, j, k);
+                    if (w > 0.0) {
+                        field->set(i, j, k, field->get(i, j, k) / w);
+                    }
+                    isValueSet->set(i, j, k, w > eps);
+                }
+            }
         }
     }
 }
@@ -2012,9 +2372,8 @@ void FluidSimulation::_computeVelocityScalarField(Array3d<float> &field,
 void FluidSimulation::_advectVelocityFieldU() {
     _MACVelocity.clearU();
 
-    Array3d<float> ugrid = Array3d<float>(_isize + 1, _jsize, _ksize, 0.0f);
-    Array3d<bool> isValueSet = Array3d<bool>(_isize + 1, _jsize, _ksize, false);
-    _computeVelocityScalarField(ugrid, isValueSet, 0);
+    Array3d<float> &ugrid = _velocityTransferFields[0];
+    Array3d<bool> &isValueSet = _isVelocityTransferValueSet[0];
 
     GridIndexVector extrapolationIndices(_isize + 1, _jsize, _ksize);
     for (int k = 0; k < ugrid.depth; k++) {
@@ -2057,9 +2416,8 @@ void FluidSimulation::_advectVelocityFieldU() {
 void FluidSimulation::_advectVelocityFieldV() {
     _MACVelocity.clearV();
 
-    Array3d<float> vgrid = Array3d<float>(_isize, _jsize + 1, _ksize, 0.0f);
-    Array3d<bool> isValueSet = Array3d<bool>(_isize, _jsize + 1, _ksize, false);
-    _computeVelocityScalarField(vgrid, isValueSet, 1);
+    Array3d<float> &vgrid = _velocityTransferFields[1];
+    Array3d<bool> &isValueSet = _isVelocityTransferValueSet[1];
     
     GridIndexVector extrapolationIndices(_isize, _jsize + 1, _ksize);
     for (int k = 0; k < vgrid.depth; k++) {
@@ -2102,9 +2460,8 @@ void FluidSimulation::_advectVelocityFieldV() {
 void FluidSimulation::_advectVelocityFieldW() {
     _MACVelocity.clearW();
 
-    Array3d<float> wgrid = Array3d<float>(_isize, _jsize, _ksize + 1, 0.0f);
-    Array3d<bool> isValueSet = Array3d<bool>(_isize, _jsize, _ksize + 1, 0.0f);
-    _computeVelocityScalarField(wgrid, isValueSet, 2);
+    Array3d<float> &wgrid = _velocityTransferFields[2];
+    Array3d<bool> &isValueSet = _isVelocityTransferValueSet[2];
     
     GridIndexVector extrapolationIndices(_isize, _jsize, _ksize + 1);
     for (int k = 0; k < wgrid.depth; k++) {
@@ -2145,6 +2502,7 @@ void FluidSimulation::_advectVelocityFieldW() {
 }
 
 void FluidSimulation::_advectVelocityField() {
+    _computeVelocityScalarFields();
     _advectVelocityFieldU();
     _advectVelocityFieldV();
     _advectVelocityFieldW();
@@ -2163,106 +2521,81 @@ vmath::vec3 FluidSimulation::_getConstantBodyForce() {
     return bf;
 }
 
-void FluidSimulation::_applyConstantBodyForces(double dt) {
+/*
+    The advected field is needed unchanged for the FLIP update, so the
+    forced field is written into the _savedVelocityField buffer and the two
+    fields are swapped. _savedVelocityField then holds the advected field. 
+    The face grids are sparse, so copying the advected field into the 
+    buffer only copies the tiles that hold velocities.
+*/
+void FluidSimulation::_applyBodyForcesToVelocityField(double dt) {
+    _savedVelocityField = _MACVelocity;
 
+    // Every face bordering fluid is the low face of a fluid cell, or the 
+    // high face of a fluid cell that does not have a fluid neighbour across
+    // that face, so each face is visited once.
     vmath::vec3 bodyForce = _getConstantBodyForce();
-
-    if (fabs(bodyForce.x) > 0.0) {
-        for (int k = 0; k < _ksize; k++) {
-            for (int j = 0; j < _jsize; j++) {
-                for (int i = 0; i < _isize + 1; i++) {
-                    if (_materialGrid.isFaceBorderingFluidU(i, j, k)) {
-                        _MACVelocity.addU(i, j, k, bodyForce.x * dt);
-                    }
-                }
-            }
+    GridIndex g;
+    for (unsigned int idx = 0; idx < _fluidCellIndices.size(); idx++) {
+        g = _fluidCellIndices[idx];
+        _applyBodyForcesToFaceU(g.i, g.j, g.k, bodyForce, dt);
+        _applyBodyForcesToFaceV(g.i, g.j, g.k, bodyForce, dt);
+        _applyBodyForcesToFaceW(g.i, g.j, g.k, bodyForce, dt);
+        if (!_materialGrid.isCellFluid(g.i + 1, g.j, g.k)) {
+            _applyBodyForcesToFaceU(g.i + 1, g.j, g.k, bodyForce, dt);
         }
-    }
-
-    if (fabs(bodyForce.y) > 0.0) {
-        for (int k = 0; k < _ksize; k++) {
-            for (int j = 0; j < _jsize + 1; j++) {
-                for (int i = 0; i < _isize; i++) {
-                    if (_materialGrid.isFaceBorderingFluidV(i, j, k)) {
-                        _MACVelocity.addV(i, j, k, bodyForce.y * dt);
-                    }
-                }
-            }
+        if (!_materialGrid.isCellFluid(g.i, g.j + 1, g.k)) {
+            _applyBodyForcesToFaceV(g.i, g.j + 1, g.k, bodyForce, dt);
         }
-    }
-
-    if (fabs(bodyForce.z) > 0.0) {
-        for (int k = 0; k < _ksize + 1; k++) {
-            for (int j = 0; j < _jsize; j++) {
-                for (int i = 0; i < _isize; i++) {
-                    if (_materialGrid.isFaceBorderingFluidW(i, j, k)) {
-                        _MACVelocity.addW(i, j, k, bodyForce.z * dt);
-                    }
-                }
-            }
+        if (!_materialGrid.isCellFluid(g.i, g.j, g.k + 1)) {
+            _applyBodyForcesToFaceW(g.i, g.j, g.k + 1, bodyForce, dt);
         }
     }
-}
 
-void FluidSimulation::_applyVariableBodyForce(vmath::vec3 (*fieldFunction)(vmath::vec3),
-                                              double dt) {
-
-    vmath::vec3 p;
-    vmath::vec3 bodyForce;
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize + 1; i++) {
-                if (_materialGrid.isFaceBorderingFluidU(i, j, k)) {
-                    p = Grid3d::FaceIndexToPositionU(i, j, k, _dx);
-                    bodyForce = fieldFunction(p);
-                    _MACVelocity.addU(i, j, k, bodyForce.x * dt);
-                }
-            }
-        }
-    }
+    std::swap(_MACVelocity, _savedVelocityField);
+}
 
+void FluidSimulation::_applyBodyForcesToFaceU(int i, int j, int k, 
+                                              vmath::vec3 constantBodyForce, double dt) {
+    vmath::vec3 p = Grid3d::FaceIndexToPositionU(i, j, k, _dx);
+    float u = _addBodyForces(_MACVelocity.U(i, j, k), 0, p, constantBodyForce, dt);
+    _savedVelocityField.setU(i, j, k, u);
+}
 
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize + 1; j++) {
-            for (int i = 0; i < _isize; i++) {
-                if (_materialGrid.isFaceBorderingFluidV(i, j, k)) {
-                    p = Grid3d::FaceIndexToPositionV(i, j, k, _dx);
-                    bodyForce = fieldFunction(p);
-                    _MACVelocity.addV(i, j, k, bodyForce.y * dt);
-                }
-            }
-        }
-    }
+void FluidSimulation::_applyBodyForcesToFaceV(int i, int j, int k, 
+                                              vmath::vec3 constantBodyForce, double dt) {
+    vmath::vec3 p = Grid3d::FaceIndexToPositionV(i, j, k, _dx);
+    float v = _addBodyForces(_MACVelocity.V(i, j, k), 1, p, constantBodyForce, dt);
+    _savedVelocityField.setV(i, j, k, v);
+}
 
+void FluidSimulation::_applyBodyForcesToFaceW(int i, int j, int k, 
+                                              vmath::vec3 constantBodyForce, double dt) {
+    vmath::vec3 p = Grid3d::FaceIndexToPositionW(i, j, k, _dx);
+    float w = _addBodyForces(_MACVelocity.W(i, j, k), 2, p, constantBodyForce, dt);
+    _savedVelocityField.setW(i, j, k, w);
+}
 
-    for (int k = 0; k < _ksize + 1; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize; i++) {
-                if (_materialGrid.isFaceBorderingFluidW(i, j, k)) {
-                    p = Grid3d::FaceIndexToPositionW(i, j, k, _dx);
-                    bodyForce = fieldFunction(p);
-                    _MACVelocity.addW(i, j, k, bodyForce.z * dt);
-                }
-            }
-        }
+/*
+    Adds the dir component of the constant and variable body forces at 
+    position p to a face velocity. Forces are added one at a time in single
+    precision, in the order that they were added to the simulation.
+*/
+float FluidSimulation::_addBodyForces(float velocity, int dir, vmath::vec3 p,
+                                      vmath::vec3 constantBodyForce, double dt) {
+    if (fabs(constantBodyForce[dir]) > 0.0) {
+        velocity += (float)(constantBodyForce[dir] * dt);
     }
 
-}
-
-void FluidSimulation::_applyVariableBodyForces(double dt) {
-    vmath::vec3 (*fieldFunction)(vmath::vec3);
+    vmath::vec3 bodyForce;
     for (unsigned int i = 0; i < _variableBodyForces.size(); i++) {
-        fieldFunction = _variableBodyForces[i];
-        _applyVariableBodyForce(fieldFunction, dt);
+        bodyForce = _variableBodyForces[i](p);
+        velocity += (float)(bodyForce[dir] * dt);
     }
-}
 
-void FluidSimulation::_applyBodyForcesToVelocityField(double dt) {
-    _applyConstantBodyForces(dt);
-    _applyVariableBodyForces(dt);
+    return velocity;
 }
 
-
 /********************************************************************************
     7. Pressure Solve
 ********************************************************************************/
@@ -2272,15 +2605,31 @@ void FluidSimulation::_updatePressureGrid(Array3d<float> &pressureGrid, double d
     params.cellwidth = _dx;
     params.density = _density;
     params.deltaTime = dt;
+    params.preconditioner = PressurePreconditioner::mic;
+    if (_isMultigridPressurePreconditionerEnabled) {
+        params.preconditioner = PressurePreconditioner::multigrid;
+    }
+    params.isMixedPrecisionEnabled = _isMixedPrecisionPressureSolveEnabled;
     params.fluidCells = &_fluidCellIndices;
     params.materialGrid = &_materialGrid;
     params.velocityField = &_MACVelocity;
     params.logfile = &_logfile;
 
+    VectorXd initialPressures(_fluidCellIndices.size());
+    params.initialPressure = nullptr;
+    if (_isPressureWarmStartEnabled && _isLastPressureGridInitialized) {
+        _getPressureWarmStartValues(initialPressures);
+        params.initialPressure = &initialPressures;
+    }
+
     VectorXd pressures(_fluidCellIndices.size());
     PressureSolver solver;
     solver.solve(params, pressures);
 
+    if (_isPressureWarmStartEnabled) {
+        _saveLastPressureValues(pressures);
+    }
+
     GridIndex g;
     for (unsigned int idx = 0; idx < _fluidCellIndices.size(); idx++) {
         g = _fluidCellIndices[idx];
@@ -2288,13 +2637,67 @@ void FluidSimulation::_updatePressureGrid(Array3d<float> &pressureGrid, double d
     }
 }
 
+/*
+    Remaps the pressures from the previous time step onto the current fluid 
+    cells. Cells that are new to the fluid are extrapolated from neighbouring 
+    cells that hold a previous pressure value.
+*/
+void FluidSimulation::_getPressureWarmStartValues(VectorXd &pressures) {
+    assert(pressures.size() == _fluidCellIndices.size());
+
+    GridIndex g;
+    GridIndex nbs[6];
+    for (unsigned int idx = 0; idx < _fluidCellIndices.size(); idx++) {
+        g = _fluidCellIndices[idx];
+        if (_isLastPressureSet(g)) {
+            pressures[idx] = _lastPressureGrid(g);
+            continue;
+        }
+
+        Grid3d::getNeighbourGridIndices6(g, nbs);
+        double sum = 0.0;
+        int count = 0;
+        for (int nidx = 0; nidx < 6; nidx++) {
+            if (Grid3d::isGridIndexInRange(nbs[nidx], _isize, _jsize, _ksize) && 
+                    _isLastPressureSet(nbs[nidx])) {
+                sum += _lastPressureGrid(nbs[nidx]);
+                count++;
+            }
+        }
+
+        pressures[idx] = count > 0 ? sum / (double)count : 0.0;
+    }
+}
+
+void FluidSimulation::_saveLastPressureValues(VectorXd &pressures) {
+    assert(pressures.size() == _fluidCellIndices.size());
+
+    if (!_isLastPressureGridInitialized) {
+        _lastPressureGrid = Array3d<float>(_isize, _jsize, _ksize, 0.0f);
+        _isLastPressureSet = Array3d<bool>(_isize, _jsize, _ksize, false);
+        _isLastPressureGridInitialized = true;
+    }
+
+    _isLastPressureSet.fill(false);
+    GridIndex g;
+    for (unsigned int idx = 0; idx < _fluidCellIndices.size(); idx++) {
+        g = _fluidCellIndices[idx];
+        _lastPressureGrid.set(g, (float)pressures[idx]);
+        _isLastPressureSet.set(g, true);
+    }
+}
+
 /********************************************************************************
     8. Apply Pressure
 ********************************************************************************/
 
 void FluidSimulation::_applyPressureToFaceU(int i, int j, int k, 
-                                            Array3d<float> &pressureGrid,
-                                            MACVelocityField &tempMACVelocity, double dt) {
+                                            Array3d<float> &pressureGrid, double dt) {
+    if (_materialGrid.isFaceBorderingSolidU(i, j, k)) {
+        _MACVelocity.setU(i, j, k, 0.0);
+        return;
+    }
+
     double usolid = 0.0;   // solids are stationary
     double scale = dt / (_density * _dx);
     double invscale = 1.0 / scale;
@@ -2316,12 +2719,16 @@ void FluidSimulation::_applyPressureToFaceU(int i, int j, int k,
     }
 
     double unext = _MACVelocity.U(i, j, k) - scale*(p1 - p0);
-    tempMACVelocity.setU(i, j, k, unext);
+    _MACVelocity.setU(i, j, k, unext);
 }
 
 void FluidSimulation::_applyPressureToFaceV(int i, int j, int k, 
-                                            Array3d<float> &pressureGrid,
-                                            MACVelocityField &tempMACVelocity, double dt) {
+                                            Array3d<float> &pressureGrid, double dt) {
+    if (_materialGrid.isFaceBorderingSolidV(i, j, k)) {
+        _MACVelocity.setV(i, j, k, 0.0);
+        return;
+    }
+
     double usolid = 0.0;   // solids are stationary
     double scale = dt / (_density * _dx);
     double invscale = 1.0 / scale;
@@ -2345,12 +2752,16 @@ void FluidSimulation::_applyPressureToFaceV(int i, int j, int k,
     }
 
     double vnext = _MACVelocity.V(i, j, k) - scale*(p1 - p0);
-    tempMACVelocity.setV(i, j, k, vnext);
+    _MACVelocity.setV(i, j, k, vnext);
 }
 
 void FluidSimulation::_applyPressureToFaceW(int i, int j, int k, 
-                                            Array3d<float> &pressureGrid,
-                                            MACVelocityField &tempMACVelocity, double dt) {
+                                            Array3d<float> &pressureGrid, double dt) {
+    if (_materialGrid.isFaceBorderingSolidW(i, j, k)) {
+        _MACVelocity.setW(i, j, k, 0.0);
+        return;
+    }
+
     double usolid = 0.0;   // solids are stationary
     double scale = dt / (_density * _dx);
     double invscale = 1.0 / scale;
@@ -2374,90 +2785,29 @@ void FluidSimulation::_applyPressureToFaceW(int i, int j, int k,
     }
 
     double wnext = _MACVelocity.W(i, j, k) - scale*(p1 - p0);
-    tempMACVelocity.setW(i, j, k, wnext);
-}
-
-void FluidSimulation::_commitTemporaryVelocityFieldValues(MACVelocityField &tempMACVelocity) {
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize + 1; i++) {
-                if (_materialGrid.isFaceBorderingFluidU(i, j, k)) {
-                    _MACVelocity.setU(i, j, k, tempMACVelocity.U(i, j, k));
-                }
-            }
-        }
-    }
-
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize + 1; j++) {
-            for (int i = 0; i < _isize; i++) {
-                if (_materialGrid.isFaceBorderingFluidV(i, j, k)) {
-                    _MACVelocity.setV(i, j, k, tempMACVelocity.V(i, j, k));
-                }
-            }
-        }
-    }
-
-    for (int k = 0; k < _ksize + 1; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize; i++) {
-                if (_materialGrid.isFaceBorderingFluidW(i, j, k)) {
-                    _MACVelocity.setW(i, j, k, tempMACVelocity.W(i, j, k));
-                }
-            }
-        }
-    }
+    _MACVelocity.setW(i, j, k, wnext);
 }
 
 void FluidSimulation::_applyPressureToVelocityField(Array3d<float> &pressureGrid, double dt) {
-    MACVelocityField tempMACVelocity = MACVelocityField(_isize, _jsize, _ksize, _dx);
-
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize + 1; i++) {
-                if (_materialGrid.isFaceBorderingSolidU(i, j, k)) {
-                    tempMACVelocity.setU(i, j, k, 0.0);
-                }
-
-                if (_materialGrid.isFaceBorderingFluidU(i, j, k) &&
-                    !_materialGrid.isFaceBorderingSolidU(i, j, k)) {
-                    _applyPressureToFaceU(i, j, k, pressureGrid, tempMACVelocity, dt);
-                }
-            }
+    // Each face update only reads its own velocity, so the field can be
+    // updated in place. Faces bordering fluid are visited once each, in 
+    // the same way as in _applyBodyForcesToVelocityField.
+    GridIndex g;
+    for (unsigned int idx = 0; idx < _fluidCellIndices.size(); idx++) {
+        g = _fluidCellIndices[idx];
+        _applyPressureToFaceU(g.i, g.j, g.k, pressureGrid, dt);
+        _applyPressureToFaceV(g.i, g.j, g.k, pressureGrid, dt);
+        _applyPressureToFaceW(g.i, g.j, g.k, pressureGrid, dt);
+        if (!_materialGrid.isCellFluid(g.i + 1, g.j, g.k)) {
+            _applyPressureToFaceU(g.i + 1, g.j, g.k, pressureGrid, dt);
         }
-    }
-
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize + 1; j++) {
-            for (int i = 0; i < _isize; i++) {
-                if (_materialGrid.isFaceBorderingSolidV(i, j, k)) {
-                    tempMACVelocity.setV(i, j, k, 0.0);
-                }
-
-                if (_materialGrid.isFaceBorderingFluidV(i, j, k) &&
-                    !_materialGrid.isFaceBorderingSolidV(i, j, k)) {
-                    _applyPressureToFaceV(i, j, k, pressureGrid, tempMACVelocity, dt);
-                }
-            }
+        if (!_materialGrid.isCellFluid(g.i, g.j + 1, g.k)) {
+            _applyPressureToFaceV(g.i, g.j + 1, g.k, pressureGrid, dt);
         }
-    }
-
-    for (int k = 0; k < _ksize + 1; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize; i++) {
-                if (_materialGrid.isFaceBorderingSolidW(i, j, k)) {
-                    tempMACVelocity.setW(i, j, k, 0.0);
-                }
-
-                if (_materialGrid.isFaceBorderingFluidW(i, j, k) &&
-                    !_materialGrid.isFaceBorderingSolidW(i, j, k)) {
-                    _applyPressureToFaceW(i, j, k, pressureGrid, tempMACVelocity, dt);
-                }
-            }
+        if (!_materialGrid.isCellFluid(g.i, g.j, g.k + 1)) {
+            _applyPressureToFaceW(g.i, g.j, g.k + 1, pressureGrid, dt);
         }
     }
-
-    _commitTemporaryVelocityFieldValues(tempMACVelocity);
 }
 
 /********************************************************************************
@@ -2466,7 +2816,7 @@ void FluidSimulation::_applyPressureToVelocityField(Array3d<float> &pressureGrid
 
 void FluidSimulation::_extrapolateFluidVelocities(MACVelocityField &MACGrid) {
     int numLayers = (int)ceil(_CFLConditionNumber + 2);
-    MACGrid.extrapolateVelocityField(_materialGrid, numLayers);
+    MACGrid.extrapolateVelocityField(_materialGrid, _fluidCellIndices, numLayers);
 }
 
 /********************************************************************************
@@ -2503,28 +2853,37 @@ void FluidSimulation::_updateDiffuseMaterial(double dt) {
 
 void FluidSimulation::_updateRangeOfMarkerParticleVelocities(int startIdx, int endIdx) {
     int size = endIdx - startIdx + 1;
-    std::vector<vmath::vec3> positions, vnew, vold;
-    positions.reserve(size);
-    vnew.reserve(size);
-    vold.reserve(size);
-
-    for (int i = startIdx; i <= endIdx; i++) {
-        positions.push_back(_markerParticles[i].position);
-    }
+    float *x = &(_markerParticles.x[startIdx]);
+    float *y = &(_markerParticles.y[startIdx]);
+    float *z = &(_markerParticles.z[startIdx]);
 
-    _particleAdvector.tricubicInterpolate(positions, &_MACVelocity, vnew);
-    _particleAdvector.tricubicInterpolate(positions, &_savedVelocityField, vold);
+    std::vector<float> unew(size), vnew(size), wnew(size);
+    std::vector<float> uold(size), vold(size), wold(size);
+    _particleAdvector.tricubicInterpolate(x, y, z, size, &_MACVelocity, 
+                                          unew.data(), vnew.data(), wnew.data());
+    _particleAdvector.tricubicInterpolate(x, y, z, size, &_savedVelocityField, 
+                                          uold.data(), vold.data(), wold.data());
 
-    vmath::vec3 vPIC, vFLIP, v;
-    MarkerParticle mp;
-    for (unsigned int i = 0; i < positions.size(); i++) {
-        mp = _markerParticles[startIdx + i];
-
-        vPIC = vnew[i];
-        vFLIP = mp.velocity + vnew[i] - vold[i];
+    float *u = &(_markerParticles.u[startIdx]);
+    float *v = &(_markerParticles.v[startIdx]);
+    float *w = &(_markerParticles.w[startIdx]);
+    _blendPICFLIPVelocities(unew.data(), uold.data(), u, size);
+    _blendPICFLIPVelocities(vnew.data(), vold.data(), v, size);
+    _blendPICFLIPVelocities(wnew.data(), wold.data(), w, size);
+}
 
-        v = (float)_ratioPICFLIP * vPIC + (float)(1 - _ratioPICFLIP) * vFLIP;
-        _markerParticles[startIdx + i].velocity = v;
+/*
+    vPIC = vnew
+    vFLIP = v + vnew - vold
+    v = ratio*vPIC + (1 - ratio)*vFLIP
+*/
+void FluidSimulation::_blendPICFLIPVelocities(float *vnew, float *vold, 
+                                              float *velocity, int n) {
+    float ratio = (float)_ratioPICFLIP;
+    float invratio = (float)(1 - _ratioPICFLIP);
+    for (int i = 0; i < n; i++) {
+        float vFLIP = velocity[i] + vnew[i] - vold[i];
+        velocity[i] = ratio * vnew[i] + invratio * vFLIP;
     }
 }
 
@@ -2582,64 +2941,270 @@ void FluidSimulation::_advanceRangeOfMarkerParticles(int startIdx, int endIdx,
                                                      double dt) {
     assert(startIdx <= endIdx);
 
-    std::vector<vmath::vec3> positions;
-    positions.reserve(endIdx - startIdx + 1);
-    for (int i = startIdx; i <= endIdx; i++) {
-        positions.push_back(_markerParticles[i].position);
+    int size = endIdx - startIdx + 1;
+    std::vector<float> nextx(size), nexty(size), nextz(size);
+    _particleAdvector.advectParticlesRK4(&(_markerParticles.x[startIdx]),
+                                         &(_markerParticles.y[startIdx]),
+                                         &(_markerParticles.z[startIdx]),
+                                         size, &_MACVelocity, dt,
+                                         nextx.data(), nexty.data(), nextz.data());
+
+    int numthreads = (int)fmin(ThreadUtils::getMaxThreadCount(), 
+                               ceil((double)size / (double)_minParticlesPerThread));
+    std::vector<int> intervals = ThreadUtils::splitRangeIntoIntervals(0, size, numthreads);
+    std::vector<std::thread> threads(numthreads);
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&FluidSimulation::_setAdvectedMarkerParticlePositionsThread, this,
+                                 startIdx, intervals[i], intervals[i + 1],
+                                 &nextx, &nexty, &nextz);
     }
 
-    std::vector<vmath::vec3> output;
-    _particleAdvector.advectParticlesRK4(positions, &_MACVelocity, dt, 
-                                         output);
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
+}
 
-    MarkerParticle mp;
+/*
+    Writes advected positions for the range [startidx, endidx) of the output
+    buffers back into the marker particle arrays beginning at offset. 
+    Particles that were advected into a solid cell are moved back to the 
+    solid boundary. Each thread writes a disjoint range of particles.
+*/
+void FluidSimulation::_setAdvectedMarkerParticlePositionsThread(int offset, 
+                                                                int startidx, int endidx,
+                                                                std::vector<float> *nextx,
+                                                                std::vector<float> *nexty,
+                                                                std::vector<float> *nextz) {
     vmath::vec3 nextp;
     GridIndex g;
-    for (unsigned int i = 0; i < output.size(); i++) {
-        mp = _markerParticles[startIdx + i];
-        nextp = output[i];
+    for (int i = startidx; i < endidx; i++) {
+        nextp = vmath::vec3(nextx->at(i), nexty->at(i), nextz->at(i));
 
         g = Grid3d::positionToGridIndex(nextp, _dx);
         if (_materialGrid.isCellSolid(g)) {
-            nextp = _resolveParticleSolidCellCollision(mp.position, nextp);
+            nextp = _resolveParticleSolidCellCollision(_markerParticles.getPosition(offset + i), 
+                                                       nextp);
         }
 
-        _markerParticles[startIdx + i].position = nextp;
+        _markerParticles.setPosition(offset + i, nextp);
     }
 }
 
-void FluidSimulation::_shuffleMarkerParticleOrder() {
-    MarkerParticle mi;
-    for (int i = _markerParticles.size() - 2; i >= 0; i--) {
-        int j = (rand() % (int)(i - 0 + 1));
-        mi = _markerParticles[i];
-        _markerParticles[i] = _markerParticles[j];
-        _markerParticles[j] = mi;
+/*
+    Limits the number of marker particles in each cell to 
+    _maxMarkerParticlesPerCell.
+
+    Particles are counted per cell in parallel. Cells over the limit are rare, 
+    so when there are none the pass ends after counting. Otherwise the 
+    particles in each overfull cell are ranked in index order and a 
+    pseudo-random permutation of the ranks, seeded by the cell and time step, 
+    selects exactly _maxMarkerParticlesPerCell particles to keep. The result 
+    does not depend on the number of threads. The culled particles are then 
+    compacted out in place. All work buffers persist between calls.
+*/
+void FluidSimulation::_removeMarkerParticles() {
+    int numParticles = _markerParticles.size();
+    if (numParticles == 0) {
+        return;
+    }
+
+    _initializeMarkerParticleCullingBuffers();
+    _markerParticleCellIndices.resize(numParticles);
+
+    int numthreads = (int)fmin(ThreadUtils::getMaxThreadCount(), 
+                               ceil((double)numParticles / (double)_minParticlesPerThread));
+    std::vector<int> intervals = ThreadUtils::splitRangeIntoIntervals(0, numParticles, 
+                                                                      numthreads);
+    std::vector<std::thread> threads(numthreads);
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&FluidSimulation::_countMarkerParticlesPerCellThread, this,
+                                 intervals[i], intervals[i + 1], i);
+    }
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
+
+    _overfullParticleCells.clear();
+    for (int i = 0; i < numthreads; i++) {
+        std::vector<int> *cells = &(_threadOverfullParticleCells[i]);
+        _overfullParticleCells.insert(_overfullParticleCells.end(), 
+                                      cells->begin(), cells->end());
+    }
+
+    if (!_overfullParticleCells.empty()) {
+        std::sort(_overfullParticleCells.begin(), _overfullParticleCells.end());
+        _initializeOverfullCellPermutations();
+
+        for (int i = 0; i < numthreads; i++) {
+            threads[i] = std::thread(&FluidSimulation::_countOverfullCellParticlesThread, this,
+                                     intervals[i], intervals[i + 1], i);
+        }
+        for (int i = 0; i < numthreads; i++) {
+            threads[i].join();
+        }
+
+        // Convert per thread counts into each thread's starting rank
+        int numCells = _overfullParticleCells.size();
+        for (int cidx = 0; cidx < numCells; cidx++) {
+            int rank = 0;
+            for (int tidx = 0; tidx < numthreads; tidx++) {
+                int count = _threadOverfullCellRanks[tidx][cidx];
+                _threadOverfullCellRanks[tidx][cidx] = rank;
+                rank += count;
+            }
+        }
+
+        _isMarkerParticleRemoved.resize(numParticles);
+        for (int i = 0; i < numthreads; i++) {
+            threads[i] = std::thread(&FluidSimulation::_markCulledMarkerParticlesThread, this,
+                                     intervals[i], intervals[i + 1], i);
+        }
+        for (int i = 0; i < numthreads; i++) {
+            threads[i].join();
+        }
+    }
+
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&FluidSimulation::_resetMarkerParticleCellCountsThread, this,
+                                 intervals[i], intervals[i + 1]);
+    }
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
+
+    if (!_overfullParticleCells.empty()) {
+        for (unsigned int i = 0; i < _overfullParticleCells.size(); i++) {
+            _overfullParticleCellIDs[_overfullParticleCells[i]] = -1;
+        }
+        _markerParticles.removeItems(_isMarkerParticleRemoved);
     }
 }
 
-void FluidSimulation::_removeMarkerParticles() {
-    Array3d<int> countGrid = Array3d<int>(_isize, _jsize, _ksize, 0);
-    _shuffleMarkerParticleOrder();
+void FluidSimulation::_initializeMarkerParticleCullingBuffers() {
+    int numCells = _isize*_jsize*_ksize;
+    if ((int)_markerParticleCellCounts.size() != numCells) {
+        std::vector<std::atomic<int> > counts(numCells);
+        _markerParticleCellCounts.swap(counts);
+        for (int i = 0; i < numCells; i++) {
+            _markerParticleCellCounts[i].store(0);
+        }
+        _overfullParticleCellIDs.assign(numCells, -1);
+    }
 
-    std::vector<bool> isRemoved;
-    isRemoved.reserve(_markerParticles.size());
+    int numthreads = ThreadUtils::getMaxThreadCount();
+    if ((int)_threadOverfullParticleCells.size() < numthreads) {
+        _threadOverfullParticleCells.resize(numthreads);
+        _threadOverfullCellRanks.resize(numthreads);
+    }
+}
 
-    MarkerParticle mp;
+/*
+    Picks an affine permutation r -> (a*r + b) mod n over the ranks of an
+    overfull cell with n particles. a must be coprime with n. 
+*/
+void FluidSimulation::_initializeOverfullCellPermutations() {
+    _overfullCellPermutations.clear();
+
+    unsigned int seed = _getCullingHash((unsigned int)_currentFrame * 65599u + 
+                                        (unsigned int)_currentTimeStep);
+    for (unsigned int i = 0; i < _overfullParticleCells.size(); i++) {
+        int cell = _overfullParticleCells[i];
+        _overfullParticleCellIDs[cell] = i;
+
+        long long n = _markerParticleCellCounts[cell].load();
+        unsigned int h1 = _getCullingHash(seed ^ (unsigned int)cell);
+        unsigned int h2 = _getCullingHash(h1);
+
+        long long a = 1 + h1 % (n - 1);
+        while (_gcd(a, n) != 1) {
+            a = (a % (n - 1)) + 1;
+        }
+
+        CullingPermutation perm;
+        perm.a = a;
+        perm.b = h2 % n;
+        perm.n = n;
+        _overfullCellPermutations.push_back(perm);
+    }
+}
+
+void FluidSimulation::_countMarkerParticlesPerCellThread(int startidx, int endidx, 
+                                                         int threadidx) {
+    std::vector<int> *overfullCells = &(_threadOverfullParticleCells[threadidx]);
+    overfullCells->clear();
+
+    float *x = _markerParticles.x.data();
+    float *y = _markerParticles.y.data();
+    float *z = _markerParticles.z.data();
     GridIndex g;
-    for (unsigned int i = 0; i < _markerParticles.size(); i++) {
-        mp = _markerParticles[i];
-        g = Grid3d::positionToGridIndex(mp.position, _dx);
-        if (countGrid(g) >= _maxMarkerParticlesPerCell) {
-            isRemoved.push_back(true);
+    for (int i = startidx; i < endidx; i++) {
+        g = Grid3d::positionToGridIndex(vmath::vec3(x[i], y[i], z[i]), _dx);
+        assert(Grid3d::isGridIndexInRange(g, _isize, _jsize, _ksize));
+
+        int cell = Grid3d::getFlatIndex(g, _isize, _jsize);
+        _markerParticleCellIndices[i] = cell;
+
+        // Only the thread that pushes a cell over the limit records it
+        int count = _markerParticleCellCounts[cell].fetch_add(1, std::memory_order_relaxed);
+        if (count == _maxMarkerParticlesPerCell) {
+            overfullCells->push_back(cell);
+        }
+    }
+}
+
+void FluidSimulation::_countOverfullCellParticlesThread(int startidx, int endidx, 
+                                                        int threadidx) {
+    std::vector<int> *counts = &(_threadOverfullCellRanks[threadidx]);
+    counts->assign(_overfullParticleCells.size(), 0);
+
+    for (int i = startidx; i < endidx; i++) {
+        int id = _overfullParticleCellIDs[_markerParticleCellIndices[i]];
+        if (id != -1) {
+            (*counts)[id]++;
+        }
+    }
+}
+
+void FluidSimulation::_markCulledMarkerParticlesThread(int startidx, int endidx, 
+                                                       int threadidx) {
+    std::vector<int> *ranks = &(_threadOverfullCellRanks[threadidx]);
+    long long maxcount = _maxMarkerParticlesPerCell;
+
+    for (int i = startidx; i < endidx; i++) {
+        int id = _overfullParticleCellIDs[_markerParticleCellIndices[i]];
+        if (id == -1) {
+            _isMarkerParticleRemoved[i] = false;
             continue;
         }
-        countGrid.add(g, 1);
 
-        isRemoved.push_back(false);
+        CullingPermutation perm = _overfullCellPermutations[id];
+        long long rank = (*ranks)[id];
+        (*ranks)[id]++;
+
+        _isMarkerParticleRemoved[i] = (perm.a * rank + perm.b) % perm.n >= maxcount;
+    }
+}
+
+void FluidSimulation::_resetMarkerParticleCellCountsThread(int startidx, int endidx) {
+    for (int i = startidx; i < endidx; i++) {
+        _markerParticleCellCounts[_markerParticleCellIndices[i]].store(0, std::memory_order_relaxed);
     }
+}
+
+unsigned int FluidSimulation::_getCullingHash(unsigned int x) {
+    x = ((x >> 16) ^ x) * 0x45d9f3b;
+    x = ((x >> 16) ^ x) * 0x45d9f3b;
+    x = (x >> 16) ^ x;
+    return x;
+}
 
-    _removeItemsFromVector(_markerParticles, isRemoved);
+long long FluidSimulation::_gcd(long long a, long long b) {
+    while (b != 0) {
+        long long t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
 }
 
 void FluidSimulation::_advanceMarkerParticles(double dt) {
@@ -2692,6 +3257,7 @@ void FluidSimulation::_stepFluid(double dt) {
     timers[3].stop();
 
     _logfile.log("Update Level set:           \t", timers[3].getTime(), 4);
+    _logfile.log("Redistance: \t", _levelset.getRedistancingTime(), 4, 1);
 
     timers[4].start();
     if (_isFirstTimeStepForFrame) {
@@ -2703,14 +3269,13 @@ void FluidSimulation::_stepFluid(double dt) {
 
     timers[5].start();
     _advectVelocityField();
-    _savedVelocityField = _MACVelocity;
-    _extrapolateFluidVelocities(_savedVelocityField);
     timers[5].stop();
 
     _logfile.log("Advect Velocity Field:       \t", timers[5].getTime(), 4);
 
     timers[6].start();
     _applyBodyForcesToVelocityField(dt);
+    _extrapolateFluidVelocities(_savedVelocityField);
     timers[6].stop();
 
     _logfile.log("Apply Body Forces:           \t", timers[6].getTime(), 4);
@@ -2746,8 +3311,6 @@ void FluidSimulation::_stepFluid(double dt) {
 
     timers[11].start();
     _updateMarkerParticleVelocities();
-    _savedVelocityField = MACVelocityField();
-    
     timers[11].stop();
 
     _logfile.log("Update PIC/FLIP Velocities:  \t", timers[11].getTime(), 4);
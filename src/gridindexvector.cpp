@@ -54,6 +54,15 @@ void GridIndexVector::insert(GridIndexVector &indices) {
     }
 }
 
+void GridIndexVector::insertFlatIndices(std::vector<int> &flatIndices) {
+    reserve(_indices.size() + flatIndices.size());
+    int maxidx = width*height*depth - 1;
+    for (unsigned int i = 0; i < flatIndices.size(); i++) {
+        assert(flatIndices[i] >= 0 && flatIndices[i] <= maxidx);
+        _indices.push_back(flatIndices[i]);
+    }
+}
+
 std::vector<GridIndex> GridIndexVector::getVector() {
     std::vector<GridIndex> vector;
     vector.reserve(size());
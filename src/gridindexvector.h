@@ -89,6 +89,7 @@ public:
 
     void insert(std::vector<GridIndex> &indices);
     void insert(GridIndexVector &indices);
+    void insertFlatIndices(std::vector<int> &flatIndices);
 
     inline void pop_back() {
         assert(!_indices.empty());
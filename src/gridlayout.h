@@ -0,0 +1,154 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef GRIDLAYOUT_H
+#define GRIDLAYOUT_H
+
+/*
+    Memory layout policies for Array3d. A layout maps a grid index to an
+    offset into the grid's storage and reports how many elements of storage
+    the grid needs, which may include padding.
+
+    RowMajorLayout is the default and the only layout whose storage order
+    matches i + width * (j + height * k). Code that reads an Array3d through
+    getRawArray() or flat indices must use a row-major grid.
+*/
+
+class RowMajorLayout
+{
+public:
+    void initialize(int width, int height, int depth) {
+        _width = width;
+        _height = height;
+        _storageSize = width * height * depth;
+    }
+
+    int getStorageSize() {
+        return _storageSize;
+    }
+
+    inline unsigned int getIndex(int i, int j, int k) {
+        return (unsigned int)i + (unsigned int)_width *
+               ((unsigned int)j + (unsigned int)_height * (unsigned int)k);
+    }
+
+private:
+    int _width = 0;
+    int _height = 0;
+    int _storageSize = 0;
+};
+
+/*
+    Grid is split into 8x8x8 blocks stored in row-major order. Elements within
+    a block are stored in Z-order so that neighbouring cells along all three
+    axes are close in memory.
+*/
+class MortonLayout
+{
+public:
+    void initialize(int width, int height, int depth) {
+        _bwidth = (width + _blockWidth - 1) / _blockWidth;
+        _bheight = (height + _blockWidth - 1) / _blockWidth;
+        _bdepth = (depth + _blockWidth - 1) / _blockWidth;
+        _storageSize = _bwidth * _bheight * _bdepth * _blockSize;
+    }
+
+    int getStorageSize() {
+        return _storageSize;
+    }
+
+    inline unsigned int getIndex(int i, int j, int k) {
+        unsigned int bi = (unsigned int)i >> 3;
+        unsigned int bj = (unsigned int)j >> 3;
+        unsigned int bk = (unsigned int)k >> 3;
+        unsigned int blockOffset = (bi + (unsigned int)_bwidth * 
+                                   (bj + (unsigned int)_bheight * bk)) * _blockSize;
+
+        return blockOffset | _mortonEncode(i & 7, j & 7, k & 7);
+    }
+
+private:
+    inline unsigned int _mortonEncode(int i, int j, int k) {
+        static const unsigned int spread[8] = {
+            0x000, 0x001, 0x008, 0x009, 0x040, 0x041, 0x048, 0x049
+        };
+        return spread[i] | (spread[j] << 1) | (spread[k] << 2);
+    }
+
+    static const int _blockWidth = 8;
+    static const int _blockSize = 512;
+
+    int _bwidth = 0;
+    int _bheight = 0;
+    int _bdepth = 0;
+    int _storageSize = 0;
+};
+
+/*
+    Grid is split into 4x4x4 bricks stored in row-major order. Elements within
+    a brick are also stored in row-major order.
+*/
+class BrickedLayout
+{
+public:
+    void initialize(int width, int height, int depth) {
+        _bwidth = (width + _brickWidth - 1) / _brickWidth;
+        _bheight = (height + _brickWidth - 1) / _brickWidth;
+        _bdepth = (depth + _brickWidth - 1) / _brickWidth;
+        _storageSize = _bwidth * _bheight * _bdepth * _brickSize;
+    }
+
+    int getStorageSize() {
+        return _storageSize;
+    }
+
+    inline unsigned int getIndex(int i, int j, int k) {
+        unsigned int bi = (unsigned int)i >> 2;
+        unsigned int bj = (unsigned int)j >> 2;
+        unsigned int bk = (unsigned int)k >> 2;
+        unsigned int brickOffset = (bi + (unsigned int)_bwidth * 
+                                   (bj + (unsigned int)_bheight * bk)) * _brickSize;
+
+        return brickOffset | (unsigned int)((i & 3) | ((j & 3) << 2) | ((k & 3) << 4));
+    }
+
+private:
+    static const int _brickWidth = 4;
+    static const int _brickSize = 64;
+
+    int _bwidth = 0;
+    int _bheight = 0;
+    int _bdepth = 0;
+    int _storageSize = 0;
+};
+
+/*
+    Layout used for the velocity, material and level set grids of the 
+    simulation. Selected at compile time with GRID_LAYOUT_MORTON or 
+    GRID_LAYOUT_BRICKED, and row-major otherwise.
+*/
+#if defined(GRID_LAYOUT_MORTON) && GRID_LAYOUT_MORTON
+    typedef MortonLayout SimulationGridLayout;
+#elif defined(GRID_LAYOUT_BRICKED) && GRID_LAYOUT_BRICKED
+    typedef BrickedLayout SimulationGridLayout;
+#else
+    typedef RowMajorLayout SimulationGridLayout;
+#endif
+
+#endif
@@ -46,7 +46,17 @@ void IsotropicParticleMesher::setNumPolygonizationSlices(int n) {
 	_numPolygonizationSlices = n;
 }
 
-TriangleMesh IsotropicParticleMesher::meshParticles(FragmentedVector<MarkerParticle> &particles, 
+/*
+	Slices are polygonized concurrently, and each slice in flight holds its
+	own scalar field. Limiting the number of slices in flight bounds the 
+	peak memory used by the polygonizer. A value less than one will use
+	one slice per thread.
+*/
+void IsotropicParticleMesher::setMaxPolygonizationSlicesInFlight(int n) {
+	_maxPolygonizationSlicesInFlight = n;
+}
+
+TriangleMesh IsotropicParticleMesher::meshParticles(MarkerParticleVector &particles, 
 	                                                FluidMaterialGrid &materialGrid,
 	                                                double particleRadius) {
 
@@ -73,7 +83,7 @@ void IsotropicParticleMesher::setScalarFieldAccelerator() {
 	_isScalarFieldAcceleratorSet = false;
 }
 
-TriangleMesh IsotropicParticleMesher::_polygonizeAll(FragmentedVector<MarkerParticle> &particles, 
+TriangleMesh IsotropicParticleMesher::_polygonizeAll(MarkerParticleVector &particles, 
 	                                                 FluidMaterialGrid &materialGrid) {
 	int subd = _subdivisionLevel;
 	int width = _isize*subd;
@@ -92,12 +102,15 @@ TriangleMesh IsotropicParticleMesher::_polygonizeAll(FragmentedVector<MarkerPart
 	_addPointsToScalarField(particles, field);
 
     Polygonizer3d polygonizer(&field);
+    for (unsigned int i = 0; i < particles.size(); i++) {
+        polygonizer.addSurfaceSeedPoint(particles.getPosition(i), _particleRadius);
+    }
     polygonizer.polygonizeSurface();
 
     return polygonizer.getTriangleMesh();
 }
 
-TriangleMesh IsotropicParticleMesher::_polygonizeSlices(FragmentedVector<MarkerParticle> &particles, 
+TriangleMesh IsotropicParticleMesher::_polygonizeSlices(MarkerParticleVector &particles, 
 	                                                    FluidMaterialGrid &materialGrid) {
 	int width, height, depth;
 	double dx;
@@ -110,24 +123,87 @@ TriangleMesh IsotropicParticleMesher::_polygonizeSlices(FragmentedVector<MarkerP
 		return _polygonizeAll(particles, materialGrid);
 	}
 
+	std::vector<int> sliceIntervals;
+	for (int i = 0; i < numSlices; i++) {
+		sliceIntervals.push_back(i*sliceWidth);
+	}
+	sliceIntervals.push_back(width);
+
+	int numthreads = _maxPolygonizationSlicesInFlight;
+	if (numthreads < 1) {
+		numthreads = ThreadUtils::getMaxThreadCount();
+	}
+	numthreads = (int)fmin(numthreads, numSlices);
+
+	// Slice polygonizers share the available threads
+	_slicePolygonizerThreadCount = (int)fmax(ThreadUtils::getMaxThreadCount() / numthreads, 1);
+
+	// Slice material grids are read concurrently, so the subdivision level 
+	// of the shared grid is set once for all threads
+	int origsubd = materialGrid.getSubdivisionLevel();
+	materialGrid.setSubdivisionLevel(_subdivisionLevel);
+
+	_sliceWidth = sliceWidth;
+	_scalarFieldSeamData = std::vector<Array3d<float> >(numSlices - 1);
+	std::atomic<int> nextSeam(0);
+	std::vector<std::thread> threads(numthreads);
+	for (int i = 0; i < numthreads; i++) {
+		threads[i] = std::thread(&IsotropicParticleMesher::_computeScalarFieldSeamDataThread, this,
+		                         &nextSeam, &particles);
+	}
+	for (int i = 0; i < numthreads; i++) {
+		threads[i].join();
+	}
+
+	std::vector<TriangleMesh> sliceMeshes(numSlices);
+	std::atomic<int> nextSlice(0);
+	for (int i = 0; i < numthreads; i++) {
+		threads[i] = std::thread(&IsotropicParticleMesher::_polygonizeSlicesThread, this,
+		                         &sliceIntervals, &nextSlice, &particles, &materialGrid,
+		                         &sliceMeshes);
+	}
+	for (int i = 0; i < numthreads; i++) {
+		threads[i].join();
+	}
+
+	materialGrid.setSubdivisionLevel(origsubd);
+	_scalarFieldSeamData.clear();
+	_scalarFieldSeamData.shrink_to_fit();
+
 	TriangleMesh mesh;
 	for (int i = 0; i < numSlices; i++) {
-		int startidx = i*sliceWidth;
-		int endidx = startidx + sliceWidth - 1;
-		endidx = endidx < width ? endidx : width - 1;
+		mesh.join(sliceMeshes[i]);
+		sliceMeshes[i] = TriangleMesh();
+	}
+
+	return mesh;
+}
+
+void IsotropicParticleMesher::_polygonizeSlicesThread(std::vector<int> *sliceIntervals,
+	                                                  std::atomic<int> *nextSlice,
+	                                                  MarkerParticleVector *particles,
+	                                                  FluidMaterialGrid *materialGrid,
+	                                                  std::vector<TriangleMesh> *sliceMeshes) {
+	int numSlices = (int)sliceMeshes->size();
+	for (;;) {
+		int sliceidx = (*nextSlice)++;
+		if (sliceidx >= numSlices) {
+			return;
+		}
 
-		TriangleMesh sliceMesh = _polygonizeSlice(startidx, endidx, particles, materialGrid);
+		int startidx = sliceIntervals->at(sliceidx);
+		int endidx = sliceIntervals->at(sliceidx + 1) - 1;
+
+		TriangleMesh sliceMesh = _polygonizeSlice(startidx, endidx, *particles, *materialGrid);
 
 		vmath::vec3 offset = _getSliceGridPositionOffset(startidx, endidx);
 		sliceMesh.translate(offset);
-		mesh.join(sliceMesh);
+		sliceMeshes->at(sliceidx) = std::move(sliceMesh);
 	}
-
-	return mesh;
 }
 
 TriangleMesh IsotropicParticleMesher::_polygonizeSlice(int startidx, int endidx, 
-		                                                FragmentedVector<MarkerParticle> &particles, 
+		                                                MarkerParticleVector &particles, 
 	                                                    FluidMaterialGrid &materialGrid) {
 
 	int width, height, depth;
@@ -147,14 +223,23 @@ TriangleMesh IsotropicParticleMesher::_polygonizeSlice(int startidx, int endidx,
 		gridWidth += 2;
 	}
 
+	FragmentedVector<vmath::vec3> sliceParticles;
+	_getSliceParticles(startidx, endidx, particles, sliceParticles);
+
 	ImplicitSurfaceScalarField field(gridWidth + 1, gridHeight + 1, gridDepth + 1, dx);
-	_computeSliceScalarField(startidx, endidx, particles, materialGrid, field);
+	_computeSliceScalarField(startidx, endidx, sliceParticles, materialGrid, field);
 
 	Array3d<bool> mask(gridWidth, gridHeight, gridDepth);
 	_getSliceMask(startidx, endidx, mask);
 
+	// The slice particles include every particle within a particle radius
+	// of the slice field, including those that set the seam values
 	Polygonizer3d polygonizer(&field);
 	polygonizer.setSurfaceCellMask(&mask);
+	for (unsigned int i = 0; i < sliceParticles.size(); i++) {
+		polygonizer.addSurfaceSeedPoint(sliceParticles[i], _particleRadius);
+	}
+	polygonizer.setMaxThreadCount(_slicePolygonizerThreadCount);
     polygonizer.polygonizeSurface();
 
     return polygonizer.getTriangleMesh();
@@ -168,12 +253,9 @@ void IsotropicParticleMesher::_getSubdividedGridDimensions(int *i, int *j, int *
 }
 
 void IsotropicParticleMesher::_computeSliceScalarField(int startidx, int endidx, 
-	                                                   FragmentedVector<MarkerParticle> &markerParticles,
+	                                                   FragmentedVector<vmath::vec3> &sliceParticles,
 	                                                   FluidMaterialGrid &materialGrid,
 	                                                   ImplicitSurfaceScalarField &field) {
-	
-	FragmentedVector<vmath::vec3> sliceParticles;
-	_getSliceParticles(startidx, endidx, markerParticles, sliceParticles);
 
 	int width, height, depth;
 	field.getGridDimensions(&width, &height, &depth);
@@ -209,12 +291,12 @@ vmath::vec3 IsotropicParticleMesher::_getSliceGridPositionOffset(int startidx, i
 }
 
 void IsotropicParticleMesher::_getSliceParticles(int startidx, int endidx, 
-	                                             FragmentedVector<MarkerParticle> &markerParticles,
+	                                             MarkerParticleVector &markerParticles,
 		                                         FragmentedVector<vmath::vec3> &sliceParticles) {
 	AABB bbox = _getSliceAABB(startidx, endidx);
 	for (unsigned int i = 0; i < markerParticles.size(); i++) {
-		if (bbox.isPointInside(markerParticles[i].position)) {
-			sliceParticles.push_back(markerParticles[i].position);
+		if (bbox.isPointInside(markerParticles.getPosition(i))) {
+			sliceParticles.push_back(markerParticles.getPosition(i));
 		}
 	}
 }
@@ -223,9 +305,8 @@ void IsotropicParticleMesher::_getSliceMaterialGrid(int startidx, int endidx,
 		                       FluidMaterialGrid &materialGrid,
 		                       FluidMaterialGrid &sliceMaterialGrid) {
 
-	int origsubd = materialGrid.getSubdivisionLevel();
-	materialGrid.setSubdivisionLevel(_subdivisionLevel);
-	
+	assert(materialGrid.getSubdivisionLevel() == _subdivisionLevel);
+
 	Material m;
 	for (int k = 0; k < sliceMaterialGrid.depth; k++) {
 		for (int j = 0; j < sliceMaterialGrid.height; j++) {
@@ -235,8 +316,6 @@ void IsotropicParticleMesher::_getSliceMaterialGrid(int startidx, int endidx,
 			}
 		}
 	}
-
-	materialGrid.setSubdivisionLevel(origsubd);
 }
 
 AABB IsotropicParticleMesher::_getSliceAABB(int startidx, int endidx) {
@@ -277,19 +356,21 @@ void IsotropicParticleMesher::_addPointsToScalarField(FragmentedVector<vmath::ve
 	}
 }
 
-void IsotropicParticleMesher::_addPointsToScalarField(FragmentedVector<MarkerParticle> &points,
+void IsotropicParticleMesher::_addPointsToScalarField(MarkerParticleVector &points,
 	                                                  ImplicitSurfaceScalarField &field) {
 	if (_isScalarFieldAcceleratorSet) {
 		_addPointsToScalarFieldAccelerator(points, field);
 	} else {
 		for (unsigned int i = 0; i < points.size(); i++) {
-	        field.addPoint(points[i].position);
+	        field.addPoint(points.getPosition(i));
 	    }
 	}
 }
 
 void IsotropicParticleMesher::_addPointsToScalarFieldAccelerator(FragmentedVector<vmath::vec3> &points,
 	                                                             ImplicitSurfaceScalarField &field) {
+	std::lock_guard<std::mutex> lock(_scalarFieldAcceleratorMutex);
+
 	bool isThresholdSet = _scalarFieldAccelerator->isMaxScalarFieldValueThresholdSet();
 	bool origThreshold = _scalarFieldAccelerator->getMaxScalarFieldValueThreshold();
 	_scalarFieldAccelerator->setMaxScalarFieldValueThreshold(_maxScalarFieldValueThreshold);
@@ -319,8 +400,10 @@ void IsotropicParticleMesher::_addPointsToScalarFieldAccelerator(FragmentedVecto
     }
 }
 
-void IsotropicParticleMesher::_addPointsToScalarFieldAccelerator(FragmentedVector<MarkerParticle> &points,
+void IsotropicParticleMesher::_addPointsToScalarFieldAccelerator(MarkerParticleVector &points,
                                                                  ImplicitSurfaceScalarField &field) {
+	std::lock_guard<std::mutex> lock(_scalarFieldAcceleratorMutex);
+
 	bool isThresholdSet = _scalarFieldAccelerator->isMaxScalarFieldValueThresholdSet();
 	bool origThreshold = _scalarFieldAccelerator->getMaxScalarFieldValueThreshold();
 	_scalarFieldAccelerator->setMaxScalarFieldValueThreshold(_maxScalarFieldValueThreshold);
@@ -337,7 +420,7 @@ void IsotropicParticleMesher::_addPointsToScalarFieldAccelerator(FragmentedVecto
 
         positions.clear();
         for (int i = startidx; i <= endidx; i++) {
-            positions.push_back(points[i].position);
+            positions.push_back(points.getPosition(i));
         }
 
         _scalarFieldAccelerator->addPoints(positions, field);
@@ -350,6 +433,12 @@ void IsotropicParticleMesher::_addPointsToScalarFieldAccelerator(FragmentedVecto
     }
 }
 
+/*
+	Both slices that share a seam overwrite the three overlapping planes of
+	their scalar fields with the same seam data. Seam data is computed for
+	all seams before the slices are polygonized, so neighbouring slices 
+	produce identical values on the seam without waiting on each other.
+*/
 void IsotropicParticleMesher::_updateScalarFieldSeam(int startidx, int endidx,
 	                                                 ImplicitSurfaceScalarField &field) {
 	int width, height, depth;
@@ -358,37 +447,71 @@ void IsotropicParticleMesher::_updateScalarFieldSeam(int startidx, int endidx,
 
 	bool isStartSlice = startidx == 0;
 	bool isEndSlice = endidx == width - 1;
+	int sliceidx = startidx / _sliceWidth;
 
 	if (!isStartSlice) {
-		_applyScalarFieldSliceSeamData(field);
+		_applyScalarFieldSeamData(_scalarFieldSeamData[sliceidx - 1], 0, field);
 	}
 	if (!isEndSlice) {
-		_saveScalarFieldSliceSeamData(field);
+		int fieldWidth, fieldHeight, fieldDepth;
+		field.getGridDimensions(&fieldWidth, &fieldHeight, &fieldDepth);
+		_applyScalarFieldSeamData(_scalarFieldSeamData[sliceidx], fieldWidth - 3, field);
+	}
+}
+
+void IsotropicParticleMesher::_computeScalarFieldSeamDataThread(std::atomic<int> *nextSeam,
+	                                                            MarkerParticleVector *particles) {
+	int numSeams = (int)_scalarFieldSeamData.size();
+	for (;;) {
+		int seam = (*nextSeam)++;
+		if (seam >= numSeams) {
+			return;
+		}
+
+		int seamidx = (seam + 1)*_sliceWidth - 1;
+		_computeScalarFieldSeamData(seamidx, *particles, _scalarFieldSeamData[seam]);
 	}
 }
 
-void IsotropicParticleMesher::_applyScalarFieldSliceSeamData(ImplicitSurfaceScalarField &field) {
+void IsotropicParticleMesher::_computeScalarFieldSeamData(int seamidx, 
+	                                                      MarkerParticleVector &particles,
+	                                                      Array3d<float> &seamData) {
 	int width, height, depth;
-	field.getGridDimensions(&width, &height, &depth);
+	double dx;
+	_getSubdividedGridDimensions(&width, &height, &depth, &dx);
+
+	vmath::vec3 offset(seamidx*dx, 0.0, 0.0);
+	AABB bbox(offset, 2.0*dx, height*dx, depth*dx);
+	bbox.expand(2.0*_particleRadius);
 
-	for (int k = 0; k < depth; k++) {
-		for (int j = 0; j < height; j++) {
-			for (int i = 0; i <= 2; i++) {
-				field.setScalarFieldValue(i, j, k, _scalarFieldSeamData(i, j, k));
+	FragmentedVector<vmath::vec3> seamParticles;
+	for (unsigned int i = 0; i < particles.size(); i++) {
+		if (bbox.isPointInside(particles.getPosition(i))) {
+			seamParticles.push_back(particles.getPosition(i));
+		}
+	}
+
+	ImplicitSurfaceScalarField field(3, height + 1, depth + 1, dx);
+	field.setOffset(offset);
+	field.setPointRadius(_particleRadius);
+	_addPointsToScalarField(seamParticles, field);
+
+	seamData = Array3d<float>(3, height + 1, depth + 1);
+	for (int k = 0; k < seamData.depth; k++) {
+		for (int j = 0; j < seamData.height; j++) {
+			for (int i = 0; i < seamData.width; i++) {
+				seamData.set(i, j, k, field.getRawScalarFieldValue(i, j, k));
 			}
 		}
 	}
 }
 
-void IsotropicParticleMesher::_saveScalarFieldSliceSeamData(ImplicitSurfaceScalarField &field) {
-	int width, height, depth;
-	field.getGridDimensions(&width, &height, &depth);
-
-	_scalarFieldSeamData = Array3d<float>(3, height, depth);
-	for (int k = 0; k < depth; k++) {
-		for (int j = 0; j < height; j++) {
-			for (int i = 0; i <= 2; i++) {
-				_scalarFieldSeamData.set(i, j, k, field.getRawScalarFieldValue(i + width - 3, j, k));
+void IsotropicParticleMesher::_applyScalarFieldSeamData(Array3d<float> &seamData, int fieldidx,
+	                                                    ImplicitSurfaceScalarField &field) {
+	for (int k = 0; k < seamData.depth; k++) {
+		for (int j = 0; j < seamData.height; j++) {
+			for (int i = 0; i < seamData.width; i++) {
+				field.setScalarFieldValue(fieldidx + i, j, k, seamData(i, j, k));
 			}
 		}
 	}
@@ -24,9 +24,13 @@ freely, subject to the following restrictions:
 #include <iostream>
 #include <vector>
 #include <assert.h>
+#include <thread>
+#include <atomic>
+#include <mutex>
 
 #include "fragmentedvector.h"
 #include "markerparticle.h"
+#include "markerparticlevector.h"
 #include "fluidmaterialgrid.h"
 #include "trianglemesh.h"
 #include "implicitsurfacescalarfield.h"
@@ -34,6 +38,7 @@ freely, subject to the following restrictions:
 #include "polygonizer3d.h"
 #include "aabb.h"
 #include "vmath.h"
+#include "threadutils.h"
 
 class IsotropicParticleMesher {
 
@@ -44,8 +49,9 @@ public:
 
 	void setSubdivisionLevel(int n);
 	void setNumPolygonizationSlices(int n);
+	void setMaxPolygonizationSlicesInFlight(int n);
 
-	TriangleMesh meshParticles(FragmentedVector<MarkerParticle> &particles, 
+	TriangleMesh meshParticles(MarkerParticleVector &particles, 
 		                       FluidMaterialGrid &materialGrid,
 		                       double particleRadius);
 
@@ -54,22 +60,27 @@ public:
 
 private:
 
-	TriangleMesh _polygonizeAll(FragmentedVector<MarkerParticle> &particles,
+	TriangleMesh _polygonizeAll(MarkerParticleVector &particles,
 	                            FluidMaterialGrid &materialGrid);
 
-	TriangleMesh _polygonizeSlices(FragmentedVector<MarkerParticle> &particles,
+	TriangleMesh _polygonizeSlices(MarkerParticleVector &particles,
 	                               FluidMaterialGrid &materialGrid);
+	void _polygonizeSlicesThread(std::vector<int> *sliceIntervals,
+	                             std::atomic<int> *nextSlice,
+	                             MarkerParticleVector *particles,
+	                             FluidMaterialGrid *materialGrid,
+	                             std::vector<TriangleMesh> *sliceMeshes);
 	TriangleMesh _polygonizeSlice(int startidx, int endidx, 
-		                          FragmentedVector<MarkerParticle> &particles, 
+		                          MarkerParticleVector &particles, 
 	                              FluidMaterialGrid &materialGrid);
 	void _getSubdividedGridDimensions(int *i, int *j, int *k, double *dx);
 	void _computeSliceScalarField(int startidx, int endidx, 
-		                          FragmentedVector<MarkerParticle> &particles,
+		                          FragmentedVector<vmath::vec3> &sliceParticles,
 		                          FluidMaterialGrid &materialGrid,
 		                          ImplicitSurfaceScalarField &field);
 	vmath::vec3 _getSliceGridPositionOffset(int startidx, int endidx);
 	void _getSliceParticles(int startidx, int endidx, 
-		                    FragmentedVector<MarkerParticle> &markerParticles,
+		                    MarkerParticleVector &markerParticles,
 		                    FragmentedVector<vmath::vec3> &sliceParticles);
 	void _getSliceMaterialGrid(int startidx, int endidx,
 		                       FluidMaterialGrid &materialGrid,
@@ -77,15 +88,20 @@ private:
 	AABB _getSliceAABB(int startidx, int endidx);
 	void _addPointsToScalarField(FragmentedVector<vmath::vec3> &points,
 	                             ImplicitSurfaceScalarField &field);
-	void _addPointsToScalarField(FragmentedVector<MarkerParticle> &points,
+	void _addPointsToScalarField(MarkerParticleVector &points,
 	                             ImplicitSurfaceScalarField &field);
 	void _addPointsToScalarFieldAccelerator(FragmentedVector<vmath::vec3> &points,
 	                                        ImplicitSurfaceScalarField &field);
-	void _addPointsToScalarFieldAccelerator(FragmentedVector<MarkerParticle> &points,
+	void _addPointsToScalarFieldAccelerator(MarkerParticleVector &points,
 	                                        ImplicitSurfaceScalarField &field);
 	void _updateScalarFieldSeam(int startidx, int endidx, ImplicitSurfaceScalarField &field);
-	void _applyScalarFieldSliceSeamData(ImplicitSurfaceScalarField &field);
-	void _saveScalarFieldSliceSeamData(ImplicitSurfaceScalarField &field);
+	void _computeScalarFieldSeamDataThread(std::atomic<int> *nextSeam,
+	                                       MarkerParticleVector *particles);
+	void _computeScalarFieldSeamData(int seamidx, 
+		                             MarkerParticleVector &particles,
+		                             Array3d<float> &seamData);
+	void _applyScalarFieldSeamData(Array3d<float> &seamData, int fieldidx,
+		                           ImplicitSurfaceScalarField &field);
 	void _getSliceMask(int startidx, int endidx, Array3d<bool> &mask);
 
 	int _isize = 0;
@@ -95,15 +111,19 @@ private:
 
 	int _subdivisionLevel = 1;
 	int _numPolygonizationSlices = 1;
+	int _maxPolygonizationSlicesInFlight = 0;
+	int _sliceWidth = 0;
+	int _slicePolygonizerThreadCount = 0;
 
 	double _particleRadius = 0.0;
 	double _maxScalarFieldValueThreshold = 1.0;
 
-	Array3d<float> _scalarFieldSeamData;
+	std::vector<Array3d<float> > _scalarFieldSeamData;
 
 	int _maxParticlesPerScalarFieldAddition = 5e6;
 	bool _isScalarFieldAcceleratorSet = false;
 	CLScalarField *_scalarFieldAccelerator;
+	std::mutex _scalarFieldAcceleratorMutex;
 
 
 };
@@ -56,30 +56,109 @@ void LevelSet::_getTriangleGridCellOverlap(Triangle t, GridIndexVector &cells) {
     }
 }
 
-void LevelSet::_calculateDistancesSquaredForTriangle(int index) {
-    Triangle t = _surfaceMesh.triangles[index];
+/*
+    Triangles are first binned to the cells they overlap in parallel. The 
+    (cell, triangle) pairs are then sorted so that the pairs of each cell are 
+    contiguous and in triangle order, and the ranges of cells are split 
+    between threads. A cell is only written by the thread that owns it, and 
+    ties are broken towards the lowest triangle index as in a serial pass 
+    over the triangles.
+*/
+void LevelSet::_calculateUnsignedSurfaceDistanceSquared() {
+    _cellTrianglePairs.clear();
+    _narrowBandCells.clear();
+
+    int numTriangles = _surfaceMesh.triangles.size();
+    if (numTriangles == 0) {
+        return;
+    }
+
+    int numthreads = (int)fmin(ThreadUtils::getMaxThreadCount(), 
+                               ceil((double)numTriangles / (double)_minTrianglesPerThread));
+    if ((int)_threadCellTrianglePairs.size() < numthreads) {
+        _threadCellTrianglePairs.resize(numthreads);
+    }
+
+    std::vector<int> intervals = ThreadUtils::splitRangeIntoIntervals(0, numTriangles, 
+                                                                      numthreads);
+    std::vector<std::thread> threads(numthreads);
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&LevelSet::_findTriangleCellOverlapThread, this,
+                                 intervals[i], intervals[i + 1], i);
+    }
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
+
+    for (int i = 0; i < numthreads; i++) {
+        std::vector<CellTrianglePair> *pairs = &(_threadCellTrianglePairs[i]);
+        _cellTrianglePairs.insert(_cellTrianglePairs.end(), pairs->begin(), pairs->end());
+    }
+    std::sort(_cellTrianglePairs.begin(), _cellTrianglePairs.end());
+
+    int numPairs = _cellTrianglePairs.size();
+    if (numPairs == 0) {
+        return;
+    }
+
+    numthreads = (int)fmin(ThreadUtils::getMaxThreadCount(), 
+                           ceil((double)numPairs / (double)_minCellsPerThread));
+    intervals = ThreadUtils::splitRangeIntoIntervals(0, numPairs, numthreads);
+
+    // Move interval boundaries forward so that no cell is split between threads
+    for (int i = 1; i < numthreads; i++) {
+        int idx = (int)fmax(intervals[i], intervals[i - 1]);
+        while (idx > 0 && idx < numPairs && 
+                _cellTrianglePairs[idx].cell == _cellTrianglePairs[idx - 1].cell) {
+            idx++;
+        }
+        intervals[i] = idx;
+    }
+
+    threads = std::vector<std::thread>(numthreads);
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&LevelSet::_calculateSurfaceDistancesSquaredThread, this,
+                                 intervals[i], intervals[i + 1]);
+    }
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
+
+    for (int i = 0; i < numPairs; i++) {
+        if (i == 0 || _cellTrianglePairs[i].cell != _cellTrianglePairs[i - 1].cell) {
+            _narrowBandCells.push_back(_cellTrianglePairs[i].cell);
+        }
+    }
+}
+
+void LevelSet::_findTriangleCellOverlapThread(int startidx, int endidx, int threadidx) {
+    std::vector<CellTrianglePair> *pairs = &(_threadCellTrianglePairs[threadidx]);
+    pairs->clear();
 
     GridIndexVector cells(_isize, _jsize, _ksize);
-    _getTriangleGridCellOverlap(t, cells);
+    for (int tidx = startidx; tidx < endidx; tidx++) {
+        cells.clear();
+        _getTriangleGridCellOverlap(_surfaceMesh.triangles[tidx], cells);
+        for (unsigned int i = 0; i < cells.size(); i++) {
+            pairs->push_back(CellTrianglePair(cells.getFlatIndex(i), tidx));
+        }
+    }
+}
 
+void LevelSet::_calculateSurfaceDistancesSquaredThread(int startidx, int endidx) {
     GridIndex g;
     double distsq;
-    for (unsigned int i = 0; i < cells.size(); i++) {
-        g = cells[i];
-        distsq = _minDistToTriangleSquared(g, index);
+    for (int i = startidx; i < endidx; i++) {
+        CellTrianglePair pair = _cellTrianglePairs[i];
+        g = Grid3d::getUnflattenedIndex(pair.cell, _isize, _jsize);
+        distsq = _minDistToTriangleSquared(g, pair.tidx);
 
         if (!_isDistanceSet(g) || distsq < _signedDistance(g)) {
-            _setLevelSetCell(g, distsq, index);
+            _setLevelSetCell(g, distsq, pair.tidx);
         }
     }
 }
 
-void LevelSet::_calculateUnsignedSurfaceDistanceSquared() {
-    for (unsigned int i = 0; i < _surfaceMesh.triangles.size(); i++) {
-        _calculateDistancesSquaredForTriangle(i);
-    }
-}
-
 void LevelSet::_getNeighbourGridIndices6(GridIndex g, GridIndex n[6]) {
     n[0] = GridIndex(g.i-1, g.j, g.k);
     n[1] = GridIndex(g.i+1, g.j, g.k);
@@ -112,15 +191,9 @@ void LevelSet::_getCellLayers(std::vector<GridIndexVector> &layers) {
     Array3d<int> layerGrid(_isize, _jsize, _ksize, -1);
 
     GridIndexVector layer(_isize, _jsize, _ksize);
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize; i++) {
-                if (_isDistanceSet(i, j, k)) {
-                    layer.push_back(i, j, k);
-                    layerGrid.set(i, j, k, 0);
-                }
-            }
-        }
+    layer.insertFlatIndices(_narrowBandCells);
+    for (unsigned int i = 0; i < layer.size(); i++) {
+        layerGrid.set(layer[i], 0);
     }
 
     GridIndexVector q(_isize, _jsize, _ksize);
@@ -187,18 +260,39 @@ void LevelSet::_calculateUnsignedDistanceSquared() {
     _getCellLayers(cellLayers);
 
     for (unsigned int i = 0; i < cellLayers.size(); i++) {
+        for (unsigned int j = 0; j < cellLayers[i].size(); j++) {
+            _narrowBandCells.push_back(cellLayers[i].getFlatIndex(j));
+        }
         _calculateUnsignedDistanceSquaredForLayer(cellLayers[i]);
     }
+    std::sort(_narrowBandCells.begin(), _narrowBandCells.end());
 }
 
 void LevelSet::_squareRootDistanceField() {
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize; i++) {
-                if (_isDistanceSet(i, j, k)) {
-                    _signedDistance.set(i, j, k, sqrt(_signedDistance(i, j, k)));
-                }
-            }
+    int numCells = _narrowBandCells.size();
+    if (numCells == 0) {
+        return;
+    }
+
+    int numthreads = (int)fmin(ThreadUtils::getMaxThreadCount(), 
+                               ceil((double)numCells / (double)_minCellsPerThread));
+    std::vector<int> intervals = ThreadUtils::splitRangeIntoIntervals(0, numCells, numthreads);
+    std::vector<std::thread> threads(numthreads);
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&LevelSet::_squareRootDistanceFieldThread, this,
+                                 intervals[i], intervals[i + 1]);
+    }
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
+}
+
+void LevelSet::_squareRootDistanceFieldThread(int startidx, int endidx) {
+    GridIndex g;
+    for (int i = startidx; i < endidx; i++) {
+        g = Grid3d::getUnflattenedIndex(_narrowBandCells[i], _isize, _jsize);
+        if (_isDistanceSet(g)) {
+            _signedDistance.set(g, sqrt(_signedDistance(g)));
         }
     }
 }
@@ -231,14 +325,33 @@ void LevelSet::_calculateDistanceFieldSigns() {
         triangleFaceCenters.push_back(_surfaceMesh.getTriangleCenter(i));
     }
 
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize; i++) {
-                if (_isDistanceSet(i, j, k)) {
-                    _updateCellSign(GridIndex(i, j, k), triangleFaceCenters,
-                                                        triangleFaceDirections);
-                }
-            }
+    int numCells = _narrowBandCells.size();
+    if (numCells == 0) {
+        return;
+    }
+
+    int numthreads = (int)fmin(ThreadUtils::getMaxThreadCount(), 
+                               ceil((double)numCells / (double)_minCellsPerThread));
+    std::vector<int> intervals = ThreadUtils::splitRangeIntoIntervals(0, numCells, numthreads);
+    std::vector<std::thread> threads(numthreads);
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&LevelSet::_updateCellSignsThread, this,
+                                 intervals[i], intervals[i + 1],
+                                 &triangleFaceCenters, &triangleFaceDirections);
+    }
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
+}
+
+void LevelSet::_updateCellSignsThread(int startidx, int endidx,
+                                      std::vector<vmath::vec3> *triangleCenters, 
+                                      std::vector<vmath::vec3> *triangleDirections) {
+    GridIndex g;
+    for (int i = startidx; i < endidx; i++) {
+        g = Grid3d::getUnflattenedIndex(_narrowBandCells[i], _isize, _jsize);
+        if (_isDistanceSet(g)) {
+            _updateCellSign(g, *triangleCenters, *triangleDirections);
         }
     }
 }
@@ -302,10 +415,133 @@ void LevelSet::calculateSignedDistanceField(int numLayers) {
     _numLayers = numLayers;
     _resetSignedDistanceField();
     _calculateUnsignedSurfaceDistanceSquared();
-    _calculateUnsignedDistanceSquared();
-    _squareRootDistanceField();
+
+    StopWatch timer;
+    timer.start();
+    if (_isFastMarchingRedistancingEnabled) {
+        _squareRootDistanceField();
+        _calculateUnsignedDistanceFastMarching();
+    } else {
+        _calculateUnsignedDistanceSquared();
+        _squareRootDistanceField();
+    }
+    timer.stop();
+
     _calculateDistanceFieldSigns();
-    _floodFillMissingSignedDistances();
+
+    timer.start();
+    if (_isFastMarchingRedistancingEnabled) {
+        _fillMissingSignedDistancesFromNarrowBand();
+    } else {
+        _floodFillMissingSignedDistances();
+    }
+    timer.stop();
+
+    _redistancingTime = timer.getTime();
+}
+
+void LevelSet::enableFastMarchingRedistancing() {
+    _isFastMarchingRedistancingEnabled = true;
+}
+
+void LevelSet::disableFastMarchingRedistancing() {
+    _isFastMarchingRedistancingEnabled = false;
+}
+
+bool LevelSet::isFastMarchingRedistancingEnabled() {
+    return _isFastMarchingRedistancingEnabled;
+}
+
+double LevelSet::getRedistancingTime() {
+    return _redistancingTime;
+}
+
+/*
+    Propagates closest triangles outward from the surface cells in order of
+    increasing distance, like Dijkstra's algorithm. A cell's distance is the 
+    distance to the closest of its neighbours' triangles, so the values are 
+    exact distances to a surface triangle rather than a first order Eikonal 
+    estimate. Because cells are expanded nearest first, a cell is rarely 
+    improved after it is expanded, unlike the layer by layer propagation.
+
+    Cells are only expanded while their distance is within _numLayers cells 
+    of the surface. Expects the surface cell distances to be unsquared.
+*/
+void LevelSet::_calculateUnsignedDistanceFastMarching() {
+    typedef std::pair<float, int> QueueItem;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, 
+                        std::greater<QueueItem> > queue;
+
+    for (unsigned int i = 0; i < _narrowBandCells.size(); i++) {
+        int flatidx = _narrowBandCells[i];
+        GridIndex g = Grid3d::getUnflattenedIndex(flatidx, _isize, _jsize);
+        queue.push(QueueItem(_signedDistance(g), flatidx));
+    }
+
+    double maxDistance = _numLayers * _dx;
+    GridIndex ns[6];
+    while (!queue.empty()) {
+        QueueItem item = queue.top();
+        queue.pop();
+
+        GridIndex g = Grid3d::getUnflattenedIndex(item.second, _isize, _jsize);
+        if (item.first > _signedDistance(g)) {
+            continue;
+        }
+
+        int tidx = _indexGrid(g);
+        _getNeighbourGridIndices6(g, ns);
+        for (int i = 0; i < 6; i++) {
+            GridIndex n = ns[i];
+            if (!Grid3d::isGridIndexInRange(n, _isize, _jsize, _ksize)) {
+                continue;
+            }
+
+            bool isSet = _isDistanceSet(n);
+            float dist = (float)sqrt(_minDistToTriangleSquared(n, tidx));
+            if (isSet && dist >= _signedDistance(n)) {
+                continue;
+            }
+
+            int flatidx = Grid3d::getFlatIndex(n, _isize, _jsize);
+            if (!isSet) {
+                _narrowBandCells.push_back(flatidx);
+            }
+            _setLevelSetCell(n, dist, tidx);
+            if (dist <= maxDistance) {
+                queue.push(QueueItem(dist, flatidx));
+            }
+        }
+    }
+
+    std::sort(_narrowBandCells.begin(), _narrowBandCells.end());
+}
+
+/*
+    Fills all cells that were not reached by redistancing with an infinite
+    distance. The fill runs breadth first from every narrow band cell at 
+    once, so each cell takes the sign of the nearest band cell, and each 
+    cell is visited once.
+*/
+void LevelSet::_fillMissingSignedDistancesFromNarrowBand() {
+    std::vector<int> queue(_narrowBandCells);
+
+    GridIndex ns[6];
+    double inf = std::numeric_limits<double>::infinity();
+    for (unsigned int qidx = 0; qidx < queue.size(); qidx++) {
+        GridIndex g = Grid3d::getUnflattenedIndex(queue[qidx], _isize, _jsize);
+        double dist = _signedDistance(g) > 0.0 ? inf : -inf;
+
+        Grid3d::getNeighbourGridIndices6(g, ns);
+        for (int i = 0; i < 6; i++) {
+            GridIndex n = ns[i];
+            if (Grid3d::isGridIndexInRange(n, _isize, _jsize, _ksize) && 
+                    !_isDistanceSet(n)) {
+                _setLevelSetCell(n, dist, -1);
+                queue.push_back(Grid3d::getFlatIndex(n, _isize, _jsize));
+            }
+        }
+    }
 }
 
 double LevelSet::_minDistToTriangleSquared(GridIndex g, int tidx) {
@@ -25,6 +25,10 @@ freely, subject to the following restrictions:
 #include <string>
 #include <vector>
 #include <queue>
+#include <thread>
+#include <algorithm>
+#include <functional>
+#include <limits>
 
 #include "vmath.h"
 #include "array3d.h"
@@ -34,6 +38,8 @@ freely, subject to the following restrictions:
 #include "trianglemesh.h"
 #include "macvelocityfield.h"
 #include "gridindexvector.h"
+#include "threadutils.h"
+#include "stopwatch.h"
 
 class LevelSet
 {
@@ -49,7 +55,7 @@ public:
     double getSurfaceCurvature(vmath::vec3 p);
     double getSurfaceCurvature(vmath::vec3 p, vmath::vec3 *normal);
     double getSurfaceCurvature(unsigned int tidx);
-    Array3d<float> getSignedDistanceField() { return _signedDistance; }
+    Array3d<float, SimulationGridLayout> getSignedDistanceField() { return _signedDistance; }
     vmath::vec3 getClosestPointOnSurface(vmath::vec3 p);
     vmath::vec3 getClosestPointOnSurface(vmath::vec3 p, int *tidx);
     double getDistance(vmath::vec3 p);
@@ -58,10 +64,28 @@ public:
     double getSignedDistance(GridIndex g);
     bool isPointInInsideCell(vmath::vec3 p);
 
+    /*
+        Enable/disable fast marching redistancing. Distances beyond the
+        cells that overlap the surface are propagated in order of increasing
+        distance, and cells outside of the narrow band take the sign of the
+        nearest band cell. When disabled, distances are propagated layer by 
+        layer and cells outside of the band are flood filled.
+
+        Disabled by default.
+    */
+    void enableFastMarchingRedistancing();
+    void disableFastMarchingRedistancing();
+    bool isFastMarchingRedistancingEnabled();
+
+    // Time in seconds spent propagating and filling distances beyond the
+    // surface cells during the last calculateSignedDistanceField call
+    double getRedistancingTime();
+
 private:
     void _resetSignedDistanceField();
     void _calculateUnsignedSurfaceDistanceSquared();
-    void _calculateDistancesSquaredForTriangle(int triangleIndex);
+    void _findTriangleCellOverlapThread(int startidx, int endidx, int threadidx);
+    void _calculateSurfaceDistancesSquaredThread(int startidx, int endidx);
     void _getTriangleGridCellOverlap(Triangle t, GridIndexVector &cells);
     void _calculateUnsignedDistanceSquared();
     void _getCellLayers(std::vector<GridIndexVector> &layers);
@@ -73,11 +97,17 @@ private:
     void _setLevelSetCell(GridIndex g, double dist, int tidx);
     void _resetLevelSetCell(GridIndex g);
     void _squareRootDistanceField();
+    void _squareRootDistanceFieldThread(int startidx, int endidx);
+    void _updateCellSignsThread(int startidx, int endidx,
+                                std::vector<vmath::vec3> *triangleCenters, 
+                                std::vector<vmath::vec3> *triangleDirections);
     void _calculateDistanceFieldSigns();
     void _updateCellSign(GridIndex g, std::vector<vmath::vec3> &triangleCenters, 
                                       std::vector<vmath::vec3> &triangleDirections);
     void _floodFillMissingSignedDistances();
     void _floodFillWithDistance(GridIndex g, double val);
+    void _calculateUnsignedDistanceFastMarching();
+    void _fillMissingSignedDistancesFromNarrowBand();
 
     vmath::vec3 _findClosestPointOnSurface(GridIndex g);
     vmath::vec3 _findClosestPointOnSurface(vmath::vec3 p);
@@ -110,10 +140,36 @@ private:
 
     TriangleMesh _surfaceMesh;
 
-    Array3d<float> _signedDistance;
+    Array3d<float, SimulationGridLayout> _signedDistance;
     Array3d<int> _indexGrid;
     Array3d<bool> _isDistanceSet;
 
+    /*
+        Surface cells and the triangles that overlap them, sorted by cell and 
+        then by triangle. Each cell's run of pairs is processed by a single 
+        thread.
+    */
+    struct CellTrianglePair {
+        int cell;
+        int tidx;
+
+        CellTrianglePair() : cell(0), tidx(0) {}
+        CellTrianglePair(int c, int t) : cell(c), tidx(t) {}
+
+        bool operator<(const CellTrianglePair &other) const {
+            return cell < other.cell || (cell == other.cell && tidx < other.tidx);
+        }
+    };
+    std::vector<std::vector<CellTrianglePair> > _threadCellTrianglePairs;
+    std::vector<CellTrianglePair> _cellTrianglePairs;
+
+    // Flat indices of all cells with a distance value, sorted
+    std::vector<int> _narrowBandCells;
+    int _minTrianglesPerThread = 5000;
+    bool _isFastMarchingRedistancingEnabled = false;
+    double _redistancingTime = 0.0;
+    int _minCellsPerThread = 20000;
+
     std::vector<double> _vertexCurvatures;
     double _surfaceCurvatureSampleRadius = 6.0;  // radius in # of cells
     int _maxSurfaceCurvatureSamples = 40;
@@ -35,9 +35,9 @@ MACVelocityField::~MACVelocityField() {
 }
 
 void MACVelocityField::_initializeVelocityGrids() {
-    _u = Array3d<float>(_isize + 1, _jsize, _ksize, 0.0f);
-    _v = Array3d<float>(_isize, _jsize + 1, _ksize, 0.0f);
-    _w = Array3d<float>(_isize, _jsize, _ksize + 1, 0.0f);
+    _u = SparseArray3d<float>(_isize + 1, _jsize, _ksize, 0.0f);
+    _v = SparseArray3d<float>(_isize, _jsize + 1, _ksize, 0.0f);
+    _w = SparseArray3d<float>(_isize, _jsize, _ksize + 1, 0.0f);
 
     _u.setOutOfRangeValue(0.0f);
     _v.setOutOfRangeValue(0.0f);
@@ -72,30 +72,18 @@ void MACVelocityField::clear() {
     clearW();
 }
 
-Array3d<float>* MACVelocityField::getArray3dU() {
+SparseArray3d<float>* MACVelocityField::getArray3dU() {
     return &_u;
 }
 
-Array3d<float>* MACVelocityField::getArray3dV() {
+SparseArray3d<float>* MACVelocityField::getArray3dV() {
     return &_v;
 }
 
-Array3d<float>* MACVelocityField::getArray3dW() {
+SparseArray3d<float>* MACVelocityField::getArray3dW() {
     return &_w;
 }
 
-float* MACVelocityField::getRawArrayU() {
-    return _u.getRawArray();
-}
-
-float* MACVelocityField::getRawArrayV() {
-    return _v.getRawArray();
-}
-
-float* MACVelocityField::getRawArrayW() {
-    return _w.getRawArray();
-}
-
 float MACVelocityField::U(int i, int j, int k) {
     if (!isIndexInRangeU(i, j, k)) {
         return _default_out_of_range_value;
@@ -180,21 +168,21 @@ void MACVelocityField::setW(GridIndex g, double val) {
     setW(g.i, g.j, g.k, val);
 }
 
-void MACVelocityField::setU(Array3d<float> &ugrid) {
+void MACVelocityField::setU(SparseArray3d<float> &ugrid) {
     assert(ugrid.width == _u.width && 
            ugrid.height == _u.height && 
            ugrid.depth == _u.depth);
     _u = ugrid;
 }
 
-void MACVelocityField::setV(Array3d<float> &vgrid) {
+void MACVelocityField::setV(SparseArray3d<float> &vgrid) {
     assert(vgrid.width == _v.width && 
            vgrid.height == _v.height && 
            vgrid.depth == _v.depth);
     _v = vgrid;
 }
 
-void MACVelocityField::setW(Array3d<float> &wgrid) {
+void MACVelocityField::setW(SparseArray3d<float> &wgrid) {
     assert(wgrid.width == _w.width && 
            wgrid.height == _w.height && 
            wgrid.depth == _w.depth);
@@ -637,51 +625,120 @@ vmath::vec3 MACVelocityField::evaluateVelocityAtPositionLinear(double x, double
     return vmath::vec3(xvel, yvel, zvel);
 }
 
-void MACVelocityField::_updateExtrapolationLayer(int layerIndex, 
-                                                 FluidMaterialGrid &matGrid,
-                                                 Array3d<int> &layerGrid) {
-    GridIndex neighbours[6];
-    GridIndex n;
+void MACVelocityField::_initializeExtrapolationBuffers(FluidMaterialGrid *matGrid) {
+    SparseArray3d<int> *layerGrid = &(_extrapolation.layerGrid);
+    if (layerGrid->width != _isize || layerGrid->height != _jsize || 
+            layerGrid->depth != _ksize) {
+        _extrapolation.layerGrid = SparseArray3d<int>(_isize, _jsize, _ksize, -1);
+        _extrapolation.layers.clear();
+    }
 
-    for (int k = 0; k < layerGrid.depth; k++) {
-        for (int j = 0; j < layerGrid.height; j++) {
-            for (int i = 0; i < layerGrid.width; i++) {
-                if (layerGrid(i, j, k) == layerIndex - 1 && !matGrid.isCellSolid(i, j, k)) {
-                    Grid3d::getNeighbourGridIndices6(i, j, k, neighbours);
-                    for (int idx = 0; idx < 6; idx++) {
-                        n = neighbours[idx];
-
-                        if (Grid3d::isGridIndexInRange(n, _isize, _jsize, _ksize) && 
-                                layerGrid(n) == -1 && !matGrid.isCellSolid(n)) {
-                            layerGrid.set(n, layerIndex);
-                        }
-                    }
-                }
-            }
+    _resetPreviousExtrapolationBand(matGrid);
+    _extrapolation.layers.resize(_numExtrapolationLayers + 1);
+
+    int numthreads = ThreadUtils::getMaxThreadCount();
+    if ((int)_extrapolation.threadCells.size() < numthreads) {
+        _extrapolation.threadCells.resize(numthreads);
+    }
+}
+
+/*
+    Only the faces of the band labeled by the previous call can hold 
+    extrapolated velocities, so these are the only faces that are zeroed. 
+    Filling the layer grid returns its tiles to the grid's free list to be 
+    reused by the next band.
+*/
+void MACVelocityField::_resetPreviousExtrapolationBand(FluidMaterialGrid *matGrid) {
+    for (unsigned int lidx = 0; lidx < _extrapolation.layers.size(); lidx++) {
+        std::vector<GridIndex> *layer = &(_extrapolation.layers[lidx]);
+        for (unsigned int idx = 0; idx < layer->size(); idx++) {
+            GridIndex g = layer->at(idx);
+            int i = g.i; int j = g.j; int k = g.k;
+
+            if (!matGrid->isFaceBorderingFluidU(i, j, k))     { _u.set(i, j, k, 0.0f); }
+            if (!matGrid->isFaceBorderingFluidU(i + 1, j, k)) { _u.set(i + 1, j, k, 0.0f); }
+            if (!matGrid->isFaceBorderingFluidV(i, j, k))     { _v.set(i, j, k, 0.0f); }
+            if (!matGrid->isFaceBorderingFluidV(i, j + 1, k)) { _v.set(i, j + 1, k, 0.0f); }
+            if (!matGrid->isFaceBorderingFluidW(i, j, k))     { _w.set(i, j, k, 0.0f); }
+            if (!matGrid->isFaceBorderingFluidW(i, j, k + 1)) { _w.set(i, j, k + 1, 0.0f); }
         }
+        layer->clear();
     }
+    _extrapolation.layerGrid.fill(-1);
 }
 
-void MACVelocityField::_updateExtrapolationLayers(FluidMaterialGrid &matGrid, 
-                                                  Array3d<int> &layerGrid) {
+void MACVelocityField::_findFirstExtrapolationLayerThread(int startidx, int endidx,
+                                                          GridIndexVector *fluidCells,
+                                                          FluidMaterialGrid *matGrid,
+                                                          int threadidx) {
+    // Non fluid neighbours of fluid cells make up the first extrapolation layer
+    std::vector<GridIndex> *cells = &(_extrapolation.threadCells[threadidx]);
+    cells->clear();
+    for (int i = startidx; i < endidx; i++) {
+        _addExtrapolationLayerCandidates(fluidCells->at(i), matGrid, cells);
+    }
+}
 
-    for (int k = 0; k < matGrid.depth; k++) {
-        for (int j = 0; j < matGrid.height; j++) {
-            for (int i = 0; i < matGrid.width; i++) {
-                if (matGrid.isCellFluid(i, j, k)) {
-                    layerGrid.set(i, j, k, 0);
-                }
-            }
+void MACVelocityField::_findNextExtrapolationLayerThread(int startidx, int endidx,
+                                                         int layerIdx,
+                                                         FluidMaterialGrid *matGrid,
+                                                         int threadidx) {
+    std::vector<GridIndex> *layer = &(_extrapolation.layers[layerIdx]);
+    std::vector<GridIndex> *cells = &(_extrapolation.threadCells[threadidx]);
+    cells->clear();
+    for (int i = startidx; i < endidx; i++) {
+        _addExtrapolationLayerCandidates(layer->at(i), matGrid, cells);
+    }
+}
+
+void MACVelocityField::_addExtrapolationLayerCandidates(GridIndex g,
+                                                        FluidMaterialGrid *matGrid,
+                                                        std::vector<GridIndex> *cells) {
+    GridIndex neighbours[6];
+    Grid3d::getNeighbourGridIndices6(g, neighbours);
+
+    GridIndex n;
+    for (int idx = 0; idx < 6; idx++) {
+        n = neighbours[idx];
+        if (Grid3d::isGridIndexInRange(n, _isize, _jsize, _ksize) &&
+                _extrapolation.layerGrid(n) == -1 &&
+                !matGrid->isCellFluid(n) && !matGrid->isCellSolid(n)) {
+            cells->push_back(n);
         }
     }
+}
 
-    for (int layer = 1; layer <= _numExtrapolationLayers; layer++) {
-        _updateExtrapolationLayer(layer, matGrid, layerGrid);
+void MACVelocityField::_mergeExtrapolationLayerCandidates(int layerIdx, int numthreads) {
+    // Neighbouring cells may be found by more than one thread
+    std::vector<GridIndex> *layer = &(_extrapolation.layers[layerIdx]);
+    for (int tidx = 0; tidx < numthreads; tidx++) {
+        std::vector<GridIndex> *cells = &(_extrapolation.threadCells[tidx]);
+        for (unsigned int i = 0; i < cells->size(); i++) {
+            GridIndex g = cells->at(i);
+            if (_extrapolation.layerGrid(g) == -1) {
+                _extrapolation.layerGrid.set(g, layerIdx);
+                layer->push_back(g);
+                _allocateFaceTiles(g);
+            }
+        }
     }
 }
 
+/*
+    Face tiles are allocated here, while only one thread is running, so that 
+    the faces of the cell can later be extrapolated in parallel.
+*/
+void MACVelocityField::_allocateFaceTiles(GridIndex g) {
+    _u.allocateTile(g.i, g.j, g.k);
+    _u.allocateTile(g.i + 1, g.j, g.k);
+    _v.allocateTile(g.i, g.j, g.k);
+    _v.allocateTile(g.i, g.j + 1, g.k);
+    _w.allocateTile(g.i, g.j, g.k);
+    _w.allocateTile(g.i, g.j, g.k + 1);
+}
+
 double MACVelocityField::_getExtrapolatedVelocityForFaceU(int i, int j, int k, int layerIdx,
-                                                          Array3d<int> &layerGrid) {
+                                                          FluidMaterialGrid *matGrid) {
     GridIndex n[6];
     Grid3d::getNeighbourGridIndices6(i, j, k, n);
 
@@ -691,7 +748,7 @@ double MACVelocityField::_getExtrapolatedVelocityForFaceU(int i, int j, int k, i
 
     for (int idx = 0; idx < 6; idx++) {
         c = n[idx];
-        if (isIndexInRangeU(c) && _isFaceBorderingLayerIndexU(c, layerIdx - 1, layerGrid)) {
+        if (isIndexInRangeU(c) && _isFaceBorderingLayerIndexU(c, layerIdx - 1, matGrid)) {
                 sum += U(c);
                 weightsum++;
         }
@@ -705,7 +762,7 @@ double MACVelocityField::_getExtrapolatedVelocityForFaceU(int i, int j, int k, i
 }
 
 double MACVelocityField::_getExtrapolatedVelocityForFaceV(int i, int j, int k, int layerIdx,
-                                                          Array3d<int> &layerGrid) {
+                                                          FluidMaterialGrid *matGrid) {
     GridIndex n[6];
     Grid3d::getNeighbourGridIndices6(i, j, k, n);
 
@@ -715,7 +772,7 @@ double MACVelocityField::_getExtrapolatedVelocityForFaceV(int i, int j, int k, i
 
     for (int idx = 0; idx < 6; idx++) {
         c = n[idx];
-        if (isIndexInRangeV(c) && _isFaceBorderingLayerIndexV(c, layerIdx - 1, layerGrid)) {
+        if (isIndexInRangeV(c) && _isFaceBorderingLayerIndexV(c, layerIdx - 1, matGrid)) {
             sum += V(c);
             weightsum++;
         }
@@ -729,7 +786,7 @@ double MACVelocityField::_getExtrapolatedVelocityForFaceV(int i, int j, int k, i
 }
 
 double MACVelocityField::_getExtrapolatedVelocityForFaceW(int i, int j, int k, int layerIdx,
-                                                          Array3d<int> &layerGrid) {
+                                                          FluidMaterialGrid *matGrid) {
     GridIndex n[6];
     Grid3d::getNeighbourGridIndices6(i, j, k, n);
 
@@ -739,7 +796,7 @@ double MACVelocityField::_getExtrapolatedVelocityForFaceW(int i, int j, int k, i
 
     for (int idx = 0; idx < 6; idx++) {
         c = n[idx];
-        if (isIndexInRangeW(c) && _isFaceBorderingLayerIndexW(c, layerIdx - 1, layerGrid)) {
+        if (isIndexInRangeW(c) && _isFaceBorderingLayerIndexW(c, layerIdx - 1, matGrid)) {
             sum += W(c);
             weightsum++;
         }
@@ -752,110 +809,138 @@ double MACVelocityField::_getExtrapolatedVelocityForFaceW(int i, int j, int k, i
     return sum / weightsum;
 }
 
-void MACVelocityField::_extrapolateVelocitiesForLayerIndexU(int idx, 
-                                                            FluidMaterialGrid &matGrid,
-                                                            Array3d<int> &layerGrid) {
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize + 1; i++) {
-                bool isExtrapolated = _isFaceBorderingLayerIndexU(i, j, k, idx, layerGrid) && 
-                                     !_isFaceBorderingLayerIndexU(i, j, k, idx-1, layerGrid) &&
-                                    (!matGrid.isFaceBorderingSolidU(i, j, k));
-                if (isExtrapolated) {
-                    double v = _getExtrapolatedVelocityForFaceU(i, j, k, idx, layerGrid);
-                    setU(i, j, k, (float)v);
-                }
-            }
+void MACVelocityField::_extrapolateVelocitiesForLayerIndexThread(int startidx, int endidx,
+                                                                 int layerIdx,
+                                                                 FluidMaterialGrid *matGrid) {
+    /* 
+        Each face of a layer cell is extrapolated by exactly one thread: a cell
+        owns its low faces, and owns its high faces only when the cell across 
+        the face is not in the same layer. Extrapolated faces only read faces 
+        bordering the previous layer, so no face is read and written within 
+        the same layer.
+    */
+    std::vector<GridIndex> *layer = &(_extrapolation.layers[layerIdx]);
+    for (int idx = startidx; idx < endidx; idx++) {
+        GridIndex g = layer->at(idx);
+        int i = g.i; int j = g.j; int k = g.k;
+
+        bool isHighU = i + 1 == _isize || _getExtrapolationLayer(i + 1, j, k, matGrid) != layerIdx;
+        bool isHighV = j + 1 == _jsize || _getExtrapolationLayer(i, j + 1, k, matGrid) != layerIdx;
+        bool isHighW = k + 1 == _ksize || _getExtrapolationLayer(i, j, k + 1, matGrid) != layerIdx;
+
+        _extrapolateVelocityForFaceU(i, j, k, layerIdx, matGrid);
+        _extrapolateVelocityForFaceV(i, j, k, layerIdx, matGrid);
+        _extrapolateVelocityForFaceW(i, j, k, layerIdx, matGrid);
+        if (isHighU) {
+            _extrapolateVelocityForFaceU(i + 1, j, k, layerIdx, matGrid);
+        }
+        if (isHighV) {
+            _extrapolateVelocityForFaceV(i, j + 1, k, layerIdx, matGrid);
+        }
+        if (isHighW) {
+            _extrapolateVelocityForFaceW(i, j, k + 1, layerIdx, matGrid);
         }
     }
 }
 
-void MACVelocityField::_extrapolateVelocitiesForLayerIndexV(int idx, 
-                                                            FluidMaterialGrid &matGrid,
-                                                            Array3d<int> &layerGrid) {
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize + 1; j++) {
-            for (int i = 0; i < _isize; i++) {
-                bool isExtrapolated = _isFaceBorderingLayerIndexV(i, j, k, idx, layerGrid) && 
-                                     !_isFaceBorderingLayerIndexV(i, j, k, idx-1, layerGrid) &&
-                                    (!matGrid.isFaceBorderingSolidV(i, j, k));
-                if (isExtrapolated) {
-                    double v = _getExtrapolatedVelocityForFaceV(i, j, k, idx, layerGrid);
-                    setV(i, j, k, (float)v);
-                }
-            }
-        }
+void MACVelocityField::_extrapolateVelocityForFaceU(int i, int j, int k, int layerIdx,
+                                                    FluidMaterialGrid *matGrid) {
+    if (_isFaceBorderingLayerIndexU(i, j, k, layerIdx - 1, matGrid)) {
+        return;
+    }
+    if (matGrid->isFaceBorderingSolidU(i, j, k)) {
+        _u.set(i, j, k, 0.0f);
+        return;
     }
+
+    double v = _getExtrapolatedVelocityForFaceU(i, j, k, layerIdx, matGrid);
+    _u.set(i, j, k, (float)v);
 }
 
-void MACVelocityField::_extrapolateVelocitiesForLayerIndexW(int idx, 
-                                                            FluidMaterialGrid &matGrid,
-                                                            Array3d<int> &layerGrid) {
-    for (int k = 0; k < _ksize + 1; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize; i++) {
-                bool isExtrapolated = _isFaceBorderingLayerIndexW(i, j, k, idx, layerGrid) && 
-                                     !_isFaceBorderingLayerIndexW(i, j, k, idx-1, layerGrid) &&
-                                    (!matGrid.isFaceBorderingSolidW(i, j, k));
-                if (isExtrapolated) {
-                    double v = _getExtrapolatedVelocityForFaceW(i, j, k, idx, layerGrid);
-                    setW(i, j, k, (float)v);
-                }
-            }
-        }
+void MACVelocityField::_extrapolateVelocityForFaceV(int i, int j, int k, int layerIdx,
+                                                    FluidMaterialGrid *matGrid) {
+    if (_isFaceBorderingLayerIndexV(i, j, k, layerIdx - 1, matGrid)) {
+        return;
+    }
+    if (matGrid->isFaceBorderingSolidV(i, j, k)) {
+        _v.set(i, j, k, 0.0f);
+        return;
     }
-}
 
-void MACVelocityField::_extrapolateVelocitiesForLayerIndex(int idx, 
-                                                           FluidMaterialGrid &matGrid,
-                                                           Array3d<int> &layerGrid) {
-    _extrapolateVelocitiesForLayerIndexU(idx, matGrid, layerGrid);
-    _extrapolateVelocitiesForLayerIndexV(idx, matGrid, layerGrid);
-    _extrapolateVelocitiesForLayerIndexW(idx, matGrid, layerGrid);
+    double v = _getExtrapolatedVelocityForFaceV(i, j, k, layerIdx, matGrid);
+    _v.set(i, j, k, (float)v);
 }
 
-void MACVelocityField::_resetExtrapolatedFluidVelocities(FluidMaterialGrid &matGrid) {
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize + 1; i++) {
-                if (!matGrid.isFaceBorderingFluidU(i, j, k)) {
-                    setU(i, j, k, 0.0);
-                }
-            }
-        }
+void MACVelocityField::_extrapolateVelocityForFaceW(int i, int j, int k, int layerIdx,
+                                                    FluidMaterialGrid *matGrid) {
+    if (_isFaceBorderingLayerIndexW(i, j, k, layerIdx - 1, matGrid)) {
+        return;
     }
-
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize + 1; j++) {
-            for (int i = 0; i < _isize; i++) {
-                if (!matGrid.isFaceBorderingFluidV(i, j, k)) {
-                    setV(i, j, k, 0.0);
-                }
-            }
-        }
+    if (matGrid->isFaceBorderingSolidW(i, j, k)) {
+        _w.set(i, j, k, 0.0f);
+        return;
     }
 
-    for (int k = 0; k < _ksize + 1; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize; i++) {
-                if (!matGrid.isFaceBorderingFluidW(i, j, k)) {
-                    setW(i, j, k, 0.0);
-                }
-            }
-        }
-    }
+    double v = _getExtrapolatedVelocityForFaceW(i, j, k, layerIdx, matGrid);
+    _w.set(i, j, k, (float)v);
 }
 
 void MACVelocityField::extrapolateVelocityField(FluidMaterialGrid &materialGrid, 
+                                                GridIndexVector &fluidCells,
                                                 int numLayers) {
     _numExtrapolationLayers = numLayers;
+    _initializeExtrapolationBuffers(&materialGrid);
 
-    Array3d<int> layerGrid = Array3d<int>(_isize, _jsize, _ksize, -1);
+    int numCells = fluidCells.size();
+    int numthreads = (int)fmin(ThreadUtils::getMaxThreadCount(), 
+                               ceil((double)numCells / (double)_minExtrapolationCellsPerThread));
+    numthreads = (int)fmax(numthreads, 1);
+    std::vector<int> intervals = ThreadUtils::splitRangeIntoIntervals(0, numCells, 
+                                                                      numthreads);
+    std::vector<std::thread> threads(numthreads);
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&MACVelocityField::_findFirstExtrapolationLayerThread, this,
+                                 intervals[i], intervals[i + 1], &fluidCells, 
+                                 &materialGrid, i);
+    }
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
 
-    _resetExtrapolatedFluidVelocities(materialGrid);
-    _updateExtrapolationLayers(materialGrid, layerGrid);
+    if (numLayers < 1) {
+        return;
+    }
+    _mergeExtrapolationLayerCandidates(1, numthreads);
+
+    for (int layerIdx = 1; layerIdx <= numLayers; layerIdx++) {
+        int layerSize = _extrapolation.layers[layerIdx].size();
+        if (layerSize == 0) {
+            break;
+        }
 
-    for (int i = 1; i <= numLayers; i++) {
-        _extrapolateVelocitiesForLayerIndex(i, materialGrid, layerGrid);
+        numthreads = (int)fmin(ThreadUtils::getMaxThreadCount(), 
+                               ceil((double)layerSize / (double)_minExtrapolationCellsPerThread));
+        intervals = ThreadUtils::splitRangeIntoIntervals(0, layerSize, numthreads);
+        threads = std::vector<std::thread>(numthreads);
+
+        if (layerIdx < numLayers) {
+            for (int i = 0; i < numthreads; i++) {
+                threads[i] = std::thread(&MACVelocityField::_findNextExtrapolationLayerThread, this,
+                                         intervals[i], intervals[i + 1], layerIdx, 
+                                         &materialGrid, i);
+            }
+            for (int i = 0; i < numthreads; i++) {
+                threads[i].join();
+            }
+            _mergeExtrapolationLayerCandidates(layerIdx + 1, numthreads);
+        }
+
+        for (int i = 0; i < numthreads; i++) {
+            threads[i] = std::thread(&MACVelocityField::_extrapolateVelocitiesForLayerIndexThread, this,
+                                     intervals[i], intervals[i + 1], layerIdx, &materialGrid);
+        }
+        for (int i = 0; i < numthreads; i++) {
+            threads[i].join();
+        }
     }
-}
\ No newline at end of file
+}
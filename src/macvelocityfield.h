@@ -26,11 +26,15 @@ freely, subject to the following restrictions:
 #include <limits>
 #include <time.h>
 #include <assert.h>
+#include <vector>
+#include <thread>
 
 #include "fluidmaterialgrid.h"
 #include "array3d.h"
+#include "sparsearray3d.h"
 #include "grid3d.h"
 #include "interpolation.h"
+#include "threadutils.h"
 #include "vmath.h" 
 
 class MACVelocityField
@@ -38,6 +42,10 @@ class MACVelocityField
 public:
     MACVelocityField();
     MACVelocityField(int isize, int jsize, int ksize, double dx);
+    MACVelocityField(const MACVelocityField &obj) = default;
+    MACVelocityField(MACVelocityField &&obj) = default;
+    MACVelocityField& operator=(const MACVelocityField &rhs) = default;
+    MACVelocityField& operator=(MACVelocityField &&rhs) = default;
     ~MACVelocityField();
 
     void getGridDimensions(int *i, int *j, int *k);
@@ -56,20 +64,16 @@ public:
     void setU(GridIndex g, double val);
     void setV(GridIndex g, double val);
     void setW(GridIndex g, double val);
-    void setU(Array3d<float> &ugrid);
-    void setV(Array3d<float> &vgrid);
-    void setW(Array3d<float> &wgrid);
+    void setU(SparseArray3d<float> &ugrid);
+    void setV(SparseArray3d<float> &vgrid);
+    void setW(SparseArray3d<float> &wgrid);
     void addU(int i, int j, int k, double val);
     void addV(int i, int j, int k, double val);
     void addW(int i, int j, int k, double val);
 
-    Array3d<float>* getArray3dU();
-    Array3d<float>* getArray3dV();
-    Array3d<float>* getArray3dW();
-
-    float* getRawArrayU();
-    float* getRawArrayV();
-    float* getRawArrayW();
+    SparseArray3d<float>* getArray3dU();
+    SparseArray3d<float>* getArray3dV();
+    SparseArray3d<float>* getArray3dW();
 
     void clear();
     void clearU();
@@ -113,7 +117,15 @@ public:
     vmath::vec3 velocityIndexToPositionV(int i, int j, int k);
     vmath::vec3 velocityIndexToPositionW(int i, int j, int k);
 
-    void extrapolateVelocityField(FluidMaterialGrid &materialGrid, int numLayers);
+    /*
+        Extrapolates the velocities of the faces bordering fluidCells out to
+        numLayers layers of air cells. The work done is proportional to the 
+        number of fluid cells and the size of the extrapolation band. Faces 
+        outside of the band are assumed to be zero, apart from those of the
+        band of the previous call which are zeroed here.
+    */
+    void extrapolateVelocityField(FluidMaterialGrid &materialGrid, 
+                                  GridIndexVector &fluidCells, int numLayers);
 
 private:
     void _initializeVelocityGrids();
@@ -131,104 +143,113 @@ private:
     double _interpolateLinearV(double x, double y, double z);
     double _interpolateLinearW(double x, double y, double z);
 
-    void _resetExtrapolatedFluidVelocities(FluidMaterialGrid &matGrid);
-    void _updateExtrapolationLayers(FluidMaterialGrid &matGrid, 
-                                    Array3d<int> &layerGrid);
-    void _updateExtrapolationLayer(int layerIndex, 
-                                   FluidMaterialGrid &matGrid,
-                                   Array3d<int> &layerGrid);
-    void _extrapolateVelocitiesForLayerIndex(int idx, 
-                                             FluidMaterialGrid &matGrid,
-                                             Array3d<int> &layerGrid);
-    void _extrapolateVelocitiesForLayerIndexU(int idx, 
-                                              FluidMaterialGrid &matGrid,
-                                              Array3d<int> &layerGrid);
-    void _extrapolateVelocitiesForLayerIndexV(int idx, 
-                                              FluidMaterialGrid &matGrid,
-                                              Array3d<int> &layerGrid);
-    void _extrapolateVelocitiesForLayerIndexW(int idx, 
-                                              FluidMaterialGrid &matGrid,
-                                              Array3d<int> &layerGrid);
+    void _initializeExtrapolationBuffers(FluidMaterialGrid *matGrid);
+    void _resetPreviousExtrapolationBand(FluidMaterialGrid *matGrid);
+    void _findFirstExtrapolationLayerThread(int startidx, int endidx,
+                                            GridIndexVector *fluidCells,
+                                            FluidMaterialGrid *matGrid,
+                                            int threadidx);
+    void _findNextExtrapolationLayerThread(int startidx, int endidx,
+                                           int layerIdx,
+                                           FluidMaterialGrid *matGrid,
+                                           int threadidx);
+    void _addExtrapolationLayerCandidates(GridIndex g,
+                                          FluidMaterialGrid *matGrid,
+                                          std::vector<GridIndex> *cells);
+    void _mergeExtrapolationLayerCandidates(int layerIdx, int numthreads);
+    void _allocateFaceTiles(GridIndex g);
+    void _extrapolateVelocitiesForLayerIndexThread(int startidx, int endidx,
+                                                   int layerIdx,
+                                                   FluidMaterialGrid *matGrid);
+    void _extrapolateVelocityForFaceU(int i, int j, int k, int layerIdx,
+                                      FluidMaterialGrid *matGrid);
+    void _extrapolateVelocityForFaceV(int i, int j, int k, int layerIdx,
+                                      FluidMaterialGrid *matGrid);
+    void _extrapolateVelocityForFaceW(int i, int j, int k, int layerIdx,
+                                      FluidMaterialGrid *matGrid);
     double _getExtrapolatedVelocityForFaceU(int i, int j, int k, int layerIdx,
-                                            Array3d<int> &layerGrid);
+                                            FluidMaterialGrid *matGrid);
     double _getExtrapolatedVelocityForFaceV(int i, int j, int k, int layerIdx,
-                                            Array3d<int> &layerGrid);
+                                            FluidMaterialGrid *matGrid);
     double _getExtrapolatedVelocityForFaceW(int i, int j, int k, int layerIdx,
-                                            Array3d<int> &layerGrid);
-
-    inline bool _isFaceBorderingGridValueU(int i, int j, int k, int value, Array3d<int> &grid) {
-        if (i == grid.width) { return grid(i - 1, j, k) == value; }
-        else if (i > 0) { return grid(i, j, k) == value || grid(i - 1, j, k) == value; }
-        else { return grid(i, j, k) == value; }
-    }
-    inline bool _isFaceBorderingGridValueV(int i, int j, int k, int value, Array3d<int> &grid) {
-        if (j == grid.height) { return grid(i, j - 1, k) == value; }
-        else if (j > 0) { return grid(i, j, k) == value || grid(i, j - 1, k) == value; }
-        else { return grid(i, j, k) == value; }
-    }
-    inline bool _isFaceBorderingGridValueW(int i, int j, int k, int value, Array3d<int> &grid) {
-        if (k == grid.depth) { return grid(i, j, k - 1) == value; }
-        else if (k > 0) { return grid(i, j, k) == value || grid(i, j, k - 1) == value; }
-        else { return grid(i, j, k) == value; }
-    }
-
-    inline bool _isFaceBorderingGridValueU(GridIndex g, int value, Array3d<int> &grid) {
-        return _isFaceBorderingGridValueU(g.i, g.j, g.k, value, grid);
-    }
-    inline bool _isFaceBorderingGridValueV(GridIndex g, int value, Array3d<int> &grid) {
-        return _isFaceBorderingGridValueV(g.i, g.j, g.k, value, grid);
-    }
-    inline bool _isFaceBorderingGridValueW(GridIndex g, int value, Array3d<int> &grid) {
-        return _isFaceBorderingGridValueW(g.i, g.j, g.k, value, grid);
-    }
-
-    inline bool _isFaceBorderingLayerIndexU(int i, int j, int k, int layer, Array3d<int> &layerGrid) {
-        return _isFaceBorderingGridValueU(i, j, k, layer, layerGrid);
-    }
-    inline bool _isFaceBorderingLayerIndexV(int i, int j, int k, int layer, Array3d<int> &layerGrid) {
-        return _isFaceBorderingGridValueV(i, j, k, layer, layerGrid);
-    }
-    inline bool _isFaceBorderingLayerIndexW(int i, int j, int k, int layer, Array3d<int> &layerGrid) {
-        return _isFaceBorderingGridValueW(i, j, k, layer, layerGrid);
-    }
-    inline bool _isFaceBorderingLayerIndexU(GridIndex g, int layer, Array3d<int> &layerGrid) {
-        return _isFaceBorderingGridValueU(g, layer, layerGrid);
-    }
-    inline bool _isFaceBorderingLayerIndexV(GridIndex g, int layer, Array3d<int> &layerGrid) {
-        return _isFaceBorderingGridValueV(g, layer, layerGrid);
-    }
-    inline bool _isFaceBorderingLayerIndexW(GridIndex g, int layer, Array3d<int> &layerGrid) {
-        return _isFaceBorderingGridValueW(g, layer, layerGrid);
-    }
-
-    inline bool _isFaceVelocityExtrapolatedU(int i, int j, int k, Array3d<int> &layerGrid) {
-        if (i == _isize) {  return layerGrid(i - 1, j, k) >= 1.0; }
-        else if (i > 0) { return layerGrid(i, j, k) >= 1.0 || layerGrid(i - 1, j, k) >= 1.0; }
-        else { return layerGrid(i, j, k) >= 1.0; }
-    }
-
-    inline bool _isFaceVelocityExtrapolatedV(int i, int j, int k, Array3d<int> &layerGrid) {
-        if (j == _jsize) { return layerGrid(i, j - 1, k) >= 1.0; }
-        else if (j > 0) { return layerGrid(i, j, k) >= 1.0 || layerGrid(i, j - 1, k) >= 1.0; }
-        else { return layerGrid(i, j, k) >= 1.0; }
-    }
-
-    inline bool _isFaceVelocityExtrapolatedW(int i, int j, int k, Array3d<int> &layerGrid) {
-        if (k == _ksize) { return layerGrid(i, j, k - 1) >= 1.0; }
-        else if (k > 0) { return layerGrid(i, j, k) >= 1.0 || layerGrid(i, j, k - 1) >= 1.0; }
-        else { return layerGrid(i, j, k) >= 1.0; }
-    }
+                                            FluidMaterialGrid *matGrid);
+
+    /*
+        Fluid cells are layer 0 and are read from the material grid. Only the
+        cells of the extrapolation band are labeled in the layer grid.
+    */
+    inline int _getExtrapolationLayer(int i, int j, int k, FluidMaterialGrid *matGrid) {
+        if (matGrid->isCellFluid(i, j, k)) {
+            return 0;
+        }
+        return _extrapolation.layerGrid(i, j, k);
+    }
+
+    inline bool _isFaceBorderingLayerIndexU(int i, int j, int k, int layer, 
+                                            FluidMaterialGrid *matGrid) {
+        if (i == _isize) { return _getExtrapolationLayer(i - 1, j, k, matGrid) == layer; }
+        else if (i > 0) { return _getExtrapolationLayer(i, j, k, matGrid) == layer || 
+                                 _getExtrapolationLayer(i - 1, j, k, matGrid) == layer; }
+        else { return _getExtrapolationLayer(i, j, k, matGrid) == layer; }
+    }
+    inline bool _isFaceBorderingLayerIndexV(int i, int j, int k, int layer, 
+                                            FluidMaterialGrid *matGrid) {
+        if (j == _jsize) { return _getExtrapolationLayer(i, j - 1, k, matGrid) == layer; }
+        else if (j > 0) { return _getExtrapolationLayer(i, j, k, matGrid) == layer || 
+                                 _getExtrapolationLayer(i, j - 1, k, matGrid) == layer; }
+        else { return _getExtrapolationLayer(i, j, k, matGrid) == layer; }
+    }
+    inline bool _isFaceBorderingLayerIndexW(int i, int j, int k, int layer, 
+                                            FluidMaterialGrid *matGrid) {
+        if (k == _ksize) { return _getExtrapolationLayer(i, j, k - 1, matGrid) == layer; }
+        else if (k > 0) { return _getExtrapolationLayer(i, j, k, matGrid) == layer || 
+                                 _getExtrapolationLayer(i, j, k - 1, matGrid) == layer; }
+        else { return _getExtrapolationLayer(i, j, k, matGrid) == layer; }
+    }
+    inline bool _isFaceBorderingLayerIndexU(GridIndex g, int layer, FluidMaterialGrid *matGrid) {
+        return _isFaceBorderingLayerIndexU(g.i, g.j, g.k, layer, matGrid);
+    }
+    inline bool _isFaceBorderingLayerIndexV(GridIndex g, int layer, FluidMaterialGrid *matGrid) {
+        return _isFaceBorderingLayerIndexV(g.i, g.j, g.k, layer, matGrid);
+    }
+    inline bool _isFaceBorderingLayerIndexW(GridIndex g, int layer, FluidMaterialGrid *matGrid) {
+        return _isFaceBorderingLayerIndexW(g.i, g.j, g.k, layer, matGrid);
+    }
+
+    /*
+        Scratch space for extrapolateVelocityField that is kept between calls.
+        The buffers belong to a single field and are never copied, so assigning
+        one velocity field to another does not duplicate or discard them.
+    */
+    struct ExtrapolationBuffers {
+        SparseArray3d<int> layerGrid;
+        std::vector<std::vector<GridIndex> > layers;
+        std::vector<std::vector<GridIndex> > threadCells;
+
+        ExtrapolationBuffers() {}
+        ExtrapolationBuffers(const ExtrapolationBuffers &) {}
+        ExtrapolationBuffers& operator=(const ExtrapolationBuffers &) { 
+            return *this; 
+        }
+    };
 
     int _isize = 10;
     int _jsize = 10;
     int _ksize = 10;
     double _dx = 0.1;
 
-    Array3d<float> _u;
-    Array3d<float> _v;
-    Array3d<float> _w;
+    /*
+        Only the tiles of faces holding nonzero velocities are allocated, so 
+        the memory used by the field follows the fluid and its extrapolation 
+        band rather than the size of the domain.
+    */
+    SparseArray3d<float> _u;
+    SparseArray3d<float> _v;
+    SparseArray3d<float> _w;
 
     int _numExtrapolationLayers = 0;
+    int _minExtrapolationCellsPerThread = 1000;
+    ExtrapolationBuffers _extrapolation;
 };
 
 #endif
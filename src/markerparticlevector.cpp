@@ -0,0 +1,47 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "markerparticlevector.h"
+
+MarkerParticleVector::MarkerParticleVector() {
+}
+
+MarkerParticleVector::~MarkerParticleVector() {
+}
+
+void MarkerParticleVector::reserve(unsigned int n) {
+    x.reserve(n); y.reserve(n); z.reserve(n);
+    u.reserve(n); v.reserve(n); w.reserve(n);
+}
+
+void MarkerParticleVector::shrink_to_fit() {
+    x.shrink_to_fit(); y.shrink_to_fit(); z.shrink_to_fit();
+    u.shrink_to_fit(); v.shrink_to_fit(); w.shrink_to_fit();
+}
+
+void MarkerParticleVector::clear() {
+    x.clear(); y.clear(); z.clear();
+    u.clear(); v.clear(); w.clear();
+}
+
+void MarkerParticleVector::swap(int i, int j) {
+    assert(i >= 0 && i < (int)x.size() && j >= 0 && j < (int)x.size());
+    std::swap(x[i], x[j]); std::swap(y[i], y[j]); std::swap(z[i], z[j]);
+    std::swap(u[i], u[j]); std::swap(v[i], v[j]); std::swap(w[i], w[j]);
+}
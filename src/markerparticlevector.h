@@ -0,0 +1,132 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef MARKERPARTICLEVECTOR_H
+#define MARKERPARTICLEVECTOR_H
+
+#include <vector>
+#include <assert.h>
+#include <algorithm>
+
+#include "markerparticle.h"
+#include "vmath.h"
+
+/*
+    Structure-of-arrays storage for MarkerParticles. Positions and 
+    velocities are stored as separate contiguous component arrays so that 
+    the particle advector, scalar field splatter and per-particle update
+    loops can read and write particle data directly without packing 
+    temporary std::vector<vmath::vec3> buffers.
+
+    The component arrays are public and must always have equal size. Use
+    the push_back/removeItems methods to change the number of particles.
+*/
+class MarkerParticleVector
+{
+public:
+    MarkerParticleVector();
+    ~MarkerParticleVector();
+
+    inline unsigned int size() {
+        return x.size();
+    }
+
+    inline bool empty() {
+        return x.empty();
+    }
+
+    void reserve(unsigned int n);
+    void shrink_to_fit();
+    void clear();
+
+    inline void push_back(vmath::vec3 p, vmath::vec3 vel) {
+        x.push_back(p.x); y.push_back(p.y); z.push_back(p.z);
+        u.push_back(vel.x); v.push_back(vel.y); w.push_back(vel.z);
+    }
+
+    inline void push_back(vmath::vec3 p) {
+        push_back(p, vmath::vec3());
+    }
+
+    inline void push_back(MarkerParticle mp) {
+        push_back(mp.position, mp.velocity);
+    }
+
+    inline MarkerParticle get(int i) {
+        assert(i >= 0 && i < (int)x.size());
+        return MarkerParticle(getPosition(i), getVelocity(i));
+    }
+
+    inline vmath::vec3 getPosition(int i) {
+        assert(i >= 0 && i < (int)x.size());
+        return vmath::vec3(x[i], y[i], z[i]);
+    }
+
+    inline vmath::vec3 getVelocity(int i) {
+        assert(i >= 0 && i < (int)u.size());
+        return vmath::vec3(u[i], v[i], w[i]);
+    }
+
+    inline void setPosition(int i, vmath::vec3 p) {
+        assert(i >= 0 && i < (int)x.size());
+        x[i] = p.x; y[i] = p.y; z[i] = p.z;
+    }
+
+    inline void setVelocity(int i, vmath::vec3 vel) {
+        assert(i >= 0 && i < (int)u.size());
+        u[i] = vel.x; v[i] = vel.y; w[i] = vel.z;
+    }
+
+    void swap(int i, int j);
+
+    /*
+        Compacts the arrays in place, keeping the relative order of the 
+        remaining particles. Capacity is retained so that repeated removals
+        do not reallocate. isRemoved may be std::vector<bool> or, for flags
+        written concurrently, std::vector<char>.
+    */
+    template<class T>
+    void removeItems(std::vector<T> &isRemoved) {
+        assert(isRemoved.size() == x.size());
+
+        int currentidx = 0;
+        for (unsigned int i = 0; i < isRemoved.size(); i++) {
+            if (isRemoved[i]) {
+                continue;
+            }
+
+            x[currentidx] = x[i]; y[currentidx] = y[i]; z[currentidx] = z[i];
+            u[currentidx] = u[i]; v[currentidx] = v[i]; w[currentidx] = w[i];
+            currentidx++;
+        }
+
+        x.resize(currentidx); y.resize(currentidx); z.resize(currentidx);
+        u.resize(currentidx); v.resize(currentidx); w.resize(currentidx);
+    }
+
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<float> u;
+    std::vector<float> v;
+    std::vector<float> w;
+
+};
+
+#endif
@@ -0,0 +1,396 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "multigridpreconditioner.h"
+
+MultigridPreconditioner::MultigridPreconditioner() {
+}
+
+MultigridPreconditioner::~MultigridPreconditioner() {
+}
+
+void MultigridPreconditioner::initialize(FluidMaterialGrid *materialGrid, 
+                                         GridIndexVector *fluidCells, 
+                                         double scale) {
+    assert(scale > 0.0);
+    _scale = scale;
+    _invscale = 1.0 / scale;
+
+    _levels.clear();
+    _initializeFinestLevel(materialGrid);
+
+    MultigridLevel *fine = &(_levels[0]);
+    _fineCellIndices = std::vector<int>(fluidCells->size());
+    GridIndex g;
+    for (unsigned int idx = 0; idx < fluidCells->size(); idx++) {
+        g = fluidCells->at(idx);
+        _fineCellIndices[idx] = fine->flatIndex(g.i, g.j, g.k);
+    }
+
+    while ((int)_levels.size() < _maxLevels) {
+        fine = &(_levels.back());
+        int ci = (fine->isize + 1) / 2;
+        int cj = (fine->jsize + 1) / 2;
+        int ck = (fine->ksize + 1) / 2;
+        if (std::min(std::min(ci, cj), ck) < _minCoarseLevelWidth) {
+            break;
+        }
+
+        MultigridLevel coarse;
+        coarse.isize = ci;
+        coarse.jsize = cj;
+        coarse.ksize = ck;
+        _initializeCoarseLevel(*fine, coarse);
+        if (coarse.redCells.size() + coarse.blackCells.size() == 0) {
+            break;
+        }
+
+        _levels.push_back(coarse);
+    }
+}
+
+void MultigridPreconditioner::apply(std::vector<double> &residual, 
+                                    std::vector<double> &z) {
+    _apply(residual, z);
+}
+
+void MultigridPreconditioner::apply(std::vector<float> &residual, 
+                                    std::vector<float> &z) {
+    _apply(residual, z);
+}
+
+int MultigridPreconditioner::getNumLevels() {
+    return (int)_levels.size();
+}
+
+void MultigridPreconditioner::setNumSmoothingIterations(int n) {
+    assert(n >= 1);
+    _numSmoothingIterations = n;
+}
+
+void MultigridPreconditioner::setNumCoarseSolveIterations(int n) {
+    assert(n >= 1);
+    _numCoarseSolveIterations = n;
+}
+
+template <class T>
+void MultigridPreconditioner::_apply(std::vector<T> &residual, std::vector<T> &z) {
+    assert(residual.size() == _fineCellIndices.size() && 
+           z.size() == _fineCellIndices.size());
+
+    MultigridLevel *fine = &(_levels[0]);
+    for (unsigned int idx = 0; idx < _fineCellIndices.size(); idx++) {
+        fine->b[_fineCellIndices[idx]] = (double)residual[idx] * _invscale;
+    }
+
+    _vCycle(0);
+
+    for (unsigned int idx = 0; idx < _fineCellIndices.size(); idx++) {
+        z[idx] = (T)fine->x[_fineCellIndices[idx]];
+    }
+}
+
+void MultigridPreconditioner::_initializeFinestLevel(FluidMaterialGrid *materialGrid) {
+    MultigridLevel level;
+    level.isize = materialGrid->width;
+    level.jsize = materialGrid->height;
+    level.ksize = materialGrid->depth;
+    level.cellTypes = std::vector<CellType>(level.isize*level.jsize*level.ksize, 
+                                            CellType::solid);
+
+    for (int k = 0; k < level.ksize; k++) {
+        for (int j = 0; j < level.jsize; j++) {
+            for (int i = 0; i < level.isize; i++) {
+                CellType type = CellType::solid;
+                if (materialGrid->isCellFluid(i, j, k)) {
+                    type = CellType::fluid;
+                } else if (materialGrid->isCellAir(i, j, k)) {
+                    type = CellType::air;
+                }
+                level.cellTypes[level.flatIndex(i, j, k)] = type;
+            }
+        }
+    }
+
+    _initializeLevelCells(level);
+    _levels.push_back(level);
+}
+
+void MultigridPreconditioner::_initializeCoarseLevel(MultigridLevel &fine, 
+                                                     MultigridLevel &coarse) {
+    coarse.cellTypes = std::vector<CellType>(coarse.isize*coarse.jsize*coarse.ksize, 
+                                             CellType::solid);
+
+    for (int k = 0; k < coarse.ksize; k++) {
+        for (int j = 0; j < coarse.jsize; j++) {
+            for (int i = 0; i < coarse.isize; i++) {
+
+                bool isAir = false;
+                bool isFluid = false;
+                for (int fk = 2*k; fk <= 2*k + 1 && fk < fine.ksize; fk++) {
+                    for (int fj = 2*j; fj <= 2*j + 1 && fj < fine.jsize; fj++) {
+                        for (int fi = 2*i; fi <= 2*i + 1 && fi < fine.isize; fi++) {
+                            CellType t = fine.cellTypes[fine.flatIndex(fi, fj, fk)];
+                            isAir = isAir || t == CellType::air;
+                            isFluid = isFluid || t == CellType::fluid;
+                        }
+                    }
+                }
+
+                CellType type = CellType::solid;
+                if (isAir) {
+                    type = CellType::air;
+                } else if (isFluid) {
+                    type = CellType::fluid;
+                }
+                coarse.cellTypes[coarse.flatIndex(i, j, k)] = type;
+            }
+        }
+    }
+
+    _initializeLevelCells(coarse);
+}
+
+void MultigridPreconditioner::_initializeLevelCells(MultigridLevel &level) {
+    int size = level.isize*level.jsize*level.ksize;
+    level.diag = std::vector<char>(size, 0);
+    level.x = std::vector<double>(size, 0.0);
+    level.b = std::vector<double>(size, 0.0);
+    level.r = std::vector<double>(size, 0.0);
+    level.redCells.clear();
+    level.blackCells.clear();
+
+    for (int k = 0; k < level.ksize; k++) {
+        for (int j = 0; j < level.jsize; j++) {
+            for (int i = 0; i < level.isize; i++) {
+                int flatidx = level.flatIndex(i, j, k);
+                if (level.cellTypes[flatidx] != CellType::fluid) {
+                    continue;
+                }
+
+                int n = 0;
+                if (!_isCellSolid(level, i - 1, j, k)) { n++; }
+                if (!_isCellSolid(level, i + 1, j, k)) { n++; }
+                if (!_isCellSolid(level, i, j - 1, k)) { n++; }
+                if (!_isCellSolid(level, i, j + 1, k)) { n++; }
+                if (!_isCellSolid(level, i, j, k - 1)) { n++; }
+                if (!_isCellSolid(level, i, j, k + 1)) { n++; }
+                level.diag[flatidx] = (char)n;
+
+                if ((i + j + k) % 2 == 0) {
+                    level.redCells.push_back(flatidx);
+                } else {
+                    level.blackCells.push_back(flatidx);
+                }
+            }
+        }
+    }
+}
+
+// Cells outside of the grid are treated as solid
+bool MultigridPreconditioner::_isCellSolid(MultigridLevel &level, int i, int j, int k) {
+    if (!Grid3d::isGridIndexInRange(i, j, k, level.isize, level.jsize, level.ksize)) {
+        return true;
+    }
+    return level.cellTypes[level.flatIndex(i, j, k)] == CellType::solid;
+}
+
+void MultigridPreconditioner::_vCycle(int levelIndex) {
+    MultigridLevel &level = _levels[levelIndex];
+    std::fill(level.x.begin(), level.x.end(), 0.0);
+
+    if (levelIndex == (int)_levels.size() - 1) {
+        for (int n = 0; n < _numCoarseSolveIterations; n++) {
+            _smooth(level, level.redCells);
+            _smooth(level, level.blackCells);
+        }
+        for (int n = 0; n < _numCoarseSolveIterations; n++) {
+            _smooth(level, level.blackCells);
+            _smooth(level, level.redCells);
+        }
+        return;
+    }
+
+    for (int n = 0; n < _numSmoothingIterations; n++) {
+        _smooth(level, level.redCells);
+        _smooth(level, level.blackCells);
+    }
+
+    MultigridLevel &coarse = _levels[levelIndex + 1];
+    _calculateResidual(level);
+    _restrict(level, coarse);
+    _vCycle(levelIndex + 1);
+    _prolongateAndAdd(coarse, level);
+
+    for (int n = 0; n < _numSmoothingIterations; n++) {
+        _smooth(level, level.blackCells);
+        _smooth(level, level.redCells);
+    }
+}
+
+/*
+    One Gauss-Seidel sweep over a single colour. Non-fluid cells always hold
+    a value of zero, so neighbours only need to be checked against the grid
+    bounds.
+*/
+void MultigridPreconditioner::_smooth(MultigridLevel &level, std::vector<int> &cells) {
+    int isize = level.isize;
+    int jsize = level.jsize;
+    int ksize = level.ksize;
+    int slice = isize*jsize;
+    std::vector<double> &x = level.x;
+
+    int flatidx, i, j, k;
+    for (unsigned int idx = 0; idx < cells.size(); idx++) {
+        flatidx = cells[idx];
+        i = flatidx % isize;
+        j = (flatidx / isize) % jsize;
+        k = flatidx / slice;
+
+        double sum = 0.0;
+        if (i > 0)         { sum += x[flatidx - 1]; }
+        if (i < isize - 1) { sum += x[flatidx + 1]; }
+        if (j > 0)         { sum += x[flatidx - isize]; }
+        if (j < jsize - 1) { sum += x[flatidx + isize]; }
+        if (k > 0)         { sum += x[flatidx - slice]; }
+        if (k < ksize - 1) { sum += x[flatidx + slice]; }
+
+        char diag = level.diag[flatidx];
+        if (diag > 0) {
+            x[flatidx] = (level.b[flatidx] + sum) / (double)diag;
+        }
+    }
+}
+
+void MultigridPreconditioner::_calculateResidual(MultigridLevel &level) {
+    int isize = level.isize;
+    int jsize = level.jsize;
+    int ksize = level.ksize;
+    int slice = isize*jsize;
+    std::vector<double> &x = level.x;
+
+    std::vector<int> *colours[2] = {&(level.redCells), &(level.blackCells)};
+    int flatidx, i, j, k;
+    for (int c = 0; c < 2; c++) {
+        std::vector<int> &cells = *(colours[c]);
+        for (unsigned int idx = 0; idx < cells.size(); idx++) {
+            flatidx = cells[idx];
+            i = flatidx % isize;
+            j = (flatidx / isize) % jsize;
+            k = flatidx / slice;
+
+            double sum = 0.0;
+            if (i > 0)         { sum += x[flatidx - 1]; }
+            if (i < isize - 1) { sum += x[flatidx + 1]; }
+            if (j > 0)         { sum += x[flatidx - isize]; }
+            if (j < jsize - 1) { sum += x[flatidx + isize]; }
+            if (k > 0)         { sum += x[flatidx - slice]; }
+            if (k < ksize - 1) { sum += x[flatidx + slice]; }
+
+            double ax = (double)level.diag[flatidx] * x[flatidx] - sum;
+            level.r[flatidx] = level.b[flatidx] - ax;
+        }
+    }
+}
+
+/*
+    The restriction operator is the transpose of trilinear prolongation. 
+    Since the coarse stencil is the same integer-valued Laplacian with twice 
+    the cell width, the restricted residual is scaled by 4 / 8.
+*/
+void MultigridPreconditioner::_restrict(MultigridLevel &fine, MultigridLevel &coarse) {
+    std::fill(coarse.b.begin(), coarse.b.end(), 0.0);
+
+    std::vector<int> *colours[2] = {&(fine.redCells), &(fine.blackCells)};
+    int coarseIndices[8];
+    double weights[8];
+    for (int c = 0; c < 2; c++) {
+        std::vector<int> &cells = *(colours[c]);
+        for (unsigned int idx = 0; idx < cells.size(); idx++) {
+            int flatidx = cells[idx];
+            double r = 0.5 * fine.r[flatidx];
+            _getInterpolationStencil(fine, coarse, flatidx, coarseIndices, weights);
+            for (int n = 0; n < 8; n++) {
+                int cidx = coarseIndices[n];
+                if (cidx != -1 && coarse.cellTypes[cidx] == CellType::fluid) {
+                    coarse.b[cidx] += weights[n] * r;
+                }
+            }
+        }
+    }
+}
+
+void MultigridPreconditioner::_prolongateAndAdd(MultigridLevel &coarse, 
+                                                MultigridLevel &fine) {
+    std::vector<int> *colours[2] = {&(fine.redCells), &(fine.blackCells)};
+    int coarseIndices[8];
+    double weights[8];
+    for (int c = 0; c < 2; c++) {
+        std::vector<int> &cells = *(colours[c]);
+        for (unsigned int idx = 0; idx < cells.size(); idx++) {
+            int flatidx = cells[idx];
+            _getInterpolationStencil(fine, coarse, flatidx, coarseIndices, weights);
+
+            double sum = 0.0;
+            for (int n = 0; n < 8; n++) {
+                int cidx = coarseIndices[n];
+                if (cidx != -1 && coarse.cellTypes[cidx] == CellType::fluid) {
+                    sum += weights[n] * coarse.x[cidx];
+                }
+            }
+            fine.x[flatidx] += sum;
+        }
+    }
+}
+
+/*
+    A fine cell centre lies a quarter coarse cell width from the centre of its
+    parent cell, so it is interpolated with weights 3/4 and 1/4 along each 
+    axis. Stencil indices that fall outside of the coarse grid are set to -1.
+*/
+void MultigridPreconditioner::_getInterpolationStencil(MultigridLevel &fine,
+                                                       MultigridLevel &coarse,
+                                                       int fineIndex, 
+                                                       int *coarseIndices, 
+                                                       double *weights) {
+    int fi = fineIndex % fine.isize;
+    int fj = (fineIndex / fine.isize) % fine.jsize;
+    int fk = fineIndex / (fine.isize*fine.jsize);
+
+    int ci[2] = {fi / 2, fi % 2 == 0 ? fi / 2 - 1 : fi / 2 + 1};
+    int cj[2] = {fj / 2, fj % 2 == 0 ? fj / 2 - 1 : fj / 2 + 1};
+    int ck[2] = {fk / 2, fk % 2 == 0 ? fk / 2 - 1 : fk / 2 + 1};
+    double w[2] = {0.75, 0.25};
+
+    int n = 0;
+    for (int k = 0; k < 2; k++) {
+        for (int j = 0; j < 2; j++) {
+            for (int i = 0; i < 2; i++) {
+                weights[n] = w[i]*w[j]*w[k];
+                if (Grid3d::isGridIndexInRange(ci[i], cj[j], ck[k], 
+                                               coarse.isize, coarse.jsize, coarse.ksize)) {
+                    coarseIndices[n] = coarse.flatIndex(ci[i], cj[j], ck[k]);
+                } else {
+                    coarseIndices[n] = -1;
+                }
+                n++;
+            }
+        }
+    }
+}
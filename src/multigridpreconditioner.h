@@ -0,0 +1,125 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef MULTIGRIDPRECONDITIONER_H
+#define MULTIGRIDPRECONDITIONER_H
+
+#include <vector>
+#include <stdio.h>
+#include <iostream>
+#include <algorithm>
+
+#include "fluidmaterialgrid.h"
+#include "gridindexvector.h"
+#include "grid3d.h"
+
+/*
+    Matrix-free geometric multigrid preconditioner for the pressure 
+    Poisson system.
+
+    The finest level matches the material grid. Each coarse level halves the
+    grid resolution. A coarse cell is air if any of its children are air, 
+    otherwise fluid if any of its children are fluid, otherwise solid. Air 
+    cells are treated as Dirichlet (p = 0) boundaries and solid cells as 
+    Neumann boundaries on every level.
+
+    The preconditioner applies a single V-cycle using red-black Gauss-Seidel
+    smoothing and trilinear interpolation. The post-smoothing sweeps run in 
+    the reverse colour order of the pre-smoothing sweeps and the restriction
+    is the transpose of the prolongation so that the preconditioner remains
+    symmetric for use in conjugate gradient.
+*/
+class MultigridPreconditioner
+{
+public:
+    MultigridPreconditioner();
+    ~MultigridPreconditioner();
+
+    /*
+        fluidCells must match the fluid cells of materialGrid and be ordered
+        to match the pressure system vector. scale is the multiplier of the 
+        integer-valued Laplacian stencil in the pressure matrix.
+    */
+    void initialize(FluidMaterialGrid *materialGrid, 
+                    GridIndexVector *fluidCells, 
+                    double scale);
+
+    /*
+        Approximately solves A*z = residual. Both vectors are indexed in
+        pressure system order.
+    */
+    void apply(std::vector<double> &residual, std::vector<double> &z);
+    void apply(std::vector<float> &residual, std::vector<float> &z);
+
+    int getNumLevels();
+
+    void setNumSmoothingIterations(int n);
+    void setNumCoarseSolveIterations(int n);
+
+private:
+
+    enum class CellType : char { 
+        air   = 0x00, 
+        fluid = 0x01, 
+        solid = 0x02
+    };
+
+    struct MultigridLevel {
+        int isize = 0;
+        int jsize = 0;
+        int ksize = 0;
+        std::vector<CellType> cellTypes;
+        std::vector<char> diag;
+        std::vector<int> redCells;
+        std::vector<int> blackCells;
+        std::vector<double> x;
+        std::vector<double> b;
+        std::vector<double> r;
+
+        inline int flatIndex(int i, int j, int k) {
+            return i + isize*(j + jsize*k);
+        }
+    };
+
+    template <class T>
+    void _apply(std::vector<T> &residual, std::vector<T> &z);
+    void _initializeFinestLevel(FluidMaterialGrid *materialGrid);
+    void _initializeCoarseLevel(MultigridLevel &fine, MultigridLevel &coarse);
+    void _initializeLevelCells(MultigridLevel &level);
+    bool _isCellSolid(MultigridLevel &level, int i, int j, int k);
+    void _vCycle(int levelIndex);
+    void _smooth(MultigridLevel &level, std::vector<int> &cells);
+    void _calculateResidual(MultigridLevel &level);
+    void _restrict(MultigridLevel &fine, MultigridLevel &coarse);
+    void _prolongateAndAdd(MultigridLevel &coarse, MultigridLevel &fine);
+    void _getInterpolationStencil(MultigridLevel &fine, MultigridLevel &coarse,
+                                  int fineIndex, int *coarseIndices, double *weights);
+
+    int _maxLevels = 8;
+    int _minCoarseLevelWidth = 4;
+    int _numSmoothingIterations = 2;
+    int _numCoarseSolveIterations = 20;
+
+    double _scale = 1.0;
+    double _invscale = 1.0;
+    std::vector<int> _fineCellIndices;
+    std::vector<MultigridLevel> _levels;
+};
+
+#endif
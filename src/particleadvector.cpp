@@ -27,15 +27,25 @@ ParticleAdvector::ParticleAdvector() {
 }
 
 bool ParticleAdvector::initialize() {
+    if (_isNativeDevicePreferred) {
+        _initializeNativeBackend();
+        return true;
+    }
+
+#if WITH_OPENCL
+    // Fall back to the native multithreaded backend if the host does
+    // not have an OpenCL device
     cl_int err;
     cl::Context context = _getCLContext(&err);
     if (err != CL_SUCCESS) {
-        return false;
+        _initializeNativeBackend();
+        return true;
     }
 
     cl::Device device = _getCLDevice(context, &err);
     if (err != CL_SUCCESS) {
-        return false;
+        _initializeNativeBackend();
+        return true;
     }
     _CLContext = context;
     _CLDevice = device;
@@ -53,6 +63,10 @@ bool ParticleAdvector::initialize() {
 
     _isInitialized = true;
     return true;
+#else
+    _initializeNativeBackend();
+    return true;
+#endif
 }
 
 void ParticleAdvector::setDevicePreference(std::string devtype) {
@@ -62,17 +76,29 @@ void ParticleAdvector::setDevicePreference(std::string devtype) {
         setDevicePreferenceGPU();
     } else if (devtype == "cpu") {
         setDevicePreferenceCPU();
+    } else if (devtype == "native") {
+        setDevicePreferenceNative();
     }
 }
 
 void ParticleAdvector::setDevicePreferenceGPU() {
+#if WITH_OPENCL
     _devicePreference1 = CL_DEVICE_TYPE_GPU;
     _devicePreference2 = CL_DEVICE_TYPE_CPU;
+#endif
+    _isNativeDevicePreferred = false;
 }
 
 void ParticleAdvector::setDevicePreferenceCPU() {
+#if WITH_OPENCL
     _devicePreference1 = CL_DEVICE_TYPE_CPU;
     _devicePreference2 = CL_DEVICE_TYPE_GPU;
+#endif
+    _isNativeDevicePreferred = false;
+}
+
+void ParticleAdvector::setDevicePreferenceNative() {
+    _isNativeDevicePreferred = true;
 }
 
 void ParticleAdvector::printDeviceInfo() {
@@ -80,6 +106,16 @@ void ParticleAdvector::printDeviceInfo() {
         return;
     }
 
+    if (_isUsingNative) {
+        std::cout << "NATIVE_DEVICE_TYPE:            CPU" << std::endl;
+        std::cout << "NATIVE_MAX_THREADS:            " << 
+                     ThreadUtils::getMaxThreadCount() << std::endl;
+        std::cout << "NATIVE_INSTRUCTION_SET:        " << 
+                     TricubicKernels::getInterpolationKernelName() << std::endl;
+        return;
+    }
+
+#if WITH_OPENCL
     std::cout << "CL_DEVICE_NAME:                " << 
                  _deviceInfo.cl_device_name << std::endl;
     std::cout << "CL_DEVICE_VENDOR:              " << 
@@ -125,20 +161,33 @@ void ParticleAdvector::printDeviceInfo() {
     std::cout << "CL_DEVICE_MAX_WORK_ITEM_SIZES: " << g.i << " x " << 
                                                       g.j << " x " << 
                                                       g.k << std::endl;
+#endif
 }
 
 bool ParticleAdvector::isUsingGPU() {
-    if (!_isInitialized) {
+    if (!_isInitialized || _isUsingNative) {
         return false;
     }
+#if WITH_OPENCL
     return _deviceInfo.device_type == CL_DEVICE_TYPE_GPU;
+#else
+    return false;
+#endif
 }
 
 bool ParticleAdvector::isUsingCPU() {
-    if (!_isInitialized) {
+    if (!_isInitialized || _isUsingNative) {
         return false;
     }
+#if WITH_OPENCL
     return _deviceInfo.device_type == CL_DEVICE_TYPE_CPU;
+#else
+    return false;
+#endif
+}
+
+bool ParticleAdvector::isUsingNative() {
+    return _isInitialized && _isUsingNative;
 }
 
 void ParticleAdvector::advectParticlesRK4(std::vector<vmath::vec3> &particles,
@@ -318,6 +367,119 @@ void ParticleAdvector::tricubicInterpolate(std::vector<vmath::vec3> &particles,
                                            std::vector<vmath::vec3> &output) {
     assert(_isInitialized);
 
+    if (output.size() < particles.size()) {
+        output.resize(particles.size());
+    }
+
+    _tricubicInterpolate(_getParticleArrayView(particles), vfield, 
+                         _getParticleArrayView(output));
+}
+
+void ParticleAdvector::tricubicInterpolate(std::vector<vmath::vec3> &particles,
+                                           MACVelocityField *vfield) {
+    tricubicInterpolate(particles, vfield, particles);
+}
+
+void ParticleAdvector::advectParticlesRK4(float *x, float *y, float *z, int n,
+                                          MACVelocityField *vfield, 
+                                          double dt,
+                                          float *outx, float *outy, float *outz) {
+    assert(_isInitialized);
+
+    // Same scheme as the std::vector<vmath::vec3> version. Stages are 
+    // interpolated in place in the temporary component arrays.
+    std::vector<float> tx(n), ty(n), tz(n);
+
+    tricubicInterpolate(x, y, z, n, vfield, tx.data(), ty.data(), tz.data());
+
+    float scale = (float)dt / 6.0f;
+    float hdt = (float)(0.5*dt);
+    for (int i = 0; i < n; i++) {
+        outx[i] = x[i] + scale * tx[i];
+        outy[i] = y[i] + scale * ty[i];
+        outz[i] = z[i] + scale * tz[i];
+        tx[i] = x[i] + hdt * tx[i];
+        ty[i] = y[i] + hdt * ty[i];
+        tz[i] = z[i] + hdt * tz[i];
+    }
+
+    tricubicInterpolate(tx.data(), ty.data(), tz.data(), n, vfield,
+                        tx.data(), ty.data(), tz.data());
+
+    for (int i = 0; i < n; i++) {
+        outx[i] += scale * 2.0f * tx[i];
+        outy[i] += scale * 2.0f * ty[i];
+        outz[i] += scale * 2.0f * tz[i];
+        tx[i] = x[i] + hdt * tx[i];
+        ty[i] = y[i] + hdt * ty[i];
+        tz[i] = z[i] + hdt * tz[i];
+    }
+
+    tricubicInterpolate(tx.data(), ty.data(), tz.data(), n, vfield,
+                        tx.data(), ty.data(), tz.data());
+
+    float fdt = (float)dt;
+    for (int i = 0; i < n; i++) {
+        outx[i] += scale * 2.0f * tx[i];
+        outy[i] += scale * 2.0f * ty[i];
+        outz[i] += scale * 2.0f * tz[i];
+        tx[i] = x[i] + fdt * tx[i];
+        ty[i] = y[i] + fdt * ty[i];
+        tz[i] = z[i] + fdt * tz[i];
+    }
+
+    tricubicInterpolate(tx.data(), ty.data(), tz.data(), n, vfield,
+                        tx.data(), ty.data(), tz.data());
+
+    for (int i = 0; i < n; i++) {
+        outx[i] += scale * tx[i];
+        outy[i] += scale * ty[i];
+        outz[i] += scale * tz[i];
+    }
+}
+
+void ParticleAdvector::tricubicInterpolate(float *x, float *y, float *z, int n,
+                                           MACVelocityField *vfield,
+                                           float *outu, float *outv, float *outw) {
+    assert(_isInitialized);
+
+    _tricubicInterpolate(_getParticleArrayView(x, y, z, n), vfield,
+                         _getParticleArrayView(outu, outv, outw, n));
+}
+
+ParticleAdvector::ParticleArrayView ParticleAdvector::_getParticleArrayView(
+                                        std::vector<vmath::vec3> &particles) {
+    static_assert(sizeof(vmath::vec3) == 3*sizeof(float), 
+                  "vmath::vec3 must be three tightly packed floats");
+
+    ParticleArrayView view;
+    view.size = particles.size();
+    view.stride = 3;
+    if (!particles.empty()) {
+        view.x = &(particles[0].x);
+        view.y = &(particles[0].y);
+        view.z = &(particles[0].z);
+    }
+
+    return view;
+}
+
+ParticleAdvector::ParticleArrayView ParticleAdvector::_getParticleArrayView(
+                                        float *x, float *y, float *z, int n) {
+    ParticleArrayView view;
+    view.x = x;
+    view.y = y;
+    view.z = z;
+    view.stride = 1;
+    view.size = n;
+
+    return view;
+}
+
+void ParticleAdvector::_tricubicInterpolate(ParticleArrayView particles,
+                                            MACVelocityField *vfield,
+                                            ParticleArrayView output) {
+
     vfield->getGridDimensions(&_isize, &_jsize, &_ksize);
     _dx = vfield->getGridCellSize();
 
@@ -341,14 +503,15 @@ void ParticleAdvector::tricubicInterpolate(std::vector<vmath::vec3> &particles,
     std::vector<DataChunkParameters> chunkParams;
     _getDataChunkParameters(vfield, particleGrid, chunkParams);
 
+    if (_isUsingNative) {
+        _tricubicInterpolateChunksNative(chunkParams, output);
+        return;
+    }
+
+#if WITH_OPENCL
     int maxChunks = _getMaxChunksPerComputation();
     int numComputations = ceil((double)chunkParams.size() / (double) maxChunks);
 
-    output.reserve(particles.size());
-    for (unsigned int i = output.size(); i < particles.size(); i++) {
-        output.push_back(vmath::vec3());
-    }
-
     std::vector<DataChunkParameters> chunks;
     for (int i = 0; i < numComputations; i++) {
         std::vector<DataChunkParameters>::iterator beg;
@@ -365,13 +528,10 @@ void ParticleAdvector::tricubicInterpolate(std::vector<vmath::vec3> &particles,
 
         _tricubicInterpolateChunks(chunks, output);
     }
+#endif
 }
 
-void ParticleAdvector::tricubicInterpolate(std::vector<vmath::vec3> &particles,
-                                           MACVelocityField *vfield) {
-    tricubicInterpolate(particles, vfield, particles);
-}
-
+#if WITH_OPENCL
 void ParticleAdvector::_checkError(cl_int err, const char * name) {
     if (err != CL_SUCCESS) {
         std::cerr << "ERROR: " << name  << " (" << err << ")" << std::endl;
@@ -516,9 +676,10 @@ cl_int ParticleAdvector::_initializeCLCommandQueue() {
 
     return CL_SUCCESS;
 }
+#endif
 
 void ParticleAdvector::_getParticleChunkGrid(double cwidth, double cheight, double cdepth,
-                                             std::vector<vmath::vec3> &particles,
+                                             ParticleArrayView &particles,
                                              Array3d<ParticleChunk> &grid) {
 
     int bwidth = grid.width * cwidth;
@@ -529,8 +690,8 @@ void ParticleAdvector::_getParticleChunkGrid(double cwidth, double cheight, doub
 
     Array3d<int> countGrid(grid.width, grid.height, grid.depth, 0);
     vmath::vec3 p;
-    for (unsigned int i = 0; i < particles.size(); i++) {
-        p = particles[i];
+    for (int i = 0; i < particles.size; i++) {
+        p = particles.get(i);
 
         if (!bbox.isPointInside(p)) {
             p = bbox.getNearestPointInsideAABB(p, eps);
@@ -564,8 +725,8 @@ void ParticleAdvector::_getParticleChunkGrid(double cwidth, double cheight, doub
         }
     }
 
-    for (unsigned int i = 0; i < particles.size(); i++) {
-        p = particles[i];
+    for (int i = 0; i < particles.size; i++) {
+        p = particles.get(i);
 
         if (!bbox.isPointInside(p)) {
             p = bbox.getNearestPointInsideAABB(p, eps);
@@ -599,22 +760,22 @@ void ParticleAdvector::_getDataChunkParametersForChunkIndex(GridIndex cindex,
                                                              indexOffset.j,
                                                              indexOffset.k, dx);
 
-    Array3d<float> *ugrid = vfield->getArray3dU();
-    Array3d<float> *vgrid = vfield->getArray3dV();
-    Array3d<float> *wgrid = vfield->getArray3dW();
+    SparseArray3d<float> *ugrid = vfield->getArray3dU();
+    SparseArray3d<float> *vgrid = vfield->getArray3dV();
+    SparseArray3d<float> *wgrid = vfield->getArray3dW();
 
     GridIndex ugridOffset(indexOffset.i - 1, indexOffset.j - 2, indexOffset.k - 2);
     GridIndex vgridOffset(indexOffset.i - 2, indexOffset.j - 1, indexOffset.k - 2);
     GridIndex wgridOffset(indexOffset.i - 2, indexOffset.j - 2, indexOffset.k - 1);
 
-    ArrayView3d<float> ugridview(_dataChunkWidth + 3, _dataChunkHeight + 4, _dataChunkDepth + 4,
+    FaceArrayView3d ugridview(_dataChunkWidth + 3, _dataChunkHeight + 4, _dataChunkDepth + 4,
                                  ugridOffset, ugrid);
-    ArrayView3d<float> vgridview(_dataChunkWidth + 4, _dataChunkHeight + 3, _dataChunkDepth + 4,
+    FaceArrayView3d vgridview(_dataChunkWidth + 4, _dataChunkHeight + 3, _dataChunkDepth + 4,
                                  vgridOffset, vgrid);
-    ArrayView3d<float> wgridview(_dataChunkWidth + 4, _dataChunkHeight + 4, _dataChunkDepth + 3,
+    FaceArrayView3d wgridview(_dataChunkWidth + 4, _dataChunkHeight + 4, _dataChunkDepth + 3,
                                  wgridOffset, wgrid);
 
-    int groupSize = _getWorkGroupSize(_deviceInfo);
+    int groupSize = _getWorkGroupSize();
     int numDataChunks = ceil((double)particleChunk->particles.size() / (double)groupSize);
 
     for (int i = 0; i < numDataChunks; i++) {
@@ -660,16 +821,26 @@ void ParticleAdvector::_getDataChunkParameters(MACVelocityField *vfield,
     }
 }
 
-int ParticleAdvector::_getWorkGroupSize(CLDeviceInfo &info) {
-    int devicemax = fmin(info.cl_device_max_work_group_size,
-                         info.cl_device_max_work_item_sizes.i);
+int ParticleAdvector::_getWorkGroupSize() {
+    if (_isUsingNative) {
+        return _maxItemsPerWorkGroup;
+    }
+
+#if WITH_OPENCL
+    int devicemax = fmin(_deviceInfo.cl_device_max_work_group_size,
+                         _deviceInfo.cl_device_max_work_item_sizes.i);
     return fmin(devicemax, _maxItemsPerWorkGroup);
+#else
+    return _maxItemsPerWorkGroup;
+#endif
 }
 
+#if WITH_OPENCL
 int ParticleAdvector::_getChunkPositionDataSize() {
     // <x, y, z> position data size
-    return 3*sizeof(float)*_getWorkGroupSize(_deviceInfo);
+    return 3*sizeof(float)*_getWorkGroupSize();
 }
+#endif
 
 int ParticleAdvector::_getChunkVelocityDataSize() {
     // u, v, w Velocity field data size
@@ -684,6 +855,7 @@ int ParticleAdvector::_getChunkVelocityDataSize() {
     return usize + vsize + wsize;
 }
 
+#if WITH_OPENCL
 int ParticleAdvector::_getChunkOffsetDataSize() {
     // <i, j, k> chunk index offset data size
     return 3*sizeof(int);
@@ -721,12 +893,12 @@ int ParticleAdvector::_getMaxChunksPerComputation() {
 }
 
 void ParticleAdvector::_tricubicInterpolateChunks(std::vector<DataChunkParameters> &chunks,
-                                                  std::vector<vmath::vec3> &output) {
+                                                  ParticleArrayView &output) {
     DataBuffer buffer;
     _initializeDataBuffer(chunks, buffer);
     _setCLKernelArgs(buffer, _dx);
 
-    int workGroupSize = _getWorkGroupSize(_deviceInfo);
+    int workGroupSize = _getWorkGroupSize();
     int numWorkItems = chunks.size()*workGroupSize;
 
     cl::Event event;
@@ -787,7 +959,7 @@ void ParticleAdvector::_initializeDataBuffer(std::vector<DataChunkParameters> &c
 void ParticleAdvector::_getHostPositionDataBuffer(std::vector<DataChunkParameters> &chunks,
                                                   std::vector<vmath::vec3> &buffer) {
 
-    int groupSize = _getWorkGroupSize(_deviceInfo);
+    int groupSize = _getWorkGroupSize();
     int numElements = chunks.size()*groupSize;
     buffer.reserve(numElements);
 
@@ -816,6 +988,7 @@ void ParticleAdvector::_getHostVelocityDataBuffer(std::vector<DataChunkParameter
         _appendChunkVelocityDataToBuffer(chunks[i], buffer);
     }
 }
+#endif
 
 void ParticleAdvector::_appendChunkVelocityDataToBuffer(DataChunkParameters &chunk, 
                                                         std::vector<float> &buffer) {
@@ -845,6 +1018,7 @@ void ParticleAdvector::_appendChunkVelocityDataToBuffer(DataChunkParameters &chu
     }
 }
 
+#if WITH_OPENCL
 void ParticleAdvector::_getHostChunkOffsetDataBuffer(std::vector<DataChunkParameters> &chunks,
                                                      std::vector<GridIndex> &buffer) {
     buffer.reserve(chunks.size());
@@ -875,9 +1049,9 @@ void ParticleAdvector::_setCLKernelArgs(DataBuffer &buffer, double dx) {
 
 void ParticleAdvector::_setOutputData(std::vector<DataChunkParameters> &chunks,
                                       DataBuffer &buffer,
-                                      std::vector<vmath::vec3> &output) {
+                                      ParticleArrayView &output) {
 
-    int workGroupSize = _getWorkGroupSize(_deviceInfo);
+    int workGroupSize = _getWorkGroupSize();
 
     DataChunkParameters chunk;
     for (unsigned int gidx = 0; gidx < chunks.size(); gidx++) {
@@ -888,10 +1062,118 @@ void ParticleAdvector::_setOutputData(std::vector<DataChunkParameters> &chunks,
         std::vector<int>::iterator begin = chunk.referencesBegin;
         std::vector<int>::iterator end = chunk.referencesEnd;
         for (std::vector<int>::iterator it = begin; it != end; ++it) {
-            output[*it] = buffer.positionDataH[hostOffset + dataOffset];
+            output.set(*it, buffer.positionDataH[hostOffset + dataOffset]);
             dataOffset++;
         }
     }
 }
+#endif
+
+void ParticleAdvector::_initializeNativeBackend() {
+    _nativeKernel = TricubicKernels::getInterpolationKernel();
+    _isUsingNative = true;
+    _isInitialized = true;
+}
+
+void ParticleAdvector::_tricubicInterpolateChunksNative(std::vector<DataChunkParameters> &chunks,
+                                                        ParticleArrayView &output) {
+    if (chunks.empty()) {
+        return;
+    }
+
+    int numthreads = (int)fmin(ThreadUtils::getMaxThreadCount(), chunks.size());
+    std::vector<int> intervals = ThreadUtils::splitRangeIntoIntervals(0, chunks.size(), 
+                                                                      numthreads);
+    std::vector<std::thread> threads(numthreads);
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&ParticleAdvector::_tricubicInterpolateChunksNativeThread, this,
+                                 &chunks, intervals[i], intervals[i + 1], output);
+    }
+
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
+}
+
+/*
+    Each thread copies the velocity data of a chunk into a local buffer with
+    the same layout as the OpenCL local memory buffer and interpolates the
+    chunk particles from this buffer. Particle references are unique, so 
+    threads never write to the same output element.
+*/
+void ParticleAdvector::_tricubicInterpolateChunksNativeThread(std::vector<DataChunkParameters> *chunks,
+                                                              int startidx, int endidx,
+                                                              ParticleArrayView output) {
+    std::vector<float> vfieldData;
+    vfieldData.reserve(_getChunkVelocityDataSize() / sizeof(float));
+
+    float dx = (float)_dx;
+    float invdx = 1.0f / dx;
+
+    DataChunkParameters *chunk;
+    for (int cidx = startidx; cidx < endidx; cidx++) {
+        chunk = &(chunks->at(cidx));
+
+        vfieldData.clear();
+        _appendChunkVelocityDataToBuffer(*chunk, vfieldData);
+
+        std::vector<vmath::vec3>::iterator pit = chunk->particlesBegin;
+        std::vector<int>::iterator rit = chunk->referencesBegin;
+        for (; pit != chunk->particlesEnd; ++pit, ++rit) {
+            vmath::vec3 localpos = *pit - chunk->positionOffset;
+            output.set(*rit, _tricubicInterpolateNative(localpos, &(vfieldData[0]), 
+                                                        dx, invdx));
+        }
+    }
+}
+
+vmath::vec3 ParticleAdvector::_tricubicInterpolateNative(vmath::vec3 localpos, 
+                                                         float *vfieldData, 
+                                                         float dx, float invdx) {
+    int cw = _dataChunkWidth;
+    int ch = _dataChunkHeight;
+    int cd = _dataChunkDepth;
+    int uoffset = 0;
+    int voffset = uoffset + (cw + 3)*(ch + 4)*(cd + 4);
+    int woffset = voffset + (cw + 4)*(ch + 3)*(cd + 4);
+    float hdx = 0.5f*dx;
+
+    float u = _tricubicInterpolateFieldNative(localpos - vmath::vec3(0.0f, hdx, hdx),
+                                              GridIndex(1, 2, 2), cw + 3, ch + 4,
+                                              vfieldData + uoffset, dx, invdx);
+    float v = _tricubicInterpolateFieldNative(localpos - vmath::vec3(hdx, 0.0f, hdx),
+                                              GridIndex(2, 1, 2), cw + 4, ch + 3,
+                                              vfieldData + voffset, dx, invdx);
+    float w = _tricubicInterpolateFieldNative(localpos - vmath::vec3(hdx, hdx, 0.0f),
+                                              GridIndex(2, 2, 1), cw + 4, ch + 4,
+                                              vfieldData + woffset, dx, invdx);
+
+    return vmath::vec3(u, v, w);
+}
+
+/*
+    Matches interpolate_U/V/W in tricubicinterpolate.cl. pad is the 
+    offset of the chunk origin within the padded field view.
+*/
+float ParticleAdvector::_tricubicInterpolateFieldNative(vmath::vec3 pos, GridIndex pad,
+                                                        int fieldWidth, int fieldHeight,
+                                                        float *fieldData, 
+                                                        float dx, float invdx) {
+    int i = (int)floor(pos.x * invdx);
+    int j = (int)floor(pos.y * invdx);
+    int k = (int)floor(pos.z * invdx);
+
+    float ix = invdx * (pos.x - i*dx);
+    float iy = invdx * (pos.y - j*dx);
+    float iz = invdx * (pos.z - k*dx);
+
+    int flatidx = Grid3d::getFlatIndex(i - 1 + pad.i, 
+                                       j - 1 + pad.j, 
+                                       k - 1 + pad.k, 
+                                       fieldWidth, fieldHeight);
+
+    return _nativeKernel(fieldData + flatidx, fieldWidth, fieldWidth*fieldHeight, 
+                         ix, iy, iz);
+}
 
 #pragma GCC diagnostic pop
\ No newline at end of file
@@ -24,22 +24,34 @@ freely, subject to the following restrictions:
 #ifndef PARTICLEADVECTOR_H
 #define PARTICLEADVECTOR_H
 
-#if defined(__APPLE__) || defined(__MACOSX)
-    #include <OpenCL/cl.hpp>
-#else
-    #include <CL/cl.hpp>
+// Build with WITH_OPENCL=0 to compile without the OpenCL library. Particles
+// will then always be advected with the native backend.
+#ifndef WITH_OPENCL
+    #define WITH_OPENCL 1
+#endif
+
+#if WITH_OPENCL
+    #if defined(__APPLE__) || defined(__MACOSX)
+        #include <OpenCL/cl.hpp>
+    #else
+        #include <CL/cl.hpp>
+    #endif
 #endif
 
 #include <vector>
 #include <fstream>
 #include <algorithm>
 #include <string>
+#include <thread>
 
 #include "macvelocityfield.h"
 #include "array3d.h"
+#include "sparsearray3d.h"
 #include "arrayview3d.h"
 #include "grid3d.h"
 #include "stopwatch.h"
+#include "threadutils.h"
+#include "tricubickernels.h"
 
 class ParticleAdvector
 {
@@ -50,10 +62,12 @@ public:
     void setDevicePreference(std::string devtype);
     void setDevicePreferenceGPU();
     void setDevicePreferenceCPU();
+    void setDevicePreferenceNative();
 
     void printDeviceInfo();
     bool isUsingGPU();
     bool isUsingCPU();
+    bool isUsingNative();
 
     void advectParticlesRK4(std::vector<vmath::vec3> &particles,
                             MACVelocityField *vfield,
@@ -83,8 +97,24 @@ public:
     void tricubicInterpolate(std::vector<vmath::vec3> &particles,
                              MACVelocityField *vfield);
 
+    /*
+        Structure-of-arrays versions of the above methods. Positions are 
+        read from n contiguous x, y and z components and results are written
+        to the output component arrays. Interpolation output may alias the 
+        input arrays, advection output may not.
+    */
+    void advectParticlesRK4(float *x, float *y, float *z, int n,
+                            MACVelocityField *vfield, 
+                            double dt,
+                            float *outx, float *outy, float *outz);
+
+    void tricubicInterpolate(float *x, float *y, float *z, int n,
+                             MACVelocityField *vfield,
+                             float *outu, float *outv, float *outw);
+
 private:
 
+#if WITH_OPENCL
     struct CLDeviceInfo {
         std::string cl_device_name;
         std::string cl_device_vendor;
@@ -100,27 +130,55 @@ private:
         cl_uint cl_device_max_work_group_size;
         GridIndex cl_device_max_work_item_sizes;
     };
+#endif
+
+    /*
+        Strided view over particle vectors so that std::vector<vmath::vec3> 
+        data (stride 3) and structure-of-arrays data (stride 1) share the 
+        same chunking and interpolation code.
+    */
+    struct ParticleArrayView {
+        float *x = NULL;
+        float *y = NULL;
+        float *z = NULL;
+        int stride = 1;
+        int size = 0;
+
+        inline vmath::vec3 get(int i) {
+            int idx = i*stride;
+            return vmath::vec3(x[idx], y[idx], z[idx]);
+        }
+
+        inline void set(int i, vmath::vec3 v) {
+            int idx = i*stride;
+            x[idx] = v.x; y[idx] = v.y; z[idx] = v.z;
+        }
+    };
 
     struct ParticleChunk {
         std::vector<vmath::vec3> particles;
         std::vector<int> references;
     };
 
+    // Views into the sparse face velocity grids of a MACVelocityField
+    typedef ArrayView3d<float, RowMajorLayout, SparseArray3d<float> > FaceArrayView3d;
+
     struct DataChunkParameters {
         std::vector<vmath::vec3>::iterator particlesBegin;
         std::vector<vmath::vec3>::iterator particlesEnd;
         std::vector<int>::iterator referencesBegin;
         std::vector<int>::iterator referencesEnd;
 
-        ArrayView3d<float> ufieldview;
-        ArrayView3d<float> vfieldview;
-        ArrayView3d<float> wfieldview;
+        FaceArrayView3d ufieldview;
+        FaceArrayView3d vfieldview;
+        FaceArrayView3d wfieldview;
 
         GridIndex chunkOffset;
         GridIndex indexOffset;
         vmath::vec3 positionOffset;
     };
 
+#if WITH_OPENCL
     struct DataBuffer {
         std::vector<vmath::vec3> positionDataH;
         std::vector<float> vfieldDataH;
@@ -130,17 +188,15 @@ private:
         cl::Buffer vfieldDataCL;
         cl::Buffer offsetDataCL;
     };
+#endif
 
-    void _checkError(cl_int err, const char * name);
-    cl::Context _getCLContext(cl_int *err);
-    cl::Device _getCLDevice(cl::Context &context, cl_int *err);
-    CLDeviceInfo _initializeDeviceInfo(cl::Device &device);
-    cl_int _initializeCLKernel();
-    std::string _getProgramString(std::string filename);
-    cl_int _initializeCLCommandQueue();
-
+    ParticleArrayView _getParticleArrayView(std::vector<vmath::vec3> &particles);
+    ParticleArrayView _getParticleArrayView(float *x, float *y, float *z, int n);
+    void _tricubicInterpolate(ParticleArrayView particles,
+                              MACVelocityField *vfield,
+                              ParticleArrayView output);
     void _getParticleChunkGrid(double cwidth, double cheight, double cdepth,
-                               std::vector<vmath::vec3> &particles,
+                               ParticleArrayView &particles,
                                Array3d<ParticleChunk> &grid);
     void _getDataChunkParameters(MACVelocityField *vfield,
                                  Array3d<ParticleChunk> &particleChunkGrid,
@@ -150,33 +206,61 @@ private:
                                               ParticleChunk *particleChunk,
                                               std::vector<DataChunkParameters> &chunkParameters);
     
-    int _getWorkGroupSize(CLDeviceInfo &info);
-    int _getChunkPositionDataSize();
+    int _getWorkGroupSize();
     int _getChunkVelocityDataSize();
+    void _appendChunkVelocityDataToBuffer(DataChunkParameters &chunk, 
+                                          std::vector<float> &buffer);
+
+    void _initializeNativeBackend();
+    void _tricubicInterpolateChunksNative(std::vector<DataChunkParameters> &chunks,
+                                          ParticleArrayView &output);
+    void _tricubicInterpolateChunksNativeThread(std::vector<DataChunkParameters> *chunks,
+                                                int startidx, int endidx,
+                                                ParticleArrayView output);
+    vmath::vec3 _tricubicInterpolateNative(vmath::vec3 localpos, 
+                                           float *vfieldData, 
+                                           float dx, float invdx);
+    float _tricubicInterpolateFieldNative(vmath::vec3 pos, GridIndex pad,
+                                          int fieldWidth, int fieldHeight,
+                                          float *fieldData, 
+                                          float dx, float invdx);
+
+#if WITH_OPENCL
+    void _checkError(cl_int err, const char * name);
+    cl::Context _getCLContext(cl_int *err);
+    cl::Device _getCLDevice(cl::Context &context, cl_int *err);
+    CLDeviceInfo _initializeDeviceInfo(cl::Device &device);
+    cl_int _initializeCLKernel();
+    std::string _getProgramString(std::string filename);
+    cl_int _initializeCLCommandQueue();
+
+    int _getChunkPositionDataSize();
     int _getChunkOffsetDataSize();
     int _getChunkTotalDataSize();
     int _getMaxChunksPerComputation();
 
     void _tricubicInterpolateChunks(std::vector<DataChunkParameters> &chunks,
-                                    std::vector<vmath::vec3> &output);
+                                    ParticleArrayView &output);
     void _initializeDataBuffer(std::vector<DataChunkParameters> &chunks,
                                DataBuffer &buffer);
     void _getHostPositionDataBuffer(std::vector<DataChunkParameters> &chunks,
                                     std::vector<vmath::vec3> &buffer);
     void _getHostVelocityDataBuffer(std::vector<DataChunkParameters> &chunks,
                                     std::vector<float> &buffer);
-    void _appendChunkVelocityDataToBuffer(DataChunkParameters &chunk, 
-                                          std::vector<float> &buffer);
     void _getHostChunkOffsetDataBuffer(std::vector<DataChunkParameters> &chunks,
                                        std::vector<GridIndex> &buffer);
     void _setCLKernelArgs(DataBuffer &buffer, double dx);
     void _setOutputData(std::vector<DataChunkParameters> &chunks,
                         DataBuffer &buffer,
-                        std::vector<vmath::vec3> &output);
-    
+                        ParticleArrayView &output);
+#endif
 
     bool _isInitialized = false;
+    bool _isNativeDevicePreferred = false;
+    bool _isUsingNative = false;
+    TricubicKernels::InterpolationKernel _nativeKernel = NULL;
 
+#if WITH_OPENCL
     cl_device_type _devicePreference1 = CL_DEVICE_TYPE_GPU;
     cl_device_type _devicePreference2 = CL_DEVICE_TYPE_CPU;
 
@@ -185,6 +269,7 @@ private:
     cl::Device _CLDevice;
     cl::Kernel _CLKernel;
     cl::CommandQueue _CLQueue;
+#endif
 
     int _isize = 0;
     int _jsize = 0;
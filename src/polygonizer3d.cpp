@@ -34,6 +34,8 @@ Polygonizer3d::Polygonizer3d(ImplicitSurfaceScalarField *scalarField) {
     _dx = scalarField->getCellSize();
     _surfaceThreshold = scalarField->getSurfaceThreshold();
 
+    _initializeBlockGrid();
+
     _isScalarFieldSet = true;
 }
 
@@ -329,6 +331,12 @@ const int Polygonizer3d::_triTable[256][16] = {
     { 0, 3, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
     { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 } };
 
+// Cube edge to (cell vertex at the low end of the edge, edge axis) where the
+// axes 0, 1, and 2 correspond to edges along the x, y, and z directions
+const int Polygonizer3d::_edgeVertexAxis[12][2] = {
+    {0, 0}, {1, 2}, {3, 0}, {0, 2}, {4, 0}, {5, 2}, 
+    {7, 0}, {4, 2}, {0, 1}, {1, 1}, {2, 1}, {3, 1} };
+
 
 Polygonizer3d::~Polygonizer3d() {
 }
@@ -395,44 +403,6 @@ int Polygonizer3d::_getCellSurfaceStatus(GridIndex g) {
     }
 }
 
-GridIndexVector Polygonizer3d::_findSurfaceCells() {
-    bool isEmpty = true;
-    for (int k = 0; k < _ksize + 1; k++) {
-        for (int j = 0; j < _jsize + 1; j++) {
-            for (int i = 0; i < _isize + 1; i++) {
-                if (_scalarField->getScalarFieldValue(i, j, k) > _surfaceThreshold) {
-                    isEmpty = false;
-                    goto endLoop;
-                }
-            }
-        }
-    }
-    endLoop:
-
-    if (isEmpty) {
-        return GridIndexVector(_isize, _jsize, _ksize);
-    }
-
-    GridIndexVector surfaceCells(_isize, _jsize, _ksize);
-    for (int k = 0; k < _ksize; k++) {
-        for (int j = 0; j < _jsize; j++) {
-            for (int i = 0; i < _isize; i++) {
-                GridIndex cell = GridIndex(i, j, k);
-
-                if (_isSurfaceCellMaskSet && !_surfaceCellMask->get(cell)) {
-                    continue;
-                }
-
-                if (_isCellOnSurface(cell)) {
-                    surfaceCells.push_back(cell);
-                }
-            }
-        }
-    }
-
-    return surfaceCells;
-}
-
 int Polygonizer3d::_calculateCubeIndex(GridIndex g, double isolevel) {
     GridIndex vs[8];
     Grid3d::getGridIndexVertices(g, vs);
@@ -498,168 +468,403 @@ vmath::vec3 Polygonizer3d::_vertexInterp(double isolevel, vmath::vec3 p1, vmath:
     return p1 + (float)mu*(p2 - p1);
 }
 
-void Polygonizer3d::_calculateVertexList(GridIndex g, double isolevel, int cubeIndex, 
-                                         int vertexList[12], EdgeGrid &edges) {
-    GridIndex vertices[8];
-    double vertexValues[8];
-    vmath::vec3 vertexPositions[8];
+// method of polygonizing a cell is adapted from:
+// http://paulbourke.net/geometry/polygonise/
+void Polygonizer3d::_polygonizeCell(GridIndex g, double isolevel, 
+                                    std::vector<Triangle> &triangles) {
+    int cubeIndex = _calculateCubeIndex(g, isolevel);
 
-    Grid3d::getGridIndexVertices(g, vertices);
-    for (int i = 0; i < 8; i++) {
-        vertexValues[i] = _getVertexFieldValue(vertices[i]);
-        vertexPositions[i] = _getVertexPosition(vertices[i]);
+    /* Cube is entirely in/out of the surface */
+    if (_edgeTable[cubeIndex] == 0) {
+        return;
     }
 
-    if (_edgeTable[cubeIndex] & 1) {
-        if (!edges.isSetU(vertices[0])) {
-            vmath::vec3 v = _vertexInterp(isolevel, vertexPositions[0], vertexPositions[1], 
-                                                     vertexValues[0],    vertexValues[1]);
-            _surface.vertices.push_back(v);
-            edges.U.set(vertices[0], _surface.vertices.size() - 1);
-            edges.isSetU.set(vertices[0], true);
-        }
-        vertexList[0] = edges.U(vertices[0]);
-    }
-    if (_edgeTable[cubeIndex] & 2) {
-        if (!edges.isSetW(vertices[1])) {
-            vmath::vec3 v = _vertexInterp(isolevel, vertexPositions[1], vertexPositions[2], 
-                                                     vertexValues[1],    vertexValues[2]);
-            _surface.vertices.push_back(v);
-            edges.W.set(vertices[1], _surface.vertices.size() - 1);
-            edges.isSetW.set(vertices[1], true);
+    GridIndex vertices[8];
+    Grid3d::getGridIndexVertices(g, vertices);
+
+    int vertexList[12];
+    for (int i = 0; i < 12; i++) {
+        if (_edgeTable[cubeIndex] & (1 << i)) {
+            GridIndex v = vertices[_edgeVertexAxis[i][0]];
+            vertexList[i] = _getEdgeVertexIndex(v, _edgeVertexAxis[i][1]);
         }
-        vertexList[1] = edges.W(vertices[1]);
-    }
-    if (_edgeTable[cubeIndex] & 4) {
-        if (!edges.isSetU(vertices[3])) {
-            vmath::vec3 v = _vertexInterp(isolevel, vertexPositions[2], vertexPositions[3], 
-                                                     vertexValues[2],    vertexValues[3]);
-            _surface.vertices.push_back(v);
-            edges.U.set(vertices[3], _surface.vertices.size() - 1);
-            edges.isSetU.set(vertices[3], true);
+    }
+
+    for (int i = 0; _triTable[cubeIndex][i] != -1; i += 3) {
+        Triangle t = Triangle(vertexList[_triTable[cubeIndex][i]],
+                              vertexList[_triTable[cubeIndex][i + 1]],
+                              vertexList[_triTable[cubeIndex][i + 2]]);
+
+        triangles.push_back(t);
+    }
+}
+
+void Polygonizer3d::_initializeBlockGrid() {
+    _blockGridWidth = (int)ceil((double)_isize / (double)_blockSize);
+    _blockGridHeight = (int)ceil((double)_jsize / (double)_blockSize);
+    _blockGridDepth = (int)ceil((double)_ksize / (double)_blockSize);
+    _isCandidateBlock = Array3d<bool>(_blockGridWidth, _blockGridHeight, 
+                                      _blockGridDepth, false);
+}
+
+/*
+    Flat indices of the blocks to test for the surface, in increasing order.
+    Every block is a candidate if no seed points have been added.
+*/
+void Polygonizer3d::_getCandidateBlocks(std::vector<int> &blocks) {
+    int numBlocks = _blockGridWidth*_blockGridHeight*_blockGridDepth;
+    if (!_isSurfaceSeedSet) {
+        blocks.reserve(numBlocks);
+        for (int idx = 0; idx < numBlocks; idx++) {
+            blocks.push_back(idx);
         }
-        vertexList[2] = edges.U(vertices[3]);
-    }
-    if (_edgeTable[cubeIndex] & 8) {
-        if (!edges.isSetW(vertices[0])) {
-            vmath::vec3 v = _vertexInterp(isolevel, vertexPositions[3], vertexPositions[0], 
-                                                     vertexValues[3],    vertexValues[0]);
-            _surface.vertices.push_back(v);
-            edges.W.set(vertices[0], _surface.vertices.size() - 1);
-            edges.isSetW.set(vertices[0], true);
+        return;
+    }
+
+    for (int k = 0; k < _blockGridDepth; k++) {
+        for (int j = 0; j < _blockGridHeight; j++) {
+            for (int i = 0; i < _blockGridWidth; i++) {
+                if (_isCandidateBlock(i, j, k)) {
+                    blocks.push_back(Grid3d::getFlatIndex(i, j, k, _blockGridWidth, 
+                                                          _blockGridHeight));
+                }
+            }
         }
-        vertexList[3] = edges.W(vertices[0]);
-    }
-    if (_edgeTable[cubeIndex] & 16) {
-        if (!edges.isSetU(vertices[4])) {
-            vmath::vec3 v = _vertexInterp(isolevel, vertexPositions[4], vertexPositions[5], 
-                                                     vertexValues[4],    vertexValues[5]);
-            _surface.vertices.push_back(v);
-            edges.U.set(vertices[4], _surface.vertices.size() - 1);
-            edges.isSetU.set(vertices[4], true);
+    }
+}
+
+/*
+    The grid is divided into blocks of cells and only blocks that contain
+    vertex values on both sides of the surface threshold are polygonized.
+*/
+void Polygonizer3d::_findSurfaceBlocks() {
+    _blockIds = Array3d<int>(_blockGridWidth, _blockGridHeight, _blockGridDepth, -1);
+    _surfaceBlocks.clear();
+
+    std::vector<int> candidateBlocks;
+    _getCandidateBlocks(candidateBlocks);
+    int numCandidates = (int)candidateBlocks.size();
+    if (numCandidates == 0) {
+        return;
+    }
+
+    Array3d<bool> isSurfaceBlock(_blockGridWidth, _blockGridHeight, _blockGridDepth, false);
+    int numthreads = _getNumThreads(numCandidates);
+    std::vector<std::thread> threads(numthreads);
+    std::vector<int> intervals = ThreadUtils::splitRangeIntoIntervals(0, numCandidates, numthreads);
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&Polygonizer3d::_findSurfaceBlocksThread, this,
+                                 intervals[i], intervals[i + 1], 
+                                 &candidateBlocks, &isSurfaceBlock);
+    }
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
+
+    GridIndex b;
+    for (int idx = 0; idx < numCandidates; idx++) {
+        b = Grid3d::getUnflattenedIndex(candidateBlocks[idx], _blockGridWidth, _blockGridHeight);
+        if (isSurfaceBlock(b)) {
+            _blockIds.set(b, (int)_surfaceBlocks.size());
+            _surfaceBlocks.push_back(SurfaceBlock(b));
         }
-        vertexList[4] = edges.U(vertices[4]);
-    }
-    if (_edgeTable[cubeIndex] & 32) {
-        if (!edges.isSetW(vertices[5])) {
-            vmath::vec3 v = _vertexInterp(isolevel, vertexPositions[5], vertexPositions[6], 
-                                                     vertexValues[5],    vertexValues[6]);
-            _surface.vertices.push_back(v);
-            edges.W.set(vertices[5], _surface.vertices.size() - 1);
-            edges.isSetW.set(vertices[5], true);
+    }
+}
+
+void Polygonizer3d::_findSurfaceBlocksThread(int startidx, int endidx, 
+                                             std::vector<int> *candidateBlocks,
+                                             Array3d<bool> *isSurfaceBlock) {
+    GridIndex b;
+    for (int idx = startidx; idx < endidx; idx++) {
+        b = Grid3d::getUnflattenedIndex(candidateBlocks->at(idx), 
+                                        _blockGridWidth, _blockGridHeight);
+        if (_isSurfaceBlock(b)) {
+            isSurfaceBlock->set(b, true);
         }
-        vertexList[5] = edges.W(vertices[5]);
-    }
-    if (_edgeTable[cubeIndex] & 64) {
-        if (!edges.isSetU(vertices[7])) {
-            vmath::vec3 v = _vertexInterp(isolevel, vertexPositions[6], vertexPositions[7], 
-                                                     vertexValues[6],    vertexValues[7]);
-            _surface.vertices.push_back(v);
-            edges.U.set(vertices[7], _surface.vertices.size() - 1);
-            edges.isSetU.set(vertices[7], true);
+    }
+}
+
+bool Polygonizer3d::_isSurfaceBlock(GridIndex b) {
+    if (_isSurfaceCellMaskSet) {
+        // Edges owned by this block may be shared with masked cells in the 
+        // neighbouring blocks at the lower boundaries
+        GridIndex cellmin, cellmax;
+        _getBlockCellBounds(b, &cellmin, &cellmax);
+        cellmin = GridIndex(std::max(cellmin.i - 1, 0), 
+                            std::max(cellmin.j - 1, 0), 
+                            std::max(cellmin.k - 1, 0));
+
+        bool isMaskSet = false;
+        for (int k = cellmin.k; k < cellmax.k && !isMaskSet; k++) {
+            for (int j = cellmin.j; j < cellmax.j && !isMaskSet; j++) {
+                for (int i = cellmin.i; i < cellmax.i; i++) {
+                    if (_surfaceCellMask->get(i, j, k)) {
+                        isMaskSet = true;
+                        break;
+                    }
+                }
+            }
         }
-        vertexList[6] = edges.U(vertices[7]);
-    }
-    if (_edgeTable[cubeIndex] & 128) {
-        if (!edges.isSetW(vertices[4])) {
-            vmath::vec3 v = _vertexInterp(isolevel, vertexPositions[7], vertexPositions[4], 
-                                                     vertexValues[7],    vertexValues[4]);
-            _surface.vertices.push_back(v);
-            edges.W.set(vertices[4], _surface.vertices.size() - 1);
-            edges.isSetW.set(vertices[4], true);
+
+        if (!isMaskSet) {
+            return false;
         }
-        vertexList[7] = edges.W(vertices[4]);
-    }
-    if (_edgeTable[cubeIndex] & 256) {
-        if (!edges.isSetV(vertices[0])) {
-            vmath::vec3 v = _vertexInterp(isolevel, vertexPositions[0], vertexPositions[4], 
-                                                     vertexValues[0],    vertexValues[4]);
-            _surface.vertices.push_back(v);
-            edges.V.set(vertices[0], _surface.vertices.size() - 1);
-            edges.isSetV.set(vertices[0], true);
+    }
+
+    GridIndex vertmin, vertmax;
+    _getBlockVertexBounds(b, &vertmin, &vertmax);
+
+    bool hasInside = false;
+    bool hasOutside = false;
+    for (int k = vertmin.k; k < vertmax.k; k++) {
+        for (int j = vertmin.j; j < vertmax.j; j++) {
+            for (int i = vertmin.i; i < vertmax.i; i++) {
+                if (_scalarField->getScalarFieldValue(i, j, k) > _surfaceThreshold) {
+                    hasInside = true;
+                } else {
+                    hasOutside = true;
+                }
+
+                if (hasInside && hasOutside) {
+                    return true;
+                }
+            }
         }
-        vertexList[8] = edges.V(vertices[0]);
-    }
-    if (_edgeTable[cubeIndex] & 512) {
-        if (!edges.isSetV(vertices[1])) {
-            vmath::vec3 v = _vertexInterp(isolevel, vertexPositions[1], vertexPositions[5], 
-                                                     vertexValues[1],    vertexValues[5]);
-            _surface.vertices.push_back(v);
-            edges.V.set(vertices[1], _surface.vertices.size() - 1);
-            edges.isSetV.set(vertices[1], true);
+    }
+
+    return false;
+}
+
+/*
+    Cell range [cellmin, cellmax) of block b.
+*/
+void Polygonizer3d::_getBlockCellBounds(GridIndex b, GridIndex *cellmin, GridIndex *cellmax) {
+    *cellmin = GridIndex(b.i*_blockSize, b.j*_blockSize, b.k*_blockSize);
+    *cellmax = GridIndex(std::min(cellmin->i + _blockSize, _isize),
+                         std::min(cellmin->j + _blockSize, _jsize),
+                         std::min(cellmin->k + _blockSize, _ksize));
+}
+
+/*
+    Range [vertmin, vertmax) of the vertices of the cells in block b.
+*/
+void Polygonizer3d::_getBlockVertexBounds(GridIndex b, GridIndex *vertmin, GridIndex *vertmax) {
+    GridIndex cellmax;
+    _getBlockCellBounds(b, vertmin, &cellmax);
+    *vertmax = GridIndex(cellmax.i + 1, cellmax.j + 1, cellmax.k + 1);
+}
+
+/*
+    Each grid vertex, along with the edges that start at the vertex, is 
+    owned by a single block. Vertices on the upper boundary of the grid
+    belong to the last block.
+*/
+GridIndex Polygonizer3d::_getVertexBlockIndex(GridIndex v) {
+    return GridIndex(std::min(v.i / _blockSize, _blockGridWidth - 1),
+                     std::min(v.j / _blockSize, _blockGridHeight - 1),
+                     std::min(v.k / _blockSize, _blockGridDepth - 1));
+}
+
+int Polygonizer3d::_getBlockEdgeIndex(GridIndex blockIndex, GridIndex v, int axis) {
+    int n = _blockSize + 1;
+    int i = v.i - blockIndex.i*_blockSize;
+    int j = v.j - blockIndex.j*_blockSize;
+    int k = v.k - blockIndex.k*_blockSize;
+    return 3*(i + n*(j + n*k)) + axis;
+}
+
+bool Polygonizer3d::_isEdgeOnSurface(GridIndex v, int axis, double isolevel) {
+    GridIndex v2 = v;
+    if (axis == 0) {
+        v2.i++;
+    } else if (axis == 1) {
+        v2.j++;
+    } else {
+        v2.k++;
+    }
+
+    if (!Grid3d::isGridIndexInRange(v2, _isize + 1, _jsize + 1, _ksize + 1)) {
+        return false;
+    }
+
+    bool isInside1 = _getVertexFieldValue(v) > isolevel;
+    bool isInside2 = _getVertexFieldValue(v2) > isolevel;
+    return isInside1 != isInside2;
+}
+
+/*
+    An edge does not need a vertex if none of the cells that share the
+    edge will be polygonized.
+*/
+bool Polygonizer3d::_isEdgeMaskedOut(GridIndex v, int axis) {
+    if (!_isSurfaceCellMaskSet) {
+        return false;
+    }
+
+    GridIndex c;
+    for (int dk = 0; dk <= 1; dk++) {
+        for (int dj = 0; dj <= 1; dj++) {
+            for (int di = 0; di <= 1; di++) {
+                if ((axis == 0 && di == 1) || (axis == 1 && dj == 1) || 
+                        (axis == 2 && dk == 1)) {
+                    continue;
+                }
+
+                c = GridIndex(v.i - di, v.j - dj, v.k - dk);
+                if (Grid3d::isGridIndexInRange(c, _isize, _jsize, _ksize) &&
+                        _surfaceCellMask->get(c)) {
+                    return false;
+                }
+            }
         }
-        vertexList[9] = edges.V(vertices[1]);
-    }
-    if (_edgeTable[cubeIndex] & 1024) {
-        if (!edges.isSetV(vertices[2])) {
-            vmath::vec3 v = _vertexInterp(isolevel, vertexPositions[2], vertexPositions[6], 
-                                                     vertexValues[2],    vertexValues[6]);
-            _surface.vertices.push_back(v);
-            edges.V.set(vertices[2], _surface.vertices.size() - 1);
-            edges.isSetV.set(vertices[2], true);
+    }
+
+    return true;
+}
+
+int Polygonizer3d::_getEdgeVertexIndex(GridIndex v, int axis) {
+    GridIndex b = _getVertexBlockIndex(v);
+    SurfaceBlock &block = _surfaceBlocks[_blockIds(b)];
+    int localIndex = block.edgeVertices[_getBlockEdgeIndex(b, v, axis)];
+    assert(localIndex != -1);
+
+    return block.vertexOffset + localIndex;
+}
+
+void Polygonizer3d::_calculateBlockVerticesThread(int startidx, int endidx) {
+    for (int i = startidx; i < endidx; i++) {
+        _calculateBlockVertices(_surfaceBlocks[i]);
+    }
+}
+
+void Polygonizer3d::_calculateBlockVertices(SurfaceBlock &block) {
+    int n = _blockSize + 1;
+    block.edgeVertices.assign(3*n*n*n, -1);
+
+    GridIndex vertmin, vertmax;
+    _getBlockVertexBounds(block.index, &vertmin, &vertmax);
+
+    GridIndex offsets[3] = { GridIndex(1, 0, 0), GridIndex(0, 1, 0), GridIndex(0, 0, 1) };
+    for (int k = vertmin.k; k < vertmax.k; k++) {
+        for (int j = vertmin.j; j < vertmax.j; j++) {
+            for (int i = vertmin.i; i < vertmax.i; i++) {
+                GridIndex v(i, j, k);
+                if (_getVertexBlockIndex(v) != block.index) {
+                    continue;
+                }
+
+                for (int axis = 0; axis < 3; axis++) {
+                    if (!_isEdgeOnSurface(v, axis, _surfaceThreshold) || 
+                            _isEdgeMaskedOut(v, axis)) {
+                        continue;
+                    }
+
+                    GridIndex v2(v.i + offsets[axis].i, 
+                                 v.j + offsets[axis].j, 
+                                 v.k + offsets[axis].k);
+                    vmath::vec3 p = _vertexInterp(_surfaceThreshold, 
+                                                  _getVertexPosition(v), 
+                                                  _getVertexPosition(v2),
+                                                  _getVertexFieldValue(v),
+                                                  _getVertexFieldValue(v2));
+
+                    int edgeIndex = _getBlockEdgeIndex(block.index, v, axis);
+                    block.edgeVertices[edgeIndex] = (int)block.vertices.size();
+                    block.vertices.push_back(p);
+                }
+            }
         }
-        vertexList[10] = edges.V(vertices[2]);
-    }
-    if (_edgeTable[cubeIndex] & 2048) {
-        if (!edges.isSetV(vertices[3])) {
-            vmath::vec3 v = _vertexInterp(isolevel, vertexPositions[3], vertexPositions[7], 
-                                                     vertexValues[3],    vertexValues[7]);
-            _surface.vertices.push_back(v);
-            edges.V.set(vertices[3], _surface.vertices.size() - 1);
-            edges.isSetV.set(vertices[3], true);
+    }
+}
+
+void Polygonizer3d::_calculateBlockTrianglesThread(int startidx, int endidx) {
+    for (int i = startidx; i < endidx; i++) {
+        _calculateBlockTriangles(_surfaceBlocks[i]);
+    }
+}
+
+void Polygonizer3d::_calculateBlockTriangles(SurfaceBlock &block) {
+    GridIndex cellmin, cellmax;
+    _getBlockCellBounds(block.index, &cellmin, &cellmax);
+
+    for (int k = cellmin.k; k < cellmax.k; k++) {
+        for (int j = cellmin.j; j < cellmax.j; j++) {
+            for (int i = cellmin.i; i < cellmax.i; i++) {
+                GridIndex cell(i, j, k);
+                if (_isSurfaceCellMaskSet && !_surfaceCellMask->get(cell)) {
+                    continue;
+                }
+
+                _polygonizeCell(cell, _surfaceThreshold, block.triangles);
+            }
         }
-        vertexList[11] = edges.V(vertices[3]);
     }
 }
 
-// method of polygonizing a cell is adapted from:
-// http://paulbourke.net/geometry/polygonise/
-void Polygonizer3d::_polygonizeCell(GridIndex g, double isolevel, EdgeGrid &edges) {
-    int cubeIndex = _calculateCubeIndex(g, isolevel);
+/*
+    Vertices are computed once for each edge that crosses the surface by 
+    the block that owns the edge, so the surface is welded without any
+    duplicate vertices. Triangles are computed after the vertices of all
+    blocks have been assigned their final indices.
+*/
+void Polygonizer3d::_calculateSurfaceTriangles() {
+    _surface.clear();
 
-    /* Cube is entirely in/out of the surface */
-    if (_edgeTable[cubeIndex] == 0) {
+    int numBlocks = (int)_surfaceBlocks.size();
+    if (numBlocks == 0) {
         return;
     }
 
-    int vertexList[12];
-    _calculateVertexList(g, isolevel, cubeIndex, vertexList, edges);
+    int numthreads = _getNumThreads(numBlocks);
+    std::vector<std::thread> threads(numthreads);
+    std::vector<int> intervals = ThreadUtils::splitRangeIntoIntervals(0, numBlocks, numthreads);
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&Polygonizer3d::_calculateBlockVerticesThread, this,
+                                 intervals[i], intervals[i + 1]);
+    }
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
 
-    for (int i = 0; _triTable[cubeIndex][i] != -1; i += 3) {
-        Triangle t = Triangle(vertexList[_triTable[cubeIndex][i]],
-                              vertexList[_triTable[cubeIndex][i + 1]],
-                              vertexList[_triTable[cubeIndex][i + 2]]);
+    int numVertices = 0;
+    for (int i = 0; i < numBlocks; i++) {
+        _surfaceBlocks[i].vertexOffset = numVertices;
+        numVertices += (int)_surfaceBlocks[i].vertices.size();
+    }
+
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&Polygonizer3d::_calculateBlockTrianglesThread, this,
+                                 intervals[i], intervals[i + 1]);
+    }
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
+
+    int numTriangles = 0;
+    for (int i = 0; i < numBlocks; i++) {
+        numTriangles += (int)_surfaceBlocks[i].triangles.size();
+    }
 
-        _surface.triangles.push_back(t);
+    _surface.vertices.reserve(numVertices);
+    _surface.triangles.reserve(numTriangles);
+    for (int i = 0; i < numBlocks; i++) {
+        SurfaceBlock &block = _surfaceBlocks[i];
+        _surface.vertices.insert(_surface.vertices.end(), 
+                                 block.vertices.begin(), block.vertices.end());
+        _surface.triangles.insert(_surface.triangles.end(), 
+                                  block.triangles.begin(), block.triangles.end());
     }
+
+    _surfaceBlocks.clear();
+    _surfaceBlocks.shrink_to_fit();
 }
 
-void Polygonizer3d::_calculateSurfaceTriangles() {
-    _surface.clear();
-    EdgeGrid edges(_isize, _jsize, _ksize);
-    for (unsigned int i = 0; i < _surfaceCells.size(); i++) {
-        _polygonizeCell(_surfaceCells[i], _surfaceThreshold, edges);
+int Polygonizer3d::_getNumThreads(int numItems) {
+    int numthreads = _maxThreadCount;
+    if (numthreads < 1) {
+        numthreads = ThreadUtils::getMaxThreadCount();
     }
+    return (int)fmin(numthreads, numItems);
 }
 
 void Polygonizer3d::setSurfaceCellMask(Array3d<bool> *mask) {
@@ -671,10 +876,51 @@ void Polygonizer3d::setSurfaceCellMask(Array3d<bool> *mask) {
     _isSurfaceCellMaskSet = true;
 }
 
+/*
+    Marks every block that shares a vertex within radius of p. A vertex that
+    lies on a block boundary is shared by the blocks on both sides.
+*/
+void Polygonizer3d::addSurfaceSeedPoint(vmath::vec3 p, double radius) {
+    _isSurfaceSeedSet = true;
+
+    p -= _scalarField->getOffset();
+    int vmin[3], vmax[3];
+    int vsize[3] = {_isize, _jsize, _ksize};
+    for (int axis = 0; axis < 3; axis++) {
+        vmin[axis] = (int)fmax(ceil((p[axis] - radius) / _dx), 0);
+        vmax[axis] = (int)fmin(floor((p[axis] + radius) / _dx), vsize[axis]);
+        if (vmin[axis] > vmax[axis]) {
+            return;
+        }
+    }
+
+    GridIndex bmin((int)fmax((vmin[0] + _blockSize - 1) / _blockSize - 1, 0),
+                   (int)fmax((vmin[1] + _blockSize - 1) / _blockSize - 1, 0),
+                   (int)fmax((vmin[2] + _blockSize - 1) / _blockSize - 1, 0));
+    GridIndex bmax((int)fmin(vmax[0] / _blockSize, _blockGridWidth - 1),
+                   (int)fmin(vmax[1] / _blockSize, _blockGridHeight - 1),
+                   (int)fmin(vmax[2] / _blockSize, _blockGridDepth - 1));
+    for (int k = bmin.k; k <= bmax.k; k++) {
+        for (int j = bmin.j; j <= bmax.j; j++) {
+            for (int i = bmin.i; i <= bmax.i; i++) {
+                _isCandidateBlock.set(i, j, k, true);
+            }
+        }
+    }
+}
+
+/*
+    Limit the number of threads used to polygonize the surface. A value less
+    than one will use the ThreadUtils maximum thread count.
+*/
+void Polygonizer3d::setMaxThreadCount(int n) {
+    _maxThreadCount = n;
+}
+
 void Polygonizer3d::polygonizeSurface() {
     assert(_isScalarFieldSet);
 
-    _surfaceCells = _findSurfaceCells();
+    _findSurfaceBlocks();
     _calculateSurfaceTriangles();
     _surface.updateVertexNormals();
 }
\ No newline at end of file
@@ -27,6 +27,7 @@ freely, subject to the following restrictions:
 #include <sstream>
 #include <fstream>
 #include <assert.h>
+#include <thread>
 
 #include "implicitsurfacescalarfield.h"
 #include "array3d.h"
@@ -35,6 +36,7 @@ freely, subject to the following restrictions:
 #include "vmath.h"
 #include "gridindexvector.h"
 #include "stopwatch.h"
+#include "threadutils.h"
 
 class Polygonizer3d
 {
@@ -45,34 +47,34 @@ public:
     ~Polygonizer3d();
 
     void setSurfaceCellMask(Array3d<bool> *mask);
+
+    /*
+        Seed points bound the region that is searched for the surface. The
+        scalar field must not exceed the surface threshold at vertices 
+        farther than radius from every seed point, as is the case for the
+        particles that the field was computed from. Once a seed point has
+        been added, only the blocks within radius of a seed point are tested
+        for the surface instead of every block in the grid.
+    */
+    void addSurfaceSeedPoint(vmath::vec3 p, double radius);
+    void setMaxThreadCount(int n);
     void polygonizeSurface();
     
     TriangleMesh getTriangleMesh() { return _surface; };
     void writeSurfaceToOBJ(std::string filename);
 
 private:
-    struct EdgeGrid {
-        Array3d<int> U;         // store index to vertex
-        Array3d<int> V;
-        Array3d<int> W;
-        Array3d<bool> isSetU;
-        Array3d<bool> isSetV;
-        Array3d<bool> isSetW;
-
-        EdgeGrid() : U(Array3d<int>(0, 0, 0)),
-                     V(Array3d<int>(0, 0, 0)),
-                     W(Array3d<int>(0, 0, 0)),
-                     isSetU(Array3d<bool>(0, 0, 0)),
-                     isSetV(Array3d<bool>(0, 0, 0)), 
-                     isSetW(Array3d<bool>(0, 0, 0)) {}
-
-        EdgeGrid(int i, int j, int k) : 
-                     U(Array3d<int>(i, j + 1, k + 1)),
-                     V(Array3d<int>(i + 1, j, k + 1)),
-                     W(Array3d<int>(i + 1, j + 1, k)),
-                     isSetU(Array3d<bool>(i, j + 1, k + 1, false)),
-                     isSetV(Array3d<bool>(i + 1, j, k + 1, false)),
-                     isSetW(Array3d<bool>(i + 1, j + 1, k, false)) {}
+    struct SurfaceBlock {
+        GridIndex index;
+        std::vector<vmath::vec3> vertices;
+        std::vector<Triangle> triangles;
+
+        // Local vertex index of each edge owned by the block, or -1
+        std::vector<int> edgeVertices;
+        int vertexOffset = 0;
+
+        SurfaceBlock() {}
+        SurfaceBlock(GridIndex g) : index(g) {}
     };
 
     void _getCellVertexPositions(GridIndex g, vmath::vec3 positions[8]);
@@ -82,16 +84,34 @@ private:
     bool _isCellInsideSurface(GridIndex g);
     bool _isCellOnSurface(GridIndex g);
     int _getCellSurfaceStatus(GridIndex g);
-    void _polygonizeCell(GridIndex g, double isolevel, EdgeGrid &edges);
+    void _polygonizeCell(GridIndex g, double isolevel, std::vector<Triangle> &triangles);
     int _calculateCubeIndex(GridIndex g, double isolevel);
-    void _calculateVertexList(GridIndex g, double isolevel, int cubeIndex, int vertList[12], EdgeGrid &edges);
     vmath::vec3 _vertexInterp(double isolevel, vmath::vec3 p1, vmath::vec3 p2, double valp1, double valp2);
-    void _calculateSurfaceTriangles();
 
-    GridIndexVector _findSurfaceCells();
+    void _initializeBlockGrid();
+    void _getCandidateBlocks(std::vector<int> &blocks);
+    void _findSurfaceBlocks();
+    void _findSurfaceBlocksThread(int startidx, int endidx, 
+                                  std::vector<int> *candidateBlocks,
+                                  Array3d<bool> *isSurfaceBlock);
+    bool _isSurfaceBlock(GridIndex b);
+    void _getBlockCellBounds(GridIndex b, GridIndex *cellmin, GridIndex *cellmax);
+    void _getBlockVertexBounds(GridIndex b, GridIndex *vertmin, GridIndex *vertmax);
+    GridIndex _getVertexBlockIndex(GridIndex v);
+    int _getBlockEdgeIndex(GridIndex blockIndex, GridIndex v, int axis);
+    bool _isEdgeOnSurface(GridIndex v, int axis, double isolevel);
+    bool _isEdgeMaskedOut(GridIndex v, int axis);
+    int _getEdgeVertexIndex(GridIndex v, int axis);
+    void _calculateBlockVerticesThread(int startidx, int endidx);
+    void _calculateBlockVertices(SurfaceBlock &block);
+    void _calculateBlockTrianglesThread(int startidx, int endidx);
+    void _calculateBlockTriangles(SurfaceBlock &block);
+    void _calculateSurfaceTriangles();
+    int _getNumThreads(int numItems);
 
     static const int _edgeTable[256];
     static const int _triTable[256][16];
+    static const int _edgeVertexAxis[12][2];
 
     int _isize = 0;
     int _jsize = 0;
@@ -105,7 +125,16 @@ private:
     Array3d<bool> *_surfaceCellMask;
     bool _isSurfaceCellMaskSet = false;
 
-    GridIndexVector _surfaceCells;
+    int _blockSize = 8;
+    int _blockGridWidth = 0;
+    int _blockGridHeight = 0;
+    int _blockGridDepth = 0;
+    Array3d<int> _blockIds;
+    Array3d<bool> _isCandidateBlock;
+    bool _isSurfaceSeedSet = false;
+    std::vector<SurfaceBlock> _surfaceBlocks;
+    int _maxThreadCount = 0;
+
     TriangleMesh _surface;
 };
 
@@ -81,26 +81,82 @@ double VectorXd::absMaxCoeff() {
 }
 
 /********************************************************************************
-    MatrixCoefficients
+    VectorXf
 ********************************************************************************/
 
-MatrixCoefficients::MatrixCoefficients() {
+VectorXf::VectorXf() {
 }
 
-MatrixCoefficients::MatrixCoefficients(int size) : cells(size, MatrixCell()) {
+VectorXf::VectorXf(int size) : _vector(size, 0.0f) {
 }
 
-MatrixCoefficients::~MatrixCoefficients() {
+VectorXf::VectorXf(int size, float fill) : _vector(size, fill) {
+}
+
+VectorXf::VectorXf(VectorXf &vector) : _vector(vector._vector) {
+}
+
+VectorXf::~VectorXf() {
+}
+
+const float VectorXf::operator[](int i) const {
+    assert(i >= 0 && i < (int)_vector.size());
+    return _vector[i];
 }
 
-const MatrixCell MatrixCoefficients::operator[](int i) const {
-    assert(i >= 0 && i < (int)cells.size());
-    return cells[i];
+float& VectorXf::operator[](int i) {
+    assert(i >= 0 && i < (int)_vector.size());
+    return _vector[i];
 }
 
-MatrixCell& MatrixCoefficients::operator[](int i) {
-    assert(i >= 0 && i < (int)cells.size());
-    return cells[i];
+void VectorXf::fill(float fill) {
+    for (unsigned int i = 0; i < _vector.size(); i++) {
+        _vector[i] = fill;
+    }
+}
+
+double VectorXf::dot(VectorXf &vector) {
+    assert(_vector.size() == vector._vector.size());
+
+    double sum = 0.0;
+    for (unsigned int i = 0; i < _vector.size(); i++) {
+        sum += (double)_vector[i] * (double)vector._vector[i];
+    }
+
+    return sum;
+}
+
+double VectorXf::absMaxCoeff() {
+    double max = -std::numeric_limits<double>::infinity();
+    for (unsigned int i = 0; i < _vector.size(); i++) {
+        if (fabs(_vector[i]) > max) {
+            max = fabs(_vector[i]);
+        }
+    }
+
+    return max;
+}
+
+/********************************************************************************
+    MatrixCoefficients
+********************************************************************************/
+
+MatrixCoefficients::MatrixCoefficients() {
+}
+
+MatrixCoefficients::MatrixCoefficients(int size) : diag(size, 0x00),
+                                                   plusi(size, 0x00),
+                                                   plusj(size, 0x00),
+                                                   plusk(size, 0x00),
+                                                   iminus(size, -1),
+                                                   iplus(size, -1),
+                                                   jminus(size, -1),
+                                                   jplus(size, -1),
+                                                   kminus(size, -1),
+                                                   kplus(size, -1) {
+}
+
+MatrixCoefficients::~MatrixCoefficients() {
 }
 
 /********************************************************************************
@@ -119,7 +175,7 @@ void PressureSolver::solve(PressureSolverParameters params, VectorXd &pressure)
     assert(pressure.size() == (unsigned int)_matSize);
     pressure.fill(0.0);
 
-	_initializeGridIndexKeyMap();
+	_initializeSystemCells();
 
 	VectorXd b(_matSize);
 	_calculateNegativeDivergenceVector(b);
@@ -130,10 +186,59 @@ void PressureSolver::solve(PressureSolverParameters params, VectorXd &pressure)
     MatrixCoefficients A(_matSize);
     _calculateMatrixCoefficients(A);
 
-    VectorXd precon(_matSize);
-    _calculatePreconditionerVector(A, precon);
+    StopWatch solveTimer;
+    solveTimer.start();
+
+    bool isParallel = _isParallelSolveEnabled();
+    VectorXd systemPressure(_matSize);
+    if (_initialPressure != nullptr) {
+        assert(_initialPressure->size() == (unsigned int)_matSize);
+        for (int vidx = 0; vidx < _matSize; vidx++) {
+            int idx = _systemToFluidCellIndex[vidx];
+            systemPressure._vector[vidx] = _initialPressure->_vector[idx];
+        }
+    }
+    if (_preconditioner == PressurePreconditioner::multigrid) {
+        double scale = _deltaTime / (_density*_dx*_dx);
+        _multigrid.initialize(_materialGrid, &_systemCells, scale);
+    } else if (isParallel) {
+        _initializeLevelSchedule();
+    }
+
+    if (_isMixedPrecisionEnabled) {
+        _solvePressureSystemMixedPrecision(A, b, systemPressure);
+    } else {
+        VectorXd precon(_matSize);
+        _calculatePreconditionerVector(A, precon);
+        _solvePressureSystem(A, b, precon, systemPressure);
+    }
+
+    solveTimer.stop();
+
+    for (int vidx = 0; vidx < _matSize; vidx++) {
+        pressure._vector[_systemToFluidCellIndex[vidx]] = systemPressure._vector[vidx];
+    }
 
-    _solvePressureSystem(A, b, precon, pressure);
+    std::ostringstream solverType;
+    if (isParallel) {
+        solverType << "parallel (" << _numThreads << " threads)";
+    } else {
+        solverType << "serial";
+    }
+    if (_preconditioner == PressurePreconditioner::multigrid) {
+        solverType << ", multigrid preconditioner (" << 
+                      _multigrid.getNumLevels() << " levels)";
+    } else {
+        solverType << ", MIC(0) preconditioner";
+    }
+    if (_isMixedPrecisionEnabled) {
+        solverType << ", mixed precision";
+    }
+    _logfile->log("CG Solver: ", solverType.str(), 1);
+
+    std::string initialGuess = _initialPressure != nullptr ? "previous pressure" : "zero";
+    _logfile->log("CG Initial Guess: ", initialGuess, 1);
+    _logfile->log("CG Solve Time: ", solveTimer.getTime(), 4, 1);
 }
 
 void PressureSolver::_initialize(PressureSolverParameters params) {
@@ -143,46 +248,78 @@ void PressureSolver::_initialize(PressureSolverParameters params) {
 	_dx = params.cellwidth;
 	_density = params.density;
 	_deltaTime = params.deltaTime;
+    _preconditioner = params.preconditioner;
+    _initialPressure = params.initialPressure;
+    _isMixedPrecisionEnabled = params.isMixedPrecisionEnabled;
 	_fluidCells = params.fluidCells;
 	_materialGrid = params.materialGrid;
 	_vField = params.velocityField;
     _logfile = params.logfile;
 	_matSize = _fluidCells->size();
-
+    _numThreads = ThreadUtils::getMaxThreadCount();
 
 }
 
-void PressureSolver::_initializeGridIndexKeyMap() {
-	_keymap = GridIndexKeyMap(_isize, _jsize, _ksize);
-	for (unsigned int idx = 0; idx < _fluidCells->size(); idx++) {
-		_keymap.insert(_fluidCells->at(idx), idx);
-	}
+/*
+    Orders the fluid cells into blocks of _cellBlockWidth^3 cells. Blocks,
+    and the cells within a block, are ordered by flat index with i varying
+    fastest and k slowest.
+    A cell's -i, -j, -k neighbours always precede it in this ordering, as 
+    required by the preconditioner.
+*/
+void PressureSolver::_initializeSystemCells() {
+    int bw = _cellBlockWidth;
+    int bisize = (_isize + bw - 1) / bw;
+    int bjsize = (_jsize + bw - 1) / bw;
+    long long gridsize = (long long)_isize*(long long)_jsize*(long long)_ksize;
+
+    std::vector<std::pair<long long, int> > keys;
+    keys.reserve(_matSize);
+    GridIndex g;
+    for (int idx = 0; idx < _matSize; idx++) {
+        g = _fluidCells->at(idx);
+        long long blockidx = (g.i / bw) + bisize*((g.j / bw) + bjsize*(g.k / bw));
+        long long key = blockidx*gridsize + _fluidCells->getFlatIndex(idx);
+        keys.push_back(std::pair<long long, int>(key, idx));
+    }
+    std::sort(keys.begin(), keys.end());
+
+    _systemCells = GridIndexVector(_isize, _jsize, _ksize);
+    _systemCells.reserve(_matSize);
+    _systemToFluidCellIndex = std::vector<int>(_matSize);
+    for (int vidx = 0; vidx < _matSize; vidx++) {
+        int idx = keys[vidx].second;
+        _systemCells.push_back(_fluidCells->at(idx));
+        _systemToFluidCellIndex[vidx] = idx;
+    }
 }
 
 void PressureSolver::_calculateNegativeDivergenceVector(VectorXd &b) {
 
 	double scale = 1.0f / (float)_dx;
-    for (unsigned int idx = 0; idx < _fluidCells->size(); idx++) {
-        int i = _fluidCells->at(idx).i;
-        int j = _fluidCells->at(idx).j;
-        int k = _fluidCells->at(idx).k;
+    GridIndex g;
+    for (int vidx = 0; vidx < _matSize; vidx++) {
+        g = _VectorToGridIndex(vidx);
+        int i = g.i;
+        int j = g.j;
+        int k = g.k;
 
         double value = -scale * (double)(_vField->U(i + 1, j, k) - _vField->U(i, j, k) +
                                          _vField->V(i, j + 1, k) - _vField->V(i, j, k) +
                                          _vField->W(i, j, k + 1) - _vField->W(i, j, k));
         
-        b[_GridToVectorIndex(i, j, k)] = value;
+        b[vidx] = value;
     }
 
     // No functionality for moving solid cells, so velocity is 0
     float usolid = 0.0;
     float vsolid = 0.0;
     float wsolid = 0.0;
-    for (unsigned int idx = 0; idx < _fluidCells->size(); idx++) {
-        int i = _fluidCells->at(idx).i;
-        int j = _fluidCells->at(idx).j;
-        int k = _fluidCells->at(idx).k;
-        int vidx = _GridToVectorIndex(i, j, k);
+    for (int vidx = 0; vidx < _matSize; vidx++) {
+        g = _VectorToGridIndex(vidx);
+        int i = g.i;
+        int j = g.j;
+        int k = g.k;
 
         if (_materialGrid->isCellSolid(i-1, j, k)) {
             b[vidx] -= (float)scale*(_vField->U(i, j, k) - usolid);
@@ -220,213 +357,285 @@ int PressureSolver::_getNumFluidOrAirCellNeighbours(int i, int j, int k) {
 }
 
 void PressureSolver::_calculateMatrixCoefficients(MatrixCoefficients &A) {
-    for (unsigned int idx = 0; idx < _fluidCells->size(); idx++) {
-        int i = _fluidCells->at(idx).i;
-        int j = _fluidCells->at(idx).j;
-        int k = _fluidCells->at(idx).k;
-        int vidx = _GridToVectorIndex(i, j, k);
-
-        int n = _getNumFluidOrAirCellNeighbours(i, j, k);
-        A.cells[vidx].diag = (char)n;
+    _calculateNeighbourIndices(A);
+
+    GridIndex g;
+    for (int vidx = 0; vidx < _matSize; vidx++) {
+        g = _VectorToGridIndex(vidx);
+        A.diag[vidx] = (char)_getNumFluidOrAirCellNeighbours(g.i, g.j, g.k);
+        A.plusi[vidx] = A.iplus[vidx] != -1 ? 0x01 : 0x00;
+        A.plusj[vidx] = A.jplus[vidx] != -1 ? 0x01 : 0x00;
+        A.plusk[vidx] = A.kplus[vidx] != -1 ? 0x01 : 0x00;
+    }
+}
 
-        if (_materialGrid->isCellFluid(i + 1, j, k)) {
-            A.cells[vidx].plusi = 0x01;
+/*
+    Neighbour indices are found by scanning a copy of the system cells sorted
+    by flat grid index. For a fixed offset, the flat index of a cell's 
+    neighbour increases with the flat index of the cell, so each direction 
+    is resolved in a single linear pass without an index map over the full 
+    grid domain.
+*/
+void PressureSolver::_calculateNeighbourIndices(MatrixCoefficients &A) {
+    std::vector<std::pair<int, int> > sortedCells;
+    sortedCells.reserve(_matSize);
+    for (int vidx = 0; vidx < _matSize; vidx++) {
+        int flatidx = (int)_systemCells.getFlatIndex(vidx);
+        sortedCells.push_back(std::pair<int, int>(flatidx, vidx));
+    }
+    std::sort(sortedCells.begin(), sortedCells.end());
+
+    int slice = _isize*_jsize;
+    int offsets[6] = {-1, 1, -_isize, _isize, -slice, slice};
+    GridIndex directions[6] = {GridIndex(-1, 0, 0), GridIndex(1, 0, 0),
+                               GridIndex(0, -1, 0), GridIndex(0, 1, 0),
+                               GridIndex(0, 0, -1), GridIndex(0, 0, 1)};
+    std::vector<int> *neighbours[6] = {&(A.iminus), &(A.iplus),
+                                       &(A.jminus), &(A.jplus),
+                                       &(A.kminus), &(A.kplus)};
+
+    for (int dir = 0; dir < 6; dir++) {
+        std::vector<int> &nbs = *(neighbours[dir]);
+        GridIndex d = directions[dir];
+        int q = 0;
+        for (int p = 0; p < _matSize; p++) {
+            int flatidx = sortedCells[p].first;
+            int i = flatidx % _isize + d.i;
+            int j = (flatidx / _isize) % _jsize + d.j;
+            int k = flatidx / slice + d.k;
+            if (!Grid3d::isGridIndexInRange(i, j, k, _isize, _jsize, _ksize)) {
+                nbs[sortedCells[p].second] = -1;
+                continue;
+            }
+
+            int target = flatidx + offsets[dir];
+            while (q < _matSize && sortedCells[q].first < target) {
+                q++;
+            }
+
+            if (q < _matSize && sortedCells[q].first == target) {
+                nbs[sortedCells[p].second] = sortedCells[q].second;
+            } else {
+                nbs[sortedCells[p].second] = -1;
+            }
         }
+    }
+}
 
-        if (_materialGrid->isCellFluid(i, j + 1, k)) {
-            A.cells[vidx].plusj = 0x01;
-        }
+/*
+    The preconditioner vector is only used by MIC(0). The multigrid 
+    preconditioner is initialized separately.
+*/
+template <class T>
+void PressureSolver::_calculatePreconditionerVector(MatrixCoefficients &A, T &precon) {
+    if (_preconditioner == PressurePreconditioner::multigrid) {
+        return;
+    }
 
-        if (_materialGrid->isCellFluid(i, j, k + 1)) {
-            A.cells[vidx].plusk = 0x01;
-        }
+    if (_isParallelSolveEnabled()) {
+        _calculatePreconditionerVectorParallel(A, precon);
+    } else {
+        _calculatePreconditionerVectorSerial(A, precon);
     }
 }
 
-void PressureSolver::_calculatePreconditionerVector(MatrixCoefficients &A, VectorXd &precon) {
+template <class T>
+void PressureSolver::_calculatePreconditionerVectorSerial(MatrixCoefficients &A, T &precon) {
     assert(A.size() == precon.size());
 
     double scale = _deltaTime / (_density*_dx*_dx);
+    for (int vidx = 0; vidx < _matSize; vidx++) {
+        _calculatePreconditionerCell(A, precon, vidx, scale);
+    }
+}
+
+template <class T>
+void PressureSolver::_calculatePreconditionerCell(MatrixCoefficients &A, 
+                                                  T &precon, 
+                                                  int vidx, double scale) {
     double negscale = -scale;
 
     double tau = 0.97;      // Tuning constant
     double sigma = 0.25;    // safety constant
-    for (unsigned int idx = 0; idx < _fluidCells->size(); idx++) {
-        int i = _fluidCells->at(idx).i;
-        int j = _fluidCells->at(idx).j;
-        int k = _fluidCells->at(idx).k;
-        int vidx = _GridToVectorIndex(i, j, k);
-
-        int vidx_im1 = _keymap.find(i - 1, j, k);
-        int vidx_jm1 = _keymap.find(i, j - 1, k);
-        int vidx_km1 = _keymap.find(i, j, k - 1);
-
-        double diag = (double)A[vidx].diag*scale;
-
-        double plusi_im1 = vidx_im1 != -1 ? (double)A[vidx_im1].plusi * negscale : 0.0;
-        double plusi_jm1 = vidx_jm1 != -1 ? (double)A[vidx_jm1].plusi * negscale : 0.0;
-        double plusi_km1 = vidx_km1 != -1 ? (double)A[vidx_km1].plusi * negscale : 0.0;
-
-        double plusj_im1 = vidx_im1 != -1 ? (double)A[vidx_im1].plusj * negscale : 0.0;
-        double plusj_jm1 = vidx_jm1 != -1 ? (double)A[vidx_jm1].plusj * negscale : 0.0;
-        double plusj_km1 = vidx_km1 != -1 ? (double)A[vidx_km1].plusj * negscale : 0.0;
-
-        double plusk_im1 = vidx_im1 != -1 ? (double)A[vidx_im1].plusk * negscale : 0.0;
-        double plusk_jm1 = vidx_jm1 != -1 ? (double)A[vidx_jm1].plusk * negscale : 0.0;
-        double plusk_km1 = vidx_km1 != -1 ? (double)A[vidx_km1].plusk * negscale : 0.0;
-
-        double precon_im1 = vidx_im1 != -1 ? precon[vidx_im1] : 0.0;
-        double precon_jm1 = vidx_jm1 != -1 ? precon[vidx_jm1] : 0.0;
-        double precon_km1 = vidx_km1 != -1 ? precon[vidx_km1] : 0.0;
-
-        double v1 = plusi_im1 * precon_im1;
-        double v2 = plusj_jm1 * precon_jm1;
-        double v3 = plusk_km1 * precon_km1;
-        double v4 = precon_im1 * precon_im1;
-        double v5 = precon_jm1 * precon_jm1;
-        double v6 = precon_km1 * precon_km1;
-        
-        double e = diag - v1*v1 - v2*v2 - v3*v3 - 
-            tau*(plusi_im1*(plusj_im1 + plusk_im1)*v4 +
-                 plusj_jm1*(plusi_jm1 + plusk_jm1)*v5 +
-                 plusk_km1*(plusi_km1 + plusj_km1)*v6);
 
-        if (e < sigma*diag) {
-            e = diag;
-        }
+    int vidx_im1 = A.iminus[vidx];
+    int vidx_jm1 = A.jminus[vidx];
+    int vidx_km1 = A.kminus[vidx];
+
+    double diag = (double)A.diag[vidx]*scale;
+
+    double plusi_im1 = vidx_im1 != -1 ? (double)A.plusi[vidx_im1] * negscale : 0.0;
+    double plusi_jm1 = vidx_jm1 != -1 ? (double)A.plusi[vidx_jm1] * negscale : 0.0;
+    double plusi_km1 = vidx_km1 != -1 ? (double)A.plusi[vidx_km1] * negscale : 0.0;
+
+    double plusj_im1 = vidx_im1 != -1 ? (double)A.plusj[vidx_im1] * negscale : 0.0;
+    double plusj_jm1 = vidx_jm1 != -1 ? (double)A.plusj[vidx_jm1] * negscale : 0.0;
+    double plusj_km1 = vidx_km1 != -1 ? (double)A.plusj[vidx_km1] * negscale : 0.0;
+
+    double plusk_im1 = vidx_im1 != -1 ? (double)A.plusk[vidx_im1] * negscale : 0.0;
+    double plusk_jm1 = vidx_jm1 != -1 ? (double)A.plusk[vidx_jm1] * negscale : 0.0;
+    double plusk_km1 = vidx_km1 != -1 ? (double)A.plusk[vidx_km1] * negscale : 0.0;
+
+    double precon_im1 = vidx_im1 != -1 ? (double)precon[vidx_im1] : 0.0;
+    double precon_jm1 = vidx_jm1 != -1 ? (double)precon[vidx_jm1] : 0.0;
+    double precon_km1 = vidx_km1 != -1 ? (double)precon[vidx_km1] : 0.0;
+
+    double v1 = plusi_im1 * precon_im1;
+    double v2 = plusj_jm1 * precon_jm1;
+    double v3 = plusk_km1 * precon_km1;
+    double v4 = precon_im1 * precon_im1;
+    double v5 = precon_jm1 * precon_jm1;
+    double v6 = precon_km1 * precon_km1;
+    
+    double e = diag - v1*v1 - v2*v2 - v3*v3 - 
+        tau*(plusi_im1*(plusj_im1 + plusk_im1)*v4 +
+             plusj_jm1*(plusi_jm1 + plusk_jm1)*v5 +
+             plusk_km1*(plusi_km1 + plusj_km1)*v6);
+
+    if (e < sigma*diag) {
+        e = diag;
+    }
 
-        if (fabs(e) > 10e-9) {
-            precon[vidx] = 1.0 / sqrt(e);
-        }
+    if (fabs(e) > 10e-9) {
+        precon[vidx] = 1.0 / sqrt(e);
     }
 }
 
+template <class T>
 void PressureSolver::_applyPreconditioner(MatrixCoefficients &A, 
-                                          VectorXd &precon,
-                                          VectorXd &residual,
-                                          VectorXd &vect) {
+                                          T &precon,
+                                          T &residual,
+                                          T &vect) {
+
+    if (_preconditioner == PressurePreconditioner::multigrid) {
+        _multigrid.apply(residual._vector, vect._vector);
+        return;
+    }
 
     double scale = _deltaTime / (_density*_dx*_dx);
-    double negscale = -scale;
 
     // Solve A*q = residual
-    VectorXd q(_matSize);
-    for (unsigned int idx = 0; idx < _fluidCells->size(); idx++) {
-        int i = _fluidCells->at(idx).i;
-        int j = _fluidCells->at(idx).j;
-        int k = _fluidCells->at(idx).k;
-        int vidx = _GridToVectorIndex(i, j, k);
-
-        int vidx_im1 = _keymap.find(i - 1, j, k);
-        int vidx_jm1 = _keymap.find(i, j - 1, k);
-        int vidx_km1 = _keymap.find(i, j, k - 1);
-
-        double plusi_im1 = 0.0;
-        double precon_im1 = 0.0;
-        double q_im1 = 0.0;
-        if (vidx_im1 != -1) {
-            plusi_im1  = (double)A[vidx_im1].plusi * negscale;
-            precon_im1 = precon[vidx_im1];
-            q_im1      = q[vidx_im1];
-        }
-
-        double plusj_jm1 = 0.0;
-        double precon_jm1 = 0.0;
-        double q_jm1 = 0.0;
-        if (vidx_jm1 != -1) {
-            plusj_jm1  = (double)A[vidx_jm1].plusj * negscale;
-            precon_jm1 = precon[vidx_jm1];
-            q_jm1      = q[vidx_jm1];
-        }
-
-        double plusk_km1 = 0.0;
-        double precon_km1 = 0.0;
-        double q_km1 = 0.0;
-        if (vidx_km1 != -1) {
-            plusk_km1  = (double)A[vidx_km1].plusk * negscale;
-            precon_km1 = precon[vidx_km1];
-            q_km1      = q[vidx_km1];
-        }
-
-        double t = residual[vidx] - plusi_im1 * precon_im1 * q_im1 -
-                                    plusj_jm1 * precon_jm1 * q_jm1 -
-                                    plusk_km1 * precon_km1 * q_km1;
-
-        t = t*precon[vidx];
-        q[vidx] = t;
+    T q(_matSize);
+    for (int vidx = 0; vidx < _matSize; vidx++) {
+        _forwardSubstitutionCell(A, precon, residual, q, vidx, scale);
     }
 
     // Solve transpose(A)*z = q
-    for (int idx = (int)_fluidCells->size() - 1; idx >= 0; idx--) {
-        int i = _fluidCells->at(idx).i;
-        int j = _fluidCells->at(idx).j;
-        int k = _fluidCells->at(idx).k;
-        int vidx = _GridToVectorIndex(i, j, k);
-
-        int vidx_ip1 = _keymap.find(i + 1, j, k);
-        int vidx_jp1 = _keymap.find(i, j + 1, k);
-        int vidx_kp1 = _keymap.find(i, j, k + 1);
-
-        double vect_ip1 = vidx_ip1 != -1 ? vect[vidx_ip1] : 0.0;
-        double vect_jp1 = vidx_jp1 != -1 ? vect[vidx_jp1] : 0.0;
-        double vect_kp1 = vidx_kp1 != -1 ? vect[vidx_kp1] : 0.0;
-
-        double plusi = (double)A[vidx].plusi * negscale;
-        double plusj = (double)A[vidx].plusj * negscale;
-        double plusk = (double)A[vidx].plusk * negscale;
+    for (int vidx = _matSize - 1; vidx >= 0; vidx--) {
+        _backwardSubstitutionCell(A, precon, q, vect, vidx, scale);
+    }
+}
 
-        double preconval = precon[vidx];
-        double t = q[vidx] - plusi * preconval * vect_ip1 -
-                             plusj * preconval * vect_jp1 -
-                             plusk * preconval * vect_kp1;
+template <class T>
+void PressureSolver::_forwardSubstitutionCell(MatrixCoefficients &A, 
+                                              T &precon,
+                                              T &residual, 
+                                              T &q,
+                                              int vidx, double scale) {
+    double negscale = -scale;
 
-        t = t*preconval;
-        vect[vidx] = t;
+    int vidx_im1 = A.iminus[vidx];
+    int vidx_jm1 = A.jminus[vidx];
+    int vidx_km1 = A.kminus[vidx];
+
+    double plusi_im1 = 0.0;
+    double precon_im1 = 0.0;
+    double q_im1 = 0.0;
+    if (vidx_im1 != -1) {
+        plusi_im1  = (double)A.plusi[vidx_im1] * negscale;
+        precon_im1 = precon[vidx_im1];
+        q_im1      = q[vidx_im1];
     }
-}
 
-void PressureSolver::_applyMatrix(MatrixCoefficients &A, VectorXd &x, VectorXd &result) {
-    assert(A.size() == x.size() && x.size() == result.size());
+    double plusj_jm1 = 0.0;
+    double precon_jm1 = 0.0;
+    double q_jm1 = 0.0;
+    if (vidx_jm1 != -1) {
+        plusj_jm1  = (double)A.plusj[vidx_jm1] * negscale;
+        precon_jm1 = precon[vidx_jm1];
+        q_jm1      = q[vidx_jm1];
+    }
 
-    double scale = _deltaTime / (_density*_dx*_dx);
-    double negscale = -scale;
+    double plusk_km1 = 0.0;
+    double precon_km1 = 0.0;
+    double q_km1 = 0.0;
+    if (vidx_km1 != -1) {
+        plusk_km1  = (double)A.plusk[vidx_km1] * negscale;
+        precon_km1 = precon[vidx_km1];
+        q_km1      = q[vidx_km1];
+    }
 
-    for (unsigned int idx = 0; idx < _fluidCells->size(); idx++) {
-        int i = _fluidCells->at(idx).i;
-        int j = _fluidCells->at(idx).j;
-        int k = _fluidCells->at(idx).k;
+    double t = residual[vidx] - plusi_im1 * precon_im1 * q_im1 -
+                                plusj_jm1 * precon_jm1 * q_jm1 -
+                                plusk_km1 * precon_km1 * q_km1;
 
-        // val = dot product of column vector x and idxth row of matrix A
-        double val = 0.0;
-        int vidx = _GridToVectorIndex(i - 1, j, k);
-        if (vidx != -1) { val += x._vector[vidx]; }
+    t = t*precon[vidx];
+    q[vidx] = t;
+}
 
-        vidx = _GridToVectorIndex(i + 1, j, k);
-        if (vidx != -1) { val += x._vector[vidx]; }
+template <class T>
+void PressureSolver::_backwardSubstitutionCell(MatrixCoefficients &A, 
+                                               T &precon,
+                                               T &q, 
+                                               T &vect,
+                                               int vidx, double scale) {
+    double negscale = -scale;
 
-        vidx = _GridToVectorIndex(i, j - 1, k);
-        if (vidx != -1) { val += x._vector[vidx]; }
+    int vidx_ip1 = A.iplus[vidx];
+    int vidx_jp1 = A.jplus[vidx];
+    int vidx_kp1 = A.kplus[vidx];
 
-        vidx = _GridToVectorIndex(i, j + 1, k);
-        if (vidx != -1) { val += x._vector[vidx]; }
+    double vect_ip1 = vidx_ip1 != -1 ? vect[vidx_ip1] : 0.0;
+    double vect_jp1 = vidx_jp1 != -1 ? vect[vidx_jp1] : 0.0;
+    double vect_kp1 = vidx_kp1 != -1 ? vect[vidx_kp1] : 0.0;
 
-        vidx = _GridToVectorIndex(i, j, k - 1);
-        if (vidx != -1) { val += x._vector[vidx]; }
+    double plusi = (double)A.plusi[vidx] * negscale;
+    double plusj = (double)A.plusj[vidx] * negscale;
+    double plusk = (double)A.plusk[vidx] * negscale;
 
-        vidx = _GridToVectorIndex(i, j, k + 1);
-        if (vidx != -1) { val += x._vector[vidx]; }
+    double preconval = precon[vidx];
+    double t = q[vidx] - plusi * preconval * vect_ip1 -
+                         plusj * preconval * vect_jp1 -
+                         plusk * preconval * vect_kp1;
 
-        val *= negscale;
+    t = t*preconval;
+    vect[vidx] = t;
+}
 
-        vidx = _GridToVectorIndex(i, j, k);
-        val += (double)A.cells[vidx].diag * scale * x._vector[vidx];
+template <class T>
+void PressureSolver::_applyMatrix(MatrixCoefficients &A, T &x, T &result) {
+    assert(A.size() == x.size() && x.size() == result.size());
 
-        result._vector[vidx] = val;
+    double scale = _deltaTime / (_density*_dx*_dx);
+    for (int vidx = 0; vidx < _matSize; vidx++) {
+        result._vector[vidx] = _applyMatrixCell(A, x, vidx, scale);
     }
 }
 
+// Returns the dot product of column vector x and the vidxth row of matrix A
+template <class T>
+double PressureSolver::_applyMatrixCell(MatrixCoefficients &A, T &x, 
+                                        int vidx, double scale) {
+    int ni = A.iminus[vidx];
+    int pi = A.iplus[vidx];
+    int nj = A.jminus[vidx];
+    int pj = A.jplus[vidx];
+    int nk = A.kminus[vidx];
+    int pk = A.kplus[vidx];
+
+    double val = (ni != -1 ? (double)x._vector[ni] : 0.0) + 
+                 (pi != -1 ? (double)x._vector[pi] : 0.0) +
+                 (nj != -1 ? (double)x._vector[nj] : 0.0) + 
+                 (pj != -1 ? (double)x._vector[pj] : 0.0) +
+                 (nk != -1 ? (double)x._vector[nk] : 0.0) + 
+                 (pk != -1 ? (double)x._vector[pk] : 0.0);
+
+    return scale * ((double)A.diag[vidx] * (double)x._vector[vidx] - val);
+}
+
 // v1 += v2*scale
-void PressureSolver::_addScaledVector(VectorXd &v1, VectorXd &v2, double scale) {
+template <class T>
+void PressureSolver::_addScaledVector(T &v1, T &v2, double scale) {
     assert(v1.size() == v2.size());
     for (unsigned int idx = 0; idx < v1.size(); idx++) {
         v1._vector[idx] += v2._vector[idx]*scale;
@@ -434,9 +643,10 @@ void PressureSolver::_addScaledVector(VectorXd &v1, VectorXd &v2, double scale)
 }
 
 // result = v1*s1 + v2*s2
-void PressureSolver::_addScaledVectors(VectorXd &v1, double s1, 
-                                       VectorXd &v2, double s2,
-                                       VectorXd &result) {
+template <class T>
+void PressureSolver::_addScaledVectors(T &v1, double s1, 
+                                       T &v2, double s2,
+                                       T &result) {
     assert(v1.size() == v2.size() && v2.size() == result.size());
     for (unsigned int idx = 0; idx < v1.size(); idx++) {
         result._vector[idx] = v1._vector[idx]*s1 + v2._vector[idx]*s2;
@@ -449,17 +659,125 @@ void PressureSolver::_solvePressureSystem(MatrixCoefficients &A,
                                           VectorXd &b, 
                                           VectorXd &precon,
                                           VectorXd &pressure) {
+    int iterations = 0;
+    double error = 0.0;
+    bool isConverged = _solveConjugateGradient(A, b, precon, pressure, 
+                                               _pressureSolveTolerance, 
+                                               _maxCGIterations,
+                                               &iterations, &error);
+
+    if (isConverged) {
+        _logfile->log("CG Iterations: ", iterations, 1);
+    } else {
+        _logfile->log("Iterations limit reached.\t Estimated error : ",
+                      error, 1);
+    }
+}
 
+/*
+    Iterative refinement. Only the pressure and its residual are stored in 
+    double precision. The preconditioner and the conjugate gradient vectors
+    used to solve for each correction are stored in single precision.
+
+    The residual is updated with the double precision product of the matrix
+    and each correction, so b is overwritten by the residual.
+*/
+void PressureSolver::_solvePressureSystemMixedPrecision(MatrixCoefficients &A, 
+                                                        VectorXd &b, 
+                                                        VectorXd &pressure) {
     double tol = _pressureSolveTolerance;
-    if (b.absMaxCoeff() < tol) {
-        return;
+    double scale = _deltaTime / (_density*_dx*_dx);
+
+    VectorXf precon(_matSize);
+    _calculatePreconditionerVector(A, precon);
+
+    VectorXd &residual = b;
+    for (int vidx = 0; vidx < _matSize; vidx++) {
+        residual._vector[vidx] -= _applyMatrixCell(A, pressure, vidx, scale);
+    }
+
+    VectorXf residualf(_matSize);
+    VectorXf correction(_matSize);
+
+    int totalIterations = 0;
+    int numRefinements = 0;
+    double error = 0.0;
+    bool isConverged = false;
+    for (;;) {
+        error = residual.absMaxCoeff();
+        if (error < tol) {
+            isConverged = true;
+            break;
+        }
+
+        if (numRefinements == _maxRefinementIterations || 
+                totalIterations >= _maxCGIterations) {
+            break;
+        }
+
+        for (int vidx = 0; vidx < _matSize; vidx++) {
+            residualf._vector[vidx] = (float)residual._vector[vidx];
+        }
+        correction.fill(0.0f);
+
+        double innerTol = fmax(0.5*tol, _mixedPrecisionRelativeTolerance*error);
+        int iterations = 0;
+        double innerError = 0.0;
+        _solveConjugateGradient(A, residualf, precon, correction, innerTol,
+                                _maxCGIterations - totalIterations,
+                                &iterations, &innerError);
+        totalIterations += iterations;
+        numRefinements++;
+
+        for (int vidx = 0; vidx < _matSize; vidx++) {
+            pressure._vector[vidx] += (double)correction._vector[vidx];
+            residual._vector[vidx] -= _applyMatrixCell(A, correction, vidx, scale);
+        }
+    }
+
+    _logfile->log("CG Refinement Iterations: ", numRefinements, 1);
+    if (isConverged) {
+        _logfile->log("CG Iterations: ", totalIterations, 1);
+    } else {
+        _logfile->log("Iterations limit reached.\t Estimated error : ",
+                      error, 1);
+    }
+}
+
+template <class T>
+bool PressureSolver::_solveConjugateGradient(MatrixCoefficients &A, 
+                                             T &b, T &precon, T &x,
+                                             double tol, int maxIterations,
+                                             int *iterations, double *error) {
+    if (_isParallelSolveEnabled()) {
+        return _solveConjugateGradientParallel(A, b, precon, x, tol, maxIterations,
+                                               iterations, error);
+    } else {
+        return _solveConjugateGradientSerial(A, b, precon, x, tol, maxIterations,
+                                             iterations, error);
+    }
+}
+
+template <class T>
+bool PressureSolver::_solveConjugateGradientSerial(MatrixCoefficients &A, 
+                                                   T &b, T &precon, T &x,
+                                                   double tol, int maxIterations,
+                                                   int *iterations, double *error) {
+    // residual = b - A*x, where x holds the initial guess
+    T auxillary(_matSize);
+    _applyMatrix(A, x, auxillary);
+    T residual(b);
+    _addScaledVector(residual, auxillary, -1.0);
+
+    *iterations = 0;
+    *error = residual.absMaxCoeff();
+    if (*error < tol) {
+        return true;
     }
 
-    VectorXd residual(b);
-    VectorXd auxillary(_matSize);
     _applyPreconditioner(A, precon, residual, auxillary);
 
-    VectorXd search(auxillary);
+    T search(auxillary);
 
     double alpha = 0.0;
     double beta = 0.0;
@@ -467,15 +785,16 @@ void PressureSolver::_solvePressureSystem(MatrixCoefficients &A,
     double sigmaNew = 0.0;
     int iterationNumber = 0;
 
-    while (iterationNumber < _maxCGIterations) {
+    while (iterationNumber < maxIterations) {
         _applyMatrix(A, search, auxillary);
         alpha = sigma / auxillary.dot(search);
-        _addScaledVector(pressure, search, alpha);
+        _addScaledVector(x, search, alpha);
         _addScaledVector(residual, auxillary, -alpha);
 
-        if (residual.absMaxCoeff() < tol) {
-            _logfile->log("CG Iterations: ", iterationNumber, 1);
-            return;
+        *error = residual.absMaxCoeff();
+        if (*error < tol) {
+            *iterations = iterationNumber;
+            return true;
         }
 
         _applyPreconditioner(A, precon, residual, auxillary);
@@ -489,11 +808,332 @@ void PressureSolver::_solvePressureSystem(MatrixCoefficients &A,
         if (iterationNumber % 10 == 0) {
             std::ostringstream ss;
             ss << "\tIteration #: " << iterationNumber <<
-                  "\tEstimated Error: " << residual.absMaxCoeff() << std::endl;
+                  "\tEstimated Error: " << *error << std::endl;
+            _logfile->print(ss.str());
+        }
+    }
+
+    *iterations = iterationNumber;
+    return false;
+}
+
+bool PressureSolver::_isParallelSolveEnabled() {
+    return _preconditioner == PressurePreconditioner::mic && 
+           _numThreads > 1 && _matSize >= _minParallelSystemSize;
+}
+
+/*
+    Sorts the fluid cells by level, i + j + k, and groups the levels into
+    blocks. Small levels are merged into serial blocks to avoid 
+    synchronizing threads for only a few cells of work.
+*/
+void PressureSolver::_initializeLevelSchedule() {
+    int numLevels = _isize + _jsize + _ksize - 2;
+    std::vector<int> levelOffsets(numLevels + 1, 0);
+
+    GridIndex g;
+    for (int vidx = 0; vidx < _matSize; vidx++) {
+        g = _VectorToGridIndex(vidx);
+        levelOffsets[g.i + g.j + g.k + 1]++;
+    }
+
+    for (int i = 1; i < (int)levelOffsets.size(); i++) {
+        levelOffsets[i] += levelOffsets[i - 1];
+    }
+
+    std::vector<int> insertPositions(levelOffsets.begin(), levelOffsets.end() - 1);
+    _levelCells.assign(_matSize, 0);
+    for (int vidx = 0; vidx < _matSize; vidx++) {
+        g = _VectorToGridIndex(vidx);
+        _levelCells[insertPositions[g.i + g.j + g.k]++] = vidx;
+    }
+
+    _levelBlocks.clear();
+    LevelBlock serialBlock;
+    bool isSerialBlockOpen = false;
+    for (int level = 0; level < numLevels; level++) {
+        int begin = levelOffsets[level];
+        int end = levelOffsets[level + 1];
+        if (begin == end) {
+            continue;
+        }
+
+        if (end - begin >= _minParallelLevelSize) {
+            if (isSerialBlockOpen) {
+                _levelBlocks.push_back(serialBlock);
+                isSerialBlockOpen = false;
+            }
+
+            LevelBlock block;
+            block.begin = begin;
+            block.end = end;
+            block.isParallel = true;
+            _levelBlocks.push_back(block);
+        } else if (isSerialBlockOpen) {
+            serialBlock.end = end;
+        } else {
+            serialBlock.begin = begin;
+            serialBlock.end = end;
+            serialBlock.isParallel = false;
+            isSerialBlockOpen = true;
+        }
+    }
+
+    if (isSerialBlockOpen) {
+        _levelBlocks.push_back(serialBlock);
+    }
+}
+
+void PressureSolver::_getLevelBlockThreadRange(LevelBlock &block, 
+                                               int tid, int numThreads,
+                                               int *begin, int *end) {
+    if (block.isParallel) {
+        ThreadUtils::getThreadInterval(block.begin, block.end, tid, numThreads, 
+                                       begin, end);
+    } else if (tid == 0) {
+        *begin = block.begin;
+        *end = block.end;
+    } else {
+        *begin = block.begin;
+        *end = block.begin;
+    }
+}
+
+template <class T>
+void PressureSolver::_calculatePreconditionerVectorParallel(MatrixCoefficients &A, 
+                                                            T &precon) {
+    assert(A.size() == precon.size());
+
+    ThreadUtils::Barrier barrier(_numThreads);
+    std::vector<std::thread> threads(_numThreads);
+    for (int i = 0; i < _numThreads; i++) {
+        threads[i] = std::thread(&PressureSolver::_calculatePreconditionerVectorThread<T>, this,
+                                 i, _numThreads, &A, &precon, &barrier);
+    }
+
+    for (int i = 0; i < _numThreads; i++) {
+        threads[i].join();
+    }
+}
+
+template <class T>
+void PressureSolver::_calculatePreconditionerVectorThread(int tid, int numThreads,
+                                                          MatrixCoefficients *A, 
+                                                          T *precon,
+                                                          ThreadUtils::Barrier *barrier) {
+    double scale = _deltaTime / (_density*_dx*_dx);
+
+    int begin, end;
+    for (unsigned int bidx = 0; bidx < _levelBlocks.size(); bidx++) {
+        _getLevelBlockThreadRange(_levelBlocks[bidx], tid, numThreads, &begin, &end);
+        for (int i = begin; i < end; i++) {
+            _calculatePreconditionerCell(*A, *precon, _levelCells[i], scale);
+        }
+        barrier->wait();
+    }
+}
+
+template <class T>
+void PressureSolver::_applyPreconditionerThread(int tid, ParallelSolverData<T> *data,
+                                                T &residual, T &vect) {
+    MatrixCoefficients &A = *(data->A);
+    T &precon = *(data->precon);
+    T &q = data->q;
+    double scale = _deltaTime / (_density*_dx*_dx);
+
+    // Solve A*q = residual
+    int begin, end;
+    for (unsigned int bidx = 0; bidx < _levelBlocks.size(); bidx++) {
+        _getLevelBlockThreadRange(_levelBlocks[bidx], tid, data->numThreads, &begin, &end);
+        for (int i = begin; i < end; i++) {
+            _forwardSubstitutionCell(A, precon, residual, q, _levelCells[i], scale);
+        }
+        data->barrier.wait();
+    }
+
+    // Solve transpose(A)*z = q
+    for (int bidx = (int)_levelBlocks.size() - 1; bidx >= 0; bidx--) {
+        _getLevelBlockThreadRange(_levelBlocks[bidx], tid, data->numThreads, &begin, &end);
+        for (int i = end - 1; i >= begin; i--) {
+            _backwardSubstitutionCell(A, precon, q, vect, _levelCells[i], scale);
+        }
+        data->barrier.wait();
+    }
+}
+
+/*
+    Partial results are double buffered so that a thread may begin the next
+    reduction while other threads are still reading the current one.
+*/
+template <class T>
+double PressureSolver::_reduceSumThread(int tid, ParallelSolverData<T> *data, 
+                                        double value, int *reductionCount) {
+    int stride = ParallelSolverData<T>::partialSumStride;
+    int offset = (*reductionCount % 2) * data->numThreads * stride;
+    data->partialSums[offset + tid*stride] = value;
+    data->barrier.wait();
+
+    double sum = 0.0;
+    for (int i = 0; i < data->numThreads; i++) {
+        sum += data->partialSums[offset + i*stride];
+    }
+    (*reductionCount)++;
+
+    return sum;
+}
+
+template <class T>
+double PressureSolver::_reduceMaxThread(int tid, ParallelSolverData<T> *data, 
+                                        double value, int *reductionCount) {
+    int stride = ParallelSolverData<T>::partialSumStride;
+    int offset = (*reductionCount % 2) * data->numThreads * stride;
+    data->partialSums[offset + tid*stride] = value;
+    data->barrier.wait();
+
+    double max = -std::numeric_limits<double>::infinity();
+    for (int i = 0; i < data->numThreads; i++) {
+        max = fmax(max, data->partialSums[offset + i*stride]);
+    }
+    (*reductionCount)++;
+
+    return max;
+}
+
+// Parallel version of _solveConjugateGradientSerial. Each thread owns a 
+// contiguous range of the system vectors and runs the full CG loop. Threads 
+// synchronize at reductions and between preconditioner levels.
+template <class T>
+bool PressureSolver::_solveConjugateGradientParallel(MatrixCoefficients &A, 
+                                                     T &b, T &precon, T &x,
+                                                     double tol, int maxIterations,
+                                                     int *iterations, double *error) {
+    ParallelSolverData<T> data(_matSize, _numThreads);
+    data.A = &A;
+    data.b = &b;
+    data.precon = &precon;
+    data.x = &x;
+    data.tolerance = tol;
+    data.maxIterations = maxIterations;
+
+    std::vector<std::thread> threads(_numThreads);
+    for (int i = 0; i < _numThreads; i++) {
+        threads[i] = std::thread(&PressureSolver::_solveConjugateGradientThread<T>, this,
+                                 i, &data);
+    }
+
+    for (int i = 0; i < _numThreads; i++) {
+        threads[i].join();
+    }
+
+    *iterations = data.iterations;
+    *error = data.error;
+
+    return data.isConverged;
+}
+
+template <class T>
+void PressureSolver::_solveConjugateGradientThread(int tid, ParallelSolverData<T> *data) {
+    MatrixCoefficients &A = *(data->A);
+    T &b = *(data->b);
+    T &x = *(data->x);
+    T &residual = data->residual;
+    T &auxillary = data->auxillary;
+    T &search = data->search;
+
+    double tol = data->tolerance;
+    double scale = _deltaTime / (_density*_dx*_dx);
+    int reductionCount = 0;
+
+    int begin, end;
+    ThreadUtils::getThreadInterval(0, _matSize, tid, data->numThreads, &begin, &end);
+
+    // residual = b - A*x, where x holds the initial guess
+    double localValue = 0.0;
+    for (int idx = begin; idx < end; idx++) {
+        double r = (double)b._vector[idx] - _applyMatrixCell(A, x, idx, scale);
+        residual._vector[idx] = r;
+        localValue = fmax(localValue, fabs((double)residual._vector[idx]));
+    }
+
+    double error = _reduceMaxThread(tid, data, localValue, &reductionCount);
+    if (error < tol) {
+        if (tid == 0) {
+            data->iterations = 0;
+            data->error = error;
+            data->isConverged = true;
+        }
+        return;
+    }
+
+    _applyPreconditionerThread(tid, data, residual, auxillary);
+
+    localValue = 0.0;
+    for (int idx = begin; idx < end; idx++) {
+        search._vector[idx] = auxillary._vector[idx];
+        localValue += (double)auxillary._vector[idx] * (double)residual._vector[idx];
+    }
+
+    double alpha = 0.0;
+    double beta = 0.0;
+    double sigma = _reduceSumThread(tid, data, localValue, &reductionCount);
+    double sigmaNew = 0.0;
+    int iterationNumber = 0;
+
+    while (iterationNumber < data->maxIterations) {
+        localValue = 0.0;
+        for (int idx = begin; idx < end; idx++) {
+            double val = _applyMatrixCell(A, search, idx, scale);
+            auxillary._vector[idx] = val;
+            localValue += val * (double)search._vector[idx];
+        }
+        alpha = sigma / _reduceSumThread(tid, data, localValue, &reductionCount);
+
+        localValue = 0.0;
+        for (int idx = begin; idx < end; idx++) {
+            x._vector[idx] += alpha * search._vector[idx];
+            residual._vector[idx] -= alpha * auxillary._vector[idx];
+            localValue = fmax(localValue, fabs((double)residual._vector[idx]));
+        }
+        error = _reduceMaxThread(tid, data, localValue, &reductionCount);
+
+        if (error < tol) {
+            if (tid == 0) {
+                data->iterations = iterationNumber;
+                data->error = error;
+                data->isConverged = true;
+            }
+            return;
+        }
+
+        _applyPreconditionerThread(tid, data, residual, auxillary);
+
+        localValue = 0.0;
+        for (int idx = begin; idx < end; idx++) {
+            localValue += (double)auxillary._vector[idx] * (double)residual._vector[idx];
+        }
+        sigmaNew = _reduceSumThread(tid, data, localValue, &reductionCount);
+        beta = sigmaNew / sigma;
+
+        for (int idx = begin; idx < end; idx++) {
+            search._vector[idx] = auxillary._vector[idx] + beta * search._vector[idx];
+        }
+        sigma = sigmaNew;
+
+        iterationNumber++;
+
+        if (tid == 0 && iterationNumber % 10 == 0) {
+            std::ostringstream ss;
+            ss << "\tIteration #: " << iterationNumber <<
+                  "\tEstimated Error: " << error << std::endl;
             _logfile->print(ss.str());
         }
+
+        // Search vector must be complete before the next matrix product
+        data->barrier.wait();
     }
 
-    _logfile->log("Iterations limit reached.\t Estimated error : ",
-                  residual.absMaxCoeff(), 1);
-}
\ No newline at end of file
+    if (tid == 0) {
+        data->iterations = iterationNumber;
+        data->error = error;
+    }
+}
@@ -26,22 +26,18 @@ freely, subject to the following restrictions:
 #include <limits>
 #include <algorithm>
 #include "macvelocityfield.h"
-#include "gridindexkeymap.h"
 #include "logfile.h"
 #include "grid3d.h"
 #include "array3d.h"
 #include "fluidmaterialgrid.h"
 #include "gridindexvector.h"
+#include "stopwatch.h"
+#include "threadutils.h"
+#include "multigridpreconditioner.h"
 
-struct PressureSolverParameters {
-    double cellwidth;
-    double density;
-    double deltaTime;
-
-    GridIndexVector *fluidCells;
-    FluidMaterialGrid *materialGrid;
-    MACVelocityField *velocityField;
-    LogFile *logfile;
+enum class PressurePreconditioner : char { 
+    mic       = 0x00, 
+    multigrid = 0x01
 };
 
 /********************************************************************************
@@ -73,18 +69,64 @@ public:
 };
 
 /********************************************************************************
-    MatrixCoefficients
+    VectorXf
 ********************************************************************************/
 
-struct MatrixCell {
-    char diag;
-    char plusi;
-    char plusj;
-    char plusk;
+/*
+    Single precision vector for mixed precision solves. Dot products and 
+    norms are accumulated and returned in double precision.
+*/
+class VectorXf
+{
+public:
+    VectorXf();
+    VectorXf(int size);
+    VectorXf(int size, float fill);
+    VectorXf(VectorXf &vector);
+    ~VectorXf();
+
+    const float operator [](int i) const;
+    float& operator[](int i);
+
+    inline unsigned int size() {
+        return _vector.size();
+    }
+
+    void fill(float fill);
+    double dot(VectorXf &vector);
+    double absMaxCoeff();
+
+    std::vector<float> _vector;
 
-    MatrixCell() : diag(0x00), plusi(0x00), plusj(0x00), plusk(0x00) {}
 };
 
+struct PressureSolverParameters {
+    double cellwidth;
+    double density;
+    double deltaTime;
+    PressurePreconditioner preconditioner;
+    bool isMixedPrecisionEnabled;
+
+    // Optional initial guess for the solver, ordered to match fluidCells.
+    // The solve starts from zero if this is a null pointer.
+    VectorXd *initialPressure;
+
+    GridIndexVector *fluidCells;
+    FluidMaterialGrid *materialGrid;
+    MACVelocityField *velocityField;
+    LogFile *logfile;
+};
+
+/********************************************************************************
+    MatrixCoefficients
+********************************************************************************/
+
+/*
+    Structure-of-arrays storage for the 7-point stencil. Coefficients are
+    stored as integers that are multiplied by the matrix scale when used. 
+    Neighbour arrays hold the vector index of the adjacent fluid cell, or -1
+    if the neighbouring cell is not fluid.
+*/
 class MatrixCoefficients
 {
 public:
@@ -92,14 +134,21 @@ public:
     MatrixCoefficients(int size);
     ~MatrixCoefficients();
 
-    const MatrixCell operator [](int i) const;
-    MatrixCell& operator [](int i);
-
     inline unsigned int size() {
-        return cells.size();
+        return diag.size();
     }
 
-    std::vector<MatrixCell> cells;
+    std::vector<char> diag;
+    std::vector<char> plusi;
+    std::vector<char> plusj;
+    std::vector<char> plusk;
+
+    std::vector<int> iminus;
+    std::vector<int> iplus;
+    std::vector<int> jminus;
+    std::vector<int> jplus;
+    std::vector<int> kminus;
+    std::vector<int> kplus;
 };
 
 /********************************************************************************
@@ -116,35 +165,141 @@ public:
 
 private:
 
-    inline int _GridToVectorIndex(GridIndex g) {
-        return _keymap.find(g);
-    }
-    inline int _GridToVectorIndex(int i, int j, int k) {
-        return _keymap.find(i, j, k);
-    }
+    /*
+        A block of consecutive cells in the level schedule. A parallel block
+        holds a single level whose cells are split between threads. A serial
+        block holds a run of small levels that is processed by one thread.
+    */
+    struct LevelBlock {
+        int begin;
+        int end;
+        bool isParallel;
+    };
+
+    template <class T>
+    struct ParallelSolverData {
+        ParallelSolverData(int size, int nthreads) : 
+                                 residual(size), auxillary(size), 
+                                 search(size), q(size),
+                                 partialSums(2*nthreads*partialSumStride, 0.0),
+                                 barrier(nthreads), numThreads(nthreads) {}
+
+        MatrixCoefficients *A;
+        T *b;
+        T *precon;
+        T *x;
+        double tolerance;
+        int maxIterations;
+
+        T residual;
+        T auxillary;
+        T search;
+        T q;
+
+        // Partial sums are padded to avoid false sharing between threads
+        static const int partialSumStride = 8;
+        std::vector<double> partialSums;
+
+        ThreadUtils::Barrier barrier;
+        int numThreads;
+        int iterations = 0;
+        double error = 0.0;
+        bool isConverged = false;
+    };
+
     inline GridIndex _VectorToGridIndex(int i) {
-        return _fluidCells->at(i);
+        return _systemCells.at(i);
     }
 
     void _initialize(PressureSolverParameters params);
-    void _initializeGridIndexKeyMap();
+    void _initializeSystemCells();
+    void _calculateNeighbourIndices(MatrixCoefficients &A);
     void _calculateNegativeDivergenceVector(VectorXd &b);
     void _calculateMatrixCoefficients(MatrixCoefficients &A);
     int _getNumFluidOrAirCellNeighbours(int i, int j, int k);
-    void _calculatePreconditionerVector(MatrixCoefficients &A, VectorXd &precon);
+    template <class T>
+    void _calculatePreconditionerVector(MatrixCoefficients &A, T &precon);
+    template <class T>
+    void _calculatePreconditionerVectorSerial(MatrixCoefficients &A, T &precon);
     void _solvePressureSystem(MatrixCoefficients &A, 
                               VectorXd &b, 
                               VectorXd &precon,
                               VectorXd &pressure);
+    void _solvePressureSystemMixedPrecision(MatrixCoefficients &A, 
+                                            VectorXd &b, 
+                                            VectorXd &pressure);
+
+    /*
+        Conjugate gradient solvers, instantiated for double (VectorXd) and 
+        float (VectorXf) vector storage. Dot products and norms are always 
+        accumulated in double precision. x holds the initial guess on input.
+        Returns true if the residual is reduced below tol.
+    */
+    template <class T>
+    bool _solveConjugateGradient(MatrixCoefficients &A, T &b, T &precon, T &x,
+                                 double tol, int maxIterations,
+                                 int *iterations, double *error);
+    template <class T>
+    bool _solveConjugateGradientSerial(MatrixCoefficients &A, T &b, T &precon, T &x,
+                                       double tol, int maxIterations,
+                                       int *iterations, double *error);
+    template <class T>
+    bool _solveConjugateGradientParallel(MatrixCoefficients &A, T &b, T &precon, T &x,
+                                         double tol, int maxIterations,
+                                         int *iterations, double *error);
+
+    template <class T>
     void _applyPreconditioner(MatrixCoefficients &A, 
-                              VectorXd &precon,
-                              VectorXd &residual,
-                              VectorXd &vect);
-    void _applyMatrix(MatrixCoefficients &A, VectorXd &x, VectorXd &result);
-    void _addScaledVector(VectorXd &v1, VectorXd &v2, double scale);
-    void _addScaledVectors(VectorXd &v1, double s1, 
-                           VectorXd &v2, double s2,
-                           VectorXd &result);
+                              T &precon,
+                              T &residual,
+                              T &vect);
+    template <class T>
+    void _applyMatrix(MatrixCoefficients &A, T &x, T &result);
+    template <class T>
+    void _addScaledVector(T &v1, T &v2, double scale);
+    template <class T>
+    void _addScaledVectors(T &v1, double s1, 
+                           T &v2, double s2,
+                           T &result);
+
+    template <class T>
+    void _calculatePreconditionerCell(MatrixCoefficients &A, T &precon, 
+                                      int vidx, double scale);
+    template <class T>
+    void _forwardSubstitutionCell(MatrixCoefficients &A, T &precon,
+                                  T &residual, T &q,
+                                  int vidx, double scale);
+    template <class T>
+    void _backwardSubstitutionCell(MatrixCoefficients &A, T &precon,
+                                   T &q, T &vect,
+                                   int vidx, double scale);
+    template <class T>
+    double _applyMatrixCell(MatrixCoefficients &A, T &x, 
+                            int vidx, double scale);
+
+    bool _isParallelSolveEnabled();
+    void _initializeLevelSchedule();
+    void _getLevelBlockThreadRange(LevelBlock &block, int tid, int numThreads,
+                                   int *begin, int *end);
+    template <class T>
+    void _calculatePreconditionerVectorParallel(MatrixCoefficients &A, 
+                                                T &precon);
+    template <class T>
+    void _calculatePreconditionerVectorThread(int tid, int numThreads,
+                                              MatrixCoefficients *A, 
+                                              T *precon,
+                                              ThreadUtils::Barrier *barrier);
+    template <class T>
+    void _solveConjugateGradientThread(int tid, ParallelSolverData<T> *data);
+    template <class T>
+    void _applyPreconditionerThread(int tid, ParallelSolverData<T> *data,
+                                    T &residual, T &vect);
+    template <class T>
+    double _reduceSumThread(int tid, ParallelSolverData<T> *data, 
+                            double value, int *reductionCount);
+    template <class T>
+    double _reduceMaxThread(int tid, ParallelSolverData<T> *data, 
+                            double value, int *reductionCount);
 
     int _isize = 0;
     int _jsize = 0;
@@ -157,11 +312,39 @@ private:
     double _pressureSolveTolerance = 1e-6;
     int _maxCGIterations = 200;
 
+    // Mixed precision solves run CG on float vectors for the correction
+    // to the double precision pressure until the true residual meets the
+    // tolerance. Each refinement reduces the residual by at most 
+    // _mixedPrecisionRelativeTolerance to stay within float precision.
+    bool _isMixedPrecisionEnabled = false;
+    int _maxRefinementIterations = 8;
+    double _mixedPrecisionRelativeTolerance = 1e-5;
+
+    // The preconditioner is parallelized with a level schedule. Cell (i, j, k)
+    // only depends on its -i, -j, -k neighbours in the forward substitution 
+    // so all cells with equal i + j + k can be processed concurrently.
+    int _numThreads = 1;
+    int _minParallelSystemSize = 8192;
+    int _minParallelLevelSize = 512;
+    std::vector<int> _levelCells;
+    std::vector<LevelBlock> _levelBlocks;
+
+    // The system vectors are ordered by blocks of cells, and by flat grid
+    // index within each block, with i varying fastest and k slowest. This 
+    // keeps stencil neighbours close in memory and remains a valid ordering
+    // for the MIC(0) sweeps.
+    int _cellBlockWidth = 8;
+    GridIndexVector _systemCells;
+    std::vector<int> _systemToFluidCellIndex;
+
+    PressurePreconditioner _preconditioner = PressurePreconditioner::mic;
+    MultigridPreconditioner _multigrid;
+    VectorXd *_initialPressure = nullptr;
+
     GridIndexVector *_fluidCells;
     FluidMaterialGrid *_materialGrid;
     MACVelocityField *_vField;
     LogFile *_logfile;
-    GridIndexKeyMap _keymap;
 
 };
 
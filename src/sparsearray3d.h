@@ -0,0 +1,305 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef SPARSEARRAY3D_H
+#define SPARSEARRAY3D_H
+
+#include <vector>
+#include <algorithm>
+#include <assert.h>
+
+#include "array3d.h"
+
+/*
+    A 3d grid that is stored as cubic tiles of TILE_SIZE^3 elements. A tile
+    is only allocated when one of its elements is set. Elements of
+    unallocated tiles read as the background value, which is the value the
+    grid was filled with.
+
+    Reads never allocate, so any number of threads may read the grid at
+    once. Writes that may allocate a tile must not run concurrently with
+    any other access.
+*/
+template <class T>
+class SparseArray3d
+{
+public:
+    static const int TILE_SIZE = 8;
+    static const int TILE_SHIFT = 3;
+
+    SparseArray3d() {
+        _initializeTiles();
+    }
+
+    SparseArray3d(int i, int j, int k) : width(i), height(j), depth(k) {
+        _initializeTiles();
+    }
+
+    SparseArray3d(int i, int j, int k, T fillValue) : width(i), height(j), depth(k),
+                                                      _backgroundValue(fillValue) {
+        _initializeTiles();
+    }
+
+    SparseArray3d(const SparseArray3d &obj) = default;
+    SparseArray3d(SparseArray3d &&obj) = default;
+    SparseArray3d& operator=(const SparseArray3d &rhs) = default;
+    SparseArray3d& operator=(SparseArray3d &&rhs) = default;
+
+    ~SparseArray3d() {
+    }
+
+    /*
+        Filling the grid sets the background value and returns every tile 
+        to a free list. Tiles on the free list are reused by later writes, 
+        so a grid that is refilled each time step does not reallocate its 
+        tiles, and its memory is bounded by the largest number of tiles it 
+        has held at once rather than by every tile it has ever touched.
+    */
+    void fill(T value) {
+        _backgroundValue = value;
+        for (unsigned int idx = 0; idx < _activeTiles.size(); idx++) {
+            int tidx = _activeTiles[idx];
+            _freeTileOffsets.push_back(_tileOffsets[tidx]);
+            _tileOffsets[tidx] = -1;
+        }
+        _activeTiles.clear();
+    }
+
+    T operator()(int i, int j, int k) {
+        return get(i, j, k);
+    }
+
+    T operator()(GridIndex g) {
+        return get(g.i, g.j, g.k);
+    }
+
+    T get(int i, int j, int k) {
+        bool isInRange = _isIndexInRange(i, j, k);
+        if (!isInRange && _isOutOfRangeValueSet) {
+            return _outOfRangeValue;
+        }
+        assert(isInRange);
+
+        int offset = _tileOffsets[_getTileIndex(i, j, k)];
+        if (offset == -1) {
+            return _backgroundValue;
+        }
+        return _storage[offset + _getTileOffset(i, j, k)];
+    }
+
+    T get(GridIndex g) {
+        return get(g.i, g.j, g.k);
+    }
+
+    void set(int i, int j, int k, T value) {
+        assert(_isIndexInRange(i, j, k));
+
+        int tidx = _getTileIndex(i, j, k);
+        if (_tileOffsets[tidx] == -1) {
+            if (value == _backgroundValue) {
+                return;
+            }
+            _allocateTile(tidx);
+        }
+        _storage[_tileOffsets[tidx] + _getTileOffset(i, j, k)] = value;
+    }
+
+    void set(GridIndex g, T value) {
+        set(g.i, g.j, g.k, value);
+    }
+
+    void set(std::vector<GridIndex> &cells, T value) {
+        for (unsigned int i = 0; i < cells.size(); i++) {
+            set(cells[i], value);
+        }
+    }
+
+    void add(int i, int j, int k, T value) {
+        assert(_isIndexInRange(i, j, k));
+        *getPointer(i, j, k) += value;
+    }
+
+    void add(GridIndex g, T value) {
+        add(g.i, g.j, g.k, value);
+    }
+
+    /*
+        Allocates the tile containing the element if it is not yet allocated.
+        The pointer is invalidated when another tile is allocated.
+    */
+    T *getPointer(int i, int j, int k) {
+        bool isInRange = _isIndexInRange(i, j, k);
+        if (!isInRange && _isOutOfRangeValueSet) {
+            return &_outOfRangeValue;
+        }
+        assert(isInRange);
+
+        int tidx = _getTileIndex(i, j, k);
+        if (_tileOffsets[tidx] == -1) {
+            _allocateTile(tidx);
+        }
+        return &(_storage[_tileOffsets[tidx] + _getTileOffset(i, j, k)]);
+    }
+
+    T *getPointer(GridIndex g) {
+        return getPointer(g.i, g.j, g.k);
+    }
+
+    /*
+        Allocates the tile containing the element so that the element may
+        then be written by several threads at once.
+    */
+    void allocateTile(int i, int j, int k) {
+        assert(_isIndexInRange(i, j, k));
+
+        int tidx = _getTileIndex(i, j, k);
+        if (_tileOffsets[tidx] == -1) {
+            _allocateTile(tidx);
+        }
+    }
+
+    void allocateTile(GridIndex g) {
+        allocateTile(g.i, g.j, g.k);
+    }
+
+    bool isTileAllocated(int i, int j, int k) {
+        assert(_isIndexInRange(i, j, k));
+        return _tileOffsets[_getTileIndex(i, j, k)] != -1;
+    }
+
+    bool isTileAllocated(GridIndex g) {
+        return isTileAllocated(g.i, g.j, g.k);
+    }
+
+    int getNumAllocatedTiles() {
+        return (int)_activeTiles.size();
+    }
+
+    /*
+        Returns the index range [start, end) of grid cells covered by each
+        allocated tile, in the order the tiles were allocated.
+    */
+    void getAllocatedTileBounds(std::vector<GridIndex> &starts, 
+                                std::vector<GridIndex> &ends) {
+        for (unsigned int idx = 0; idx < _activeTiles.size(); idx++) {
+            int tidx = _activeTiles[idx];
+            int ti = tidx % _tileWidth;
+            int tj = (tidx / _tileWidth) % _tileHeight;
+            int tk = tidx / (_tileWidth * _tileHeight);
+
+            GridIndex s(ti * TILE_SIZE, tj * TILE_SIZE, tk * TILE_SIZE);
+            GridIndex e(std::min(s.i + TILE_SIZE, width), 
+                        std::min(s.j + TILE_SIZE, height), 
+                        std::min(s.k + TILE_SIZE, depth));
+            starts.push_back(s);
+            ends.push_back(e);
+        }
+    }
+
+    T getBackgroundValue() {
+        return _backgroundValue;
+    }
+
+    void setOutOfRangeValue() {
+        _isOutOfRangeValueSet = false;
+    }
+    void setOutOfRangeValue(T val) {
+        _outOfRangeValue = val;
+        _isOutOfRangeValueSet = true;
+    }
+
+    bool isOutOfRangeValueSet() {
+        return _isOutOfRangeValueSet;
+    }
+    T getOutOfRangeValue() {
+        return _outOfRangeValue;
+    }
+
+    inline bool isIndexInRange(int i, int j, int k) {
+        return i >= 0 && j >= 0 && k >= 0 && i < width && j < height && k < depth;
+    }
+
+    inline bool isIndexInRange(GridIndex g) {
+        return g.i >= 0 && g.j >= 0 && g.k >= 0 && g.i < width && g.j < height && g.k < depth;
+    }
+
+    int width = 0;
+    int height = 0;
+    int depth = 0;
+
+private:
+    void _initializeTiles() {
+        _tileWidth = (width + TILE_SIZE - 1) / TILE_SIZE;
+        _tileHeight = (height + TILE_SIZE - 1) / TILE_SIZE;
+        _tileDepth = (depth + TILE_SIZE - 1) / TILE_SIZE;
+        _tileOffsets = std::vector<int>(_tileWidth * _tileHeight * _tileDepth, -1);
+    }
+
+    /*
+        Tiles are stored one after another in a single array. Freed tiles 
+        keep their place in the array and are handed out again before the 
+        array is grown.
+    */
+    void _allocateTile(int tidx) {
+        int tileSize = TILE_SIZE * TILE_SIZE * TILE_SIZE;
+        int offset;
+        if (_freeTileOffsets.empty()) {
+            offset = (int)_storage.size();
+            _storage.resize(_storage.size() + tileSize, _backgroundValue);
+        } else {
+            offset = _freeTileOffsets.back();
+            _freeTileOffsets.pop_back();
+            std::fill(_storage.begin() + offset, 
+                      _storage.begin() + offset + tileSize, _backgroundValue);
+        }
+        _tileOffsets[tidx] = offset;
+        _activeTiles.push_back(tidx);
+    }
+
+    inline bool _isIndexInRange(int i, int j, int k) {
+        return i >= 0 && j >= 0 && k >= 0 && i < width && j < height && k < depth;
+    }
+
+    // Indices are in range and so never negative, which allows the tile
+    // index and offset to be found with shifts and masks
+    inline int _getTileIndex(int i, int j, int k) {
+        return (i >> TILE_SHIFT) + _tileWidth * 
+               ((j >> TILE_SHIFT) + _tileHeight * (k >> TILE_SHIFT));
+    }
+
+    inline int _getTileOffset(int i, int j, int k) {
+        int mask = TILE_SIZE - 1;
+        return (i & mask) + 
+               (((j & mask) + ((k & mask) << TILE_SHIFT)) << TILE_SHIFT);
+    }
+
+    std::vector<T> _storage;
+    std::vector<int> _tileOffsets;
+    std::vector<int> _activeTiles;
+    std::vector<int> _freeTileOffsets;
+    int _tileWidth = 0;
+    int _tileHeight = 0;
+    int _tileDepth = 0;
+
+    T _backgroundValue = T();
+    bool _isOutOfRangeValueSet = false;
+    T _outOfRangeValue = T();
+};
+
+#endif
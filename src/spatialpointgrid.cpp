@@ -26,6 +26,7 @@ SpatialPointGrid::SpatialPointGrid(int isize, int jsize, int ksize, double dx) :
                                         _isize(isize), _jsize(jsize), _ksize(ksize), _dx(dx),
                                         _grid(_isize, _jsize, _ksize),
                                         _bbox(vmath::vec3(), _dx*_isize, _dx*_jsize, _dx*_ksize) {
+    _mortonLayout.initialize(_isize, _jsize, _ksize);
 }
 
 SpatialPointGrid::~SpatialPointGrid() {
@@ -123,6 +124,42 @@ void SpatialPointGrid::queryPointReferencesInsideSphere(GridPointReference ref,
     _queryPointReferencesInsideSphere(gp.position, r, exclusions, refs);
 }
 
+void SpatialPointGrid::queryPointReferencesInsideSphere(std::vector<vmath::vec3> &queryPoints, 
+                                                        double r,
+                                                        std::vector<int> &offsets,
+                                                        std::vector<GridPointReference> &refs) {
+    std::vector<int> queryRefIDs(queryPoints.size(), -1);
+    _batchQueryPointReferencesInsideSphere(queryPoints, queryRefIDs, r, offsets, refs);
+}
+
+void SpatialPointGrid::queryPointReferencesInsideSphere(std::vector<GridPointReference> &queryRefs, 
+                                                        double r,
+                                                        std::vector<int> &offsets,
+                                                        std::vector<GridPointReference> &refs) {
+    std::vector<vmath::vec3> queryPoints;
+    std::vector<int> queryRefIDs;
+    queryPoints.reserve(queryRefs.size());
+    queryRefIDs.reserve(queryRefs.size());
+    for (unsigned int i = 0; i < queryRefs.size(); i++) {
+        queryPoints.push_back(getPointFromReference(queryRefs[i]));
+        queryRefIDs.push_back(queryRefs[i].id);
+    }
+
+    _batchQueryPointReferencesInsideSphere(queryPoints, queryRefIDs, r, offsets, refs);
+}
+
+void SpatialPointGrid::enableMortonCellOrdering() {
+    _isMortonCellOrderingEnabled = true;
+}
+
+void SpatialPointGrid::disableMortonCellOrdering() {
+    _isMortonCellOrderingEnabled = false;
+}
+
+bool SpatialPointGrid::isMortonCellOrderingEnabled() {
+    return _isMortonCellOrderingEnabled;
+}
+
 void SpatialPointGrid::queryPointsInsideAABB(AABB bbox, std::vector<vmath::vec3> &points) {
     GridIndex gmin, gmax;
     Grid3d::getGridIndexBounds(bbox, _dx, _isize, _jsize, _ksize, &gmin, &gmax);
@@ -234,23 +271,52 @@ void SpatialPointGrid::getConnectedPointComponents(double radius,
 
 void SpatialPointGrid::getConnectedPointReferenceComponents(double radius, 
                                                             std::vector<std::vector<GridPointReference> > &refsList) {
+    int numPoints = (int)_gridPoints.size();
+    if (numPoints == 0) {
+        return;
+    }
 
-    std::vector<bool> visitedRefs(_gridPoints.size(), false);
-    for (unsigned int refid = 0; refid < _gridPoints.size(); refid++) {
-        if (!visitedRefs[refid]) {
-            GridPointReference ref = GridPointReference(refid);
-            std::vector<GridPointReference> connectedRefs;
-            getConnectedPointReferences(ref, radius, connectedRefs);
-            refsList.push_back(connectedRefs);
-
-            for (unsigned int idx = 0; idx < connectedRefs.size(); idx++) {
-                visitedRefs[connectedRefs[idx].id] = true;
-            }
+    UnionFind pointSets(numPoints);
+
+    int numthreads = (int)fmin(ThreadUtils::getMaxThreadCount(), 
+                               ceil((double)numPoints / (double)_minQueriesPerThread));
+    numthreads = (int)fmax(numthreads, 1);
+
+    std::vector<std::thread> threads(numthreads);
+    std::vector<int> intervals = ThreadUtils::splitRangeIntoIntervals(0, numPoints, numthreads);
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&SpatialPointGrid::_unionConnectedPointReferencesThread, this,
+                                 intervals[i], intervals[i + 1], radius, &pointSets);
+    }
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
+
+    std::vector<std::vector<int> > components;
+    pointSets.getComponents(components);
+
+    refsList.reserve(refsList.size() + components.size());
+    for (unsigned int i = 0; i < components.size(); i++) {
+        std::vector<GridPointReference> refs;
+        refs.reserve(components[i].size());
+        for (unsigned int idx = 0; idx < components[i].size(); idx++) {
+            refs.push_back(GridPointReference(components[i][idx]));
         }
+        refsList.push_back(refs);
+
+        components[i].clear();
+        components[i].shrink_to_fit();
     }
 
 }
 
+unsigned int SpatialPointGrid::_getCellSortKey(GridIndex g) {
+    if (_isMortonCellOrderingEnabled) {
+        return _mortonLayout.getIndex(g.i, g.j, g.k);
+    }
+
+    return _getFlatIndex(g);
+}
 
 void SpatialPointGrid::_sortGridPointsByGridIndex(std::vector<vmath::vec3> &points,
                                                   std::vector<GridPoint> &sortedPoints,
@@ -269,7 +335,7 @@ void SpatialPointGrid::_sortGridPointsByGridIndex(std::vector<vmath::vec3> &poin
 
         ref = GridPointReference(i);
         gp = GridPoint(points[i], ref);
-        flatIndex = _getFlatIndex(Grid3d::positionToGridIndex(points[i], _dx));
+        flatIndex = _getCellSortKey(Grid3d::positionToGridIndex(points[i], _dx));
         pair = std::pair<GridPoint, unsigned int>(gp, flatIndex);
 
         pointIndexPairs.push_back(pair);
@@ -458,6 +524,147 @@ void SpatialPointGrid::_queryPointReferencesInsideSphere(vmath::vec3 p, double r
     }
 }
 
+/*
+    Queries are processed in the storage order of the grid cells that 
+    contain them so that neighbouring queries visit the same points. Each 
+    thread appends results to its own buffer, which are then copied into
+    the output in query order.
+*/
+void SpatialPointGrid::_batchQueryPointReferencesInsideSphere(std::vector<vmath::vec3> &queryPoints,
+                                                              std::vector<int> &queryRefIDs, 
+                                                              double r,
+                                                              std::vector<int> &offsets,
+                                                              std::vector<GridPointReference> &refs) {
+    assert(queryPoints.size() == queryRefIDs.size());
+
+    int numQueries = queryPoints.size();
+    offsets = std::vector<int>(numQueries + 1, 0);
+    refs.clear();
+    if (numQueries == 0) {
+        return;
+    }
+
+    std::vector<std::pair<unsigned int, int> > keys;
+    keys.reserve(numQueries);
+    GridIndex g;
+    for (int i = 0; i < numQueries; i++) {
+        g = Grid3d::positionToGridIndex(queryPoints[i], _dx);
+        g.i = std::max(0, std::min(g.i, _isize - 1));
+        g.j = std::max(0, std::min(g.j, _jsize - 1));
+        g.k = std::max(0, std::min(g.k, _ksize - 1));
+        keys.push_back(std::pair<unsigned int, int>(_getCellSortKey(g), i));
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<int> queryOrder;
+    queryOrder.reserve(numQueries);
+    for (int i = 0; i < numQueries; i++) {
+        queryOrder.push_back(keys[i].second);
+    }
+    keys.clear();
+    keys.shrink_to_fit();
+
+    int numthreads = (int)fmin(ThreadUtils::getMaxThreadCount(), 
+                               ceil((double)numQueries / (double)_minQueriesPerThread));
+    numthreads = (int)fmax(numthreads, 1);
+
+    std::vector<int> queryStarts(numQueries, 0);
+    std::vector<int> queryCounts(numQueries, 0);
+    std::vector<std::vector<GridPointReference> > threadRefs(numthreads);
+    std::vector<std::thread> threads(numthreads);
+    std::vector<int> intervals = ThreadUtils::splitRangeIntoIntervals(0, numQueries, numthreads);
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&SpatialPointGrid::_batchQueryPointReferencesInsideSphereThread, this,
+                                 intervals[i], intervals[i + 1], &queryOrder, &queryPoints, 
+                                 &queryRefIDs, r, &queryStarts, &queryCounts, &(threadRefs[i]));
+    }
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
+
+    for (int i = 0; i < numQueries; i++) {
+        offsets[i + 1] = offsets[i] + queryCounts[i];
+    }
+    refs.resize(offsets[numQueries]);
+
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&SpatialPointGrid::_scatterBatchQueryResultsThread, this,
+                                 intervals[i], intervals[i + 1], &queryOrder, &queryStarts, 
+                                 &queryCounts, &(threadRefs[i]), &offsets, &refs);
+    }
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
+}
+
+void SpatialPointGrid::_batchQueryPointReferencesInsideSphereThread(int startidx, int endidx, 
+                                                                    std::vector<int> *queryOrder,
+                                                                    std::vector<vmath::vec3> *queryPoints,
+                                                                    std::vector<int> *queryRefIDs, 
+                                                                    double r,
+                                                                    std::vector<int> *queryStarts,
+                                                                    std::vector<int> *queryCounts,
+                                                                    std::vector<GridPointReference> *threadRefs) {
+    for (int i = startidx; i < endidx; i++) {
+        int qidx = queryOrder->at(i);
+        int start = threadRefs->size();
+        _queryPointReferencesInsideSphere(queryPoints->at(qidx), r, queryRefIDs->at(qidx), *threadRefs);
+        (*queryStarts)[qidx] = start;
+        (*queryCounts)[qidx] = threadRefs->size() - start;
+    }
+}
+
+void SpatialPointGrid::_scatterBatchQueryResultsThread(int startidx, int endidx, 
+                                                       std::vector<int> *queryOrder,
+                                                       std::vector<int> *queryStarts,
+                                                       std::vector<int> *queryCounts,
+                                                       std::vector<GridPointReference> *threadRefs,
+                                                       std::vector<int> *offsets,
+                                                       std::vector<GridPointReference> *refs) {
+    for (int i = startidx; i < endidx; i++) {
+        int qidx = queryOrder->at(i);
+        std::vector<GridPointReference>::iterator begin = threadRefs->begin() + (*queryStarts)[qidx];
+        std::copy(begin, begin + (*queryCounts)[qidx], refs->begin() + (*offsets)[qidx]);
+    }
+}
+
+void SpatialPointGrid::_unionConnectedPointReferencesThread(int startidx, int endidx, 
+                                                            double radius,
+                                                            UnionFind *pointSets) {
+    // Each pair of points only needs to be tested once, so the point at
+    // index idx is only compared against points stored after it
+    double maxdistsq = radius*radius;
+    GridIndex gmin, gmax;
+    GridPoint gp, np;
+    CellNode node;
+    vmath::vec3 v;
+    for (int idx = startidx; idx < endidx; idx++) {
+        gp = _gridPoints[idx];
+        Grid3d::getGridIndexBounds(gp.position, radius, _dx, 
+                                   _isize, _jsize, _ksize, &gmin, &gmax);
+
+        for (int k = gmin.k; k <= gmax.k; k++) {
+            for (int j = gmin.j; j <= gmax.j; j++) {
+                for (int i = gmin.i; i <= gmax.i; i++) {
+                    node = _grid(i, j, k);
+                    if (node.count <= 0 || node.start + node.count <= idx + 1) {
+                        continue;
+                    }
+
+                    for (int nidx = std::max(node.start, idx + 1); 
+                             nidx < node.start + node.count; nidx++) {
+                        np = _gridPoints[nidx];
+                        v = np.position - gp.position;
+                        if (vmath::dot(v, v) < maxdistsq) {
+                            pointSets->unionElements(gp.ref.id, np.ref.id);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
 void SpatialPointGrid::_getConnectedPoints(GridPointReference seed, double radius, 
                                            std::vector<vmath::vec3> &points) {
 
@@ -24,12 +24,16 @@ freely, subject to the following restrictions:
 #include <stdio.h>
 #include <iostream>
 #include <algorithm>
+#include <thread>
 
 #include "array3d.h"
 #include "aabb.h"
 #include "fragmentedvector.h"
 #include "grid3d.h"
 #include "vmath.h"
+#include "gridlayout.h"
+#include "threadutils.h"
+#include "unionfind.h"
 
 struct GridPointReference {
     int id;
@@ -78,6 +82,31 @@ public:
                                           std::vector<bool> &exclusions,
                                           std::vector<GridPointReference> &refs);
 
+    /*
+        Batched sphere queries that run in parallel. The references to the 
+        points within radius r of query i are returned in compressed row 
+        format over the range refs[offsets[i]] to refs[offsets[i + 1] - 1].
+        Queries by reference do not include the query point.
+    */
+    void queryPointReferencesInsideSphere(std::vector<vmath::vec3> &queryPoints, double r,
+                                          std::vector<int> &offsets,
+                                          std::vector<GridPointReference> &refs);
+    void queryPointReferencesInsideSphere(std::vector<GridPointReference> &queryRefs, double r,
+                                          std::vector<int> &offsets,
+                                          std::vector<GridPointReference> &refs);
+
+    /*
+        Enable/disable storing points in the Z-order of their grid cells 
+        instead of row-major order. Points in neighbouring cells are closer
+        in memory, which can improve the cache locality of sphere queries.
+        Takes effect on the next insert.
+
+        Disabled by default.
+    */
+    void enableMortonCellOrdering();
+    void disableMortonCellOrdering();
+    bool isMortonCellOrderingEnabled();
+
     void queryPointsInsideAABB(AABB bbox, std::vector<vmath::vec3> &points);
     void queryPointReferencesInsideAABB(AABB bbox, std::vector<GridPointReference> &refs);
 
@@ -85,6 +114,13 @@ public:
     void getConnectedPointReferences(vmath::vec3 seed, double radius, std::vector<GridPointReference> &refs);
     void getConnectedPoints(GridPointReference seed, double radius, std::vector<vmath::vec3> &points);
     void getConnectedPointReferences(GridPointReference seed, double radius, std::vector<GridPointReference> &refs);
+
+    /*
+        Groups all points into the components that are connected by chains
+        of points within radius of each other. Components are labelled in 
+        parallel with a union-find pass and are ordered by their smallest 
+        reference id, with the references of a component in ascending order.
+    */
     void getConnectedPointComponents(double radius, std::vector<std::vector<vmath::vec3> > &points);
     void getConnectedPointReferenceComponents(double radius, std::vector<std::vector<GridPointReference> > &refs);
 
@@ -110,6 +146,7 @@ private:
                ((unsigned int)g.j + (unsigned int)_jsize * (unsigned int)g.k);
     }
 
+    unsigned int _getCellSortKey(GridIndex g);
     void _sortGridPointsByGridIndex(std::vector<vmath::vec3> &points,
                                     std::vector<GridPoint> &sortedPoints,
                                     std::vector<GridPointReference> &refList);
@@ -124,6 +161,28 @@ private:
     void _queryPointReferencesInsideSphere(vmath::vec3 p, double r, std::vector<bool> &exclusions, 
                                            std::vector<GridPointReference> &refs);
 
+    void _batchQueryPointReferencesInsideSphere(std::vector<vmath::vec3> &queryPoints,
+                                                std::vector<int> &queryRefIDs, double r,
+                                                std::vector<int> &offsets,
+                                                std::vector<GridPointReference> &refs);
+    void _batchQueryPointReferencesInsideSphereThread(int startidx, int endidx, 
+                                                      std::vector<int> *queryOrder,
+                                                      std::vector<vmath::vec3> *queryPoints,
+                                                      std::vector<int> *queryRefIDs, double r,
+                                                      std::vector<int> *queryStarts,
+                                                      std::vector<int> *queryCounts,
+                                                      std::vector<GridPointReference> *threadRefs);
+    void _scatterBatchQueryResultsThread(int startidx, int endidx, 
+                                         std::vector<int> *queryOrder,
+                                         std::vector<int> *queryStarts,
+                                         std::vector<int> *queryCounts,
+                                         std::vector<GridPointReference> *threadRefs,
+                                         std::vector<int> *offsets,
+                                         std::vector<GridPointReference> *refs);
+
+    void _unionConnectedPointReferencesThread(int startidx, int endidx, double radius,
+                                              UnionFind *pointSets);
+
     void _getConnectedPoints(GridPointReference seed, double radius, 
                              std::vector<vmath::vec3> &points);
     void _getConnectedPointReferences(GridPointReference seed, double radius, 
@@ -138,6 +197,10 @@ private:
     std::vector<int> _refIDToGridPointIndexTable;
     Array3d<CellNode> _grid;
     AABB _bbox;
+
+    bool _isMortonCellOrderingEnabled = false;
+    MortonLayout _mortonLayout;
+    int _minQueriesPerThread = 2000;
 };
 
 #endif
\ No newline at end of file
@@ -26,7 +26,12 @@ freely, subject to the following restrictions:
 #include "gridindexvector.h"
 #include "array3d.h"
 
-template <class T>
+/*
+    Cells are stored in a grid of type Grid, an Array3d by default. Any grid 
+    with the same element access methods, such as a SparseArray3d, may be 
+    used instead.
+*/
+template <class T, class Layout = RowMajorLayout, class Grid = Array3d<T, Layout> >
 class SubdividedArray3d
 {
 public:
@@ -154,7 +159,7 @@ public:
     }
 
     bool isOutOfRangeValueSet() {
-        return _grid.isOutOfRangeValueSet;
+        return _grid.isOutOfRangeValueSet();
     }
     T getOutOfRangeValue() {
         return _grid.getOutOfRangeValue();
@@ -170,7 +175,7 @@ private:
     int _jsize = 0;
     int _ksize = 0;
 
-    Array3d<T> _grid;
+    Grid _grid;
     unsigned int _sublevel = 1;
      double _invsublevel = 1;
 
@@ -0,0 +1,103 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "threadutils.h"
+
+namespace ThreadUtils {
+
+static int _maxThreadCount = 0;
+
+static int _getHardwareThreadCount() {
+    int n = (int)std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+}
+
+int ThreadUtils::getMaxThreadCount() {
+    if (_maxThreadCount <= 0) {
+        return _getHardwareThreadCount();
+    }
+
+    return _maxThreadCount;
+}
+
+void ThreadUtils::setMaxThreadCount(int n) {
+    _maxThreadCount = n;
+}
+
+std::vector<int> ThreadUtils::splitRangeIntoIntervals(int rangeBegin, int rangeEnd, 
+                                                      int numIntervals) {
+    assert(rangeBegin <= rangeEnd);
+    assert(numIntervals > 0);
+
+    int rangeSize = rangeEnd - rangeBegin;
+    int intervalSize = rangeSize / numIntervals;
+    int intervalRemainder = rangeSize % numIntervals;
+
+    std::vector<int> intervals;
+    intervals.reserve(numIntervals + 1);
+    intervals.push_back(rangeBegin);
+
+    int current = rangeBegin;
+    for (int i = 0; i < numIntervals; i++) {
+        current += intervalSize;
+        if (i < intervalRemainder) {
+            current++;
+        }
+        intervals.push_back(current);
+    }
+
+    return intervals;
+}
+
+void ThreadUtils::getThreadInterval(int rangeBegin, int rangeEnd, 
+                                    int threadIndex, int numThreads,
+                                    int *begin, int *end) {
+    assert(rangeBegin <= rangeEnd);
+    assert(threadIndex >= 0 && threadIndex < numThreads);
+
+    int rangeSize = rangeEnd - rangeBegin;
+    int intervalSize = rangeSize / numThreads;
+    int intervalRemainder = rangeSize % numThreads;
+
+    *begin = rangeBegin + threadIndex*intervalSize + 
+             (int)fmin(threadIndex, intervalRemainder);
+    *end = *begin + intervalSize + (threadIndex < intervalRemainder ? 1 : 0);
+}
+
+ThreadUtils::Barrier::Barrier(int numThreads) : _numThreads(numThreads),
+                                                _count(0),
+                                                _generation(0) {
+    assert(numThreads > 0);
+}
+
+void ThreadUtils::Barrier::wait() {
+    int generation = _generation.load(std::memory_order_acquire);
+    if (_count.fetch_add(1, std::memory_order_acq_rel) + 1 == _numThreads) {
+        _count.store(0, std::memory_order_relaxed);
+        _generation.fetch_add(1, std::memory_order_acq_rel);
+        return;
+    }
+
+    while (_generation.load(std::memory_order_acquire) == generation) {
+        std::this_thread::yield();
+    }
+}
@@ -0,0 +1,81 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef THREADUTILS_H
+#define THREADUTILS_H
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+
+namespace ThreadUtils {
+
+    /*
+        Returns the number of threads that multithreaded methods will spread
+        their work across. Defaults to the number of hardware threads.
+    */
+    extern int getMaxThreadCount();
+
+    /*
+        Override the number of threads used by multithreaded methods. A value
+        less than one will reset the count to the hardware default.
+    */
+    extern void setMaxThreadCount(int n);
+
+    /*
+        Splits the range [rangeBegin, rangeEnd) into numIntervals intervals of
+        near equal size. The returned vector contains numIntervals + 1 values
+        where interval i ranges over [intervals[i], intervals[i + 1]).
+    */
+    extern std::vector<int> splitRangeIntoIntervals(int rangeBegin, int rangeEnd, 
+                                                    int numIntervals);
+
+    /*
+        Returns the interval [*begin, *end) of [rangeBegin, rangeEnd) that
+        belongs to thread threadIndex when the range is split into numThreads
+        intervals. Matches the intervals of splitRangeIntoIntervals without
+        allocating.
+    */
+    extern void getThreadInterval(int rangeBegin, int rangeEnd, 
+                                  int threadIndex, int numThreads,
+                                  int *begin, int *end);
+
+    /*
+        Reusable barrier for a fixed group of threads. Waiting threads spin 
+        and yield, so the barrier is intended for the short waits between 
+        phases of a parallel computation.
+    */
+    class Barrier
+    {
+    public:
+        Barrier(int numThreads);
+        void wait();
+
+    private:
+        int _numThreads = 1;
+        std::atomic<int> _count;
+        std::atomic<int> _generation;
+    };
+}
+
+#endif
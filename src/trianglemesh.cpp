@@ -815,10 +815,11 @@ void TriangleMesh::_floodfill(GridIndex g, Array3d<bool> &cells) {
         return;
     }
 
-    Array3d<bool> isCellDone = Array3d<bool>(_gridi, _gridj, _gridk, false);
+    // Cells are marked as they are queued so that the filled grid doubles
+    // as the visited set
     std::queue<GridIndex> queue;
     queue.push(g);
-    isCellDone.set(g, true);
+    cells.set(g, true);
 
     GridIndex gp;
     GridIndex ns[6];
@@ -829,13 +830,11 @@ void TriangleMesh::_floodfill(GridIndex g, Array3d<bool> &cells) {
         Grid3d::getNeighbourGridIndices6(gp, ns);
         for (int i = 0; i < 6; i++) {
             if (Grid3d::isGridIndexInRange(ns[i], _gridi, _gridj, _gridk) && 
-                    !cells(ns[i]) && !isCellDone(ns[i])) {
-                isCellDone.set(ns[i], true);
+                    !cells(ns[i])) {
+                cells.set(ns[i], true);
                 queue.push(ns[i]);
             }
         }
-
-        cells.set(gp, true);
     }
 }
 
@@ -1107,46 +1106,88 @@ void TriangleMesh::getCellsInsideMesh(GridIndexVector &cells) {
     _destroyTriangleGrid();
 }
 
-void TriangleMesh::_smoothTriangleMesh(double value, std::vector<bool> &isSmooth) {
-    std::vector<vmath::vec3> newvertices;
-    newvertices.reserve(vertices.size());
+/*
+    Vertex adjacency in compressed row format. The neighbours of vertex i 
+    are neighbours[offsets[i]] to neighbours[offsets[i + 1] - 1]. A vertex 
+    is listed once for each triangle that it shares with vertex i, in 
+    triangle order, so that the Laplacian average weights neighbours in 
+    the same way as averaging over the vertex triangles.
+*/
+void TriangleMesh::_getVertexNeighbourList(std::vector<int> &offsets, 
+                                           std::vector<int> &neighbours) {
+    offsets = std::vector<int>(vertices.size() + 1, 0);
 
-    vmath::vec3 v;
-    vmath::vec3 nv;
-    vmath::vec3 avg;
     Triangle t;
-    for (unsigned int i = 0; i < vertices.size(); i++) {
+    for (unsigned int tidx = 0; tidx < triangles.size(); tidx++) {
+        t = triangles[tidx];
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                if (t.tri[j] != t.tri[i]) {
+                    offsets[t.tri[i] + 1]++;
+                }
+            }
+        }
+    }
 
-        if (!isSmooth[i]) {
-            newvertices.push_back(vertices[i]);
-            continue;
+    for (unsigned int i = 0; i < vertices.size(); i++) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    neighbours = std::vector<int>(offsets[vertices.size()]);
+    std::vector<int> counts(vertices.size(), 0);
+    for (unsigned int tidx = 0; tidx < triangles.size(); tidx++) {
+        t = triangles[tidx];
+        for (int i = 0; i < 3; i++) {
+            int vidx = t.tri[i];
+            for (int j = 0; j < 3; j++) {
+                if (t.tri[j] != vidx) {
+                    neighbours[offsets[vidx] + counts[vidx]] = t.tri[j];
+                    counts[vidx]++;
+                }
+            }
         }
+    }
+}
 
-        int count = 0;
-        avg = vmath::vec3();
-        for (unsigned int j = 0; j < _vertexTriangles[i].size(); j++) {
-            t = triangles[_vertexTriangles[i][j]];
-            if (t.tri[0] != (int)i) {
-                avg += vertices[t.tri[0]];
-                count++;
+void TriangleMesh::_smoothTriangleMeshThread(int startidx, int endidx, 
+                                             double value, int iterations,
+                                             std::vector<bool> *isSmooth,
+                                             std::vector<int> *offsets,
+                                             std::vector<int> *neighbours,
+                                             std::vector<vmath::vec3> *buffer,
+                                             ThreadUtils::Barrier *barrier) {
+    std::vector<vmath::vec3> *src = &vertices;
+    std::vector<vmath::vec3> *dst = buffer;
+
+    vmath::vec3 v;
+    vmath::vec3 avg;
+    for (int n = 0; n < iterations; n++) {
+        for (int i = startidx; i < endidx; i++) {
+            if (!(*isSmooth)[i]) {
+                continue;
             }
-            if (t.tri[1] != (int)i) {
-                avg += vertices[t.tri[1]];
-                count++;
+
+            int start = (*offsets)[i];
+            int end = (*offsets)[i + 1];
+            if (start == end) {
+                continue;
             }
-            if (t.tri[2] != (int)i) {
-                avg += vertices[t.tri[2]];
-                count++;
+
+            avg = vmath::vec3();
+            for (int nidx = start; nidx < end; nidx++) {
+                avg += (*src)[(*neighbours)[nidx]];
             }
+
+            avg /= (float)(end - start);
+            v = (*src)[i];
+            (*dst)[i] = v + (float)value * (avg - v);
         }
 
-        avg /= (float)count;
-        v = vertices[i];
-        nv = v + (float)value * (avg - v);
-        newvertices.push_back(nv);
+        // All threads must finish reading src before it is overwritten in 
+        // the next iteration
+        barrier->wait();
+        std::swap(src, dst);
     }
-
-    vertices = newvertices;
 }
 
 void TriangleMesh::_getBoolVectorOfSmoothedVertices(std::vector<int> &verts, 
@@ -1176,12 +1217,36 @@ void TriangleMesh::smooth(double value, int iterations,
     std::vector<bool> isVertexSmooth;
     _getBoolVectorOfSmoothedVertices(verts, isVertexSmooth);
 
-    _vertexTriangles.clear();
-    _updateVertexTriangles();
-    for (int i = 0; i < iterations; i++) {
-        _smoothTriangleMesh(value, isVertexSmooth);
+    int numVertices = (int)vertices.size();
+    if (iterations > 0 && numVertices > 0) {
+        std::vector<int> offsets;
+        std::vector<int> neighbours;
+        _getVertexNeighbourList(offsets, neighbours);
+
+        // Vertices that are not smoothed never change, so they only need
+        // to be copied into the second buffer once
+        std::vector<vmath::vec3> buffer = vertices;
+
+        int numthreads = (int)fmin(ThreadUtils::getMaxThreadCount(), 
+                                   ceil((double)numVertices / (double)_minVerticesPerThread));
+        numthreads = (int)fmax(numthreads, 1);
+
+        ThreadUtils::Barrier barrier(numthreads);
+        std::vector<std::thread> threads(numthreads);
+        std::vector<int> intervals = ThreadUtils::splitRangeIntoIntervals(0, numVertices, numthreads);
+        for (int i = 0; i < numthreads; i++) {
+            threads[i] = std::thread(&TriangleMesh::_smoothTriangleMeshThread, this,
+                                     intervals[i], intervals[i + 1], value, iterations,
+                                     &isVertexSmooth, &offsets, &neighbours, &buffer, &barrier);
+        }
+        for (int i = 0; i < numthreads; i++) {
+            threads[i].join();
+        }
+
+        if (iterations % 2 == 1) {
+            vertices.swap(buffer);
+        }
     }
-    _vertexTriangles.clear();
 
     updateVertexNormals();
 }
@@ -1205,49 +1270,52 @@ void TriangleMesh::clearTriangleAreas() {
     _triangleAreas.clear();
 }
 
-void TriangleMesh::_getPolyhedronFromTriangle(int tidx, 
-                                              std::vector<bool> &visitedTriangles,
-                                              std::vector<int> &polyhedron) {
-
-    assert(!visitedTriangles[tidx]);
-
-    std::vector<int> queue;
-    queue.push_back(tidx);
-    visitedTriangles[tidx] = true;
+void TriangleMesh::_unionTriangleVerticesThread(int startidx, int endidx, 
+                                                UnionFind *vertexSets) {
+    Triangle t;
+    for (int i = startidx; i < endidx; i++) {
+        t = triangles[i];
+        vertexSets->unionElements(t.tri[0], t.tri[1]);
+        vertexSets->unionElements(t.tri[0], t.tri[2]);
+    }
+}
 
-    std::vector<int> neighbours;
-    while (!queue.empty()) {
-        int t = queue.back();
-        queue.pop_back();
+void TriangleMesh::_getPolyhedra(std::vector<std::vector<int> > &polyList) {
+    int numTriangles = (int)triangles.size();
+    if (numTriangles == 0) {
+        return;
+    }
 
-        neighbours.clear();
-        getFaceNeighbours(t, neighbours);
-        for (unsigned int i = 0; i < neighbours.size(); i++) {
-            int n = neighbours[i];
+    // Triangles that share a vertex belong to the same polyhedron, so the
+    // polyhedra are the connected components of the vertex graph
+    UnionFind vertexSets((int)vertices.size());
 
-            if (!visitedTriangles[n]) {
-                queue.push_back(n);
-                visitedTriangles[n] = true;
-            }
-        }
+    int numthreads = (int)fmin(ThreadUtils::getMaxThreadCount(), 
+                               ceil((double)numTriangles / (double)_minTrianglesPerThread));
+    numthreads = (int)fmax(numthreads, 1);
 
-        polyhedron.push_back(t);
+    std::vector<std::thread> threads(numthreads);
+    std::vector<int> intervals = ThreadUtils::splitRangeIntoIntervals(0, numTriangles, numthreads);
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&TriangleMesh::_unionTriangleVerticesThread, this,
+                                 intervals[i], intervals[i + 1], &vertexSets);
+    }
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
     }
-}
 
-void TriangleMesh:: _getPolyhedra(std::vector<std::vector<int> > &polyList) {
-    updateVertexTriangles();
+    std::vector<int> vertexLabels;
+    int numLabels = vertexSets.getComponentLabels(vertexLabels);
 
-    std::vector<bool> visitedTriangles = std::vector<bool>(triangles.size(), false);
-    for (unsigned int i = 0; i < visitedTriangles.size(); i++) {
-        if (!visitedTriangles[i]) {
-            std::vector<int> polyhedron;
-            _getPolyhedronFromTriangle(i, visitedTriangles, polyhedron);
-            polyList.push_back(polyhedron);
+    std::vector<int> polyIndices(numLabels, -1);
+    for (int i = 0; i < numTriangles; i++) {
+        int label = vertexLabels[triangles[i].tri[0]];
+        if (polyIndices[label] == -1) {
+            polyIndices[label] = (int)polyList.size();
+            polyList.push_back(std::vector<int>());
         }
+        polyList[polyIndices[label]].push_back(i);
     }
-
-    clearVertexTriangles();
 }
 
 double TriangleMesh::_getSignedTriangleVolume(unsigned int tidx) {
@@ -28,6 +28,7 @@ freely, subject to the following restrictions:
 #include <string.h>
 #include <algorithm>
 #include <assert.h>
+#include <thread>
 
 #include "triangle.h"
 #include "array3d.h"
@@ -37,11 +38,17 @@ freely, subject to the following restrictions:
 #include "vmath.h"
 #include "gridindexvector.h"
 #include "spatialpointgrid.h"
+#include "threadutils.h"
+#include "unionfind.h"
 
 class TriangleMesh
 {
 public:
     TriangleMesh();
+    TriangleMesh(const TriangleMesh &obj) = default;
+    TriangleMesh(TriangleMesh &&obj) = default;
+    TriangleMesh& operator=(const TriangleMesh &rhs) = default;
+    TriangleMesh& operator=(TriangleMesh &&rhs) = default;
     ~TriangleMesh();
 
     bool loadOBJ(std::string OBJFilename) {
@@ -127,15 +134,19 @@ private:
     void _destroyTriangleGrid();
     void _getTriangleGridCellOverlap(Triangle t, GridIndexVector &cells);
     void _getSurfaceCells(GridIndexVector &cells);
-    void _smoothTriangleMesh(double value, std::vector<bool> &isSmooth);
+    void _getVertexNeighbourList(std::vector<int> &offsets, std::vector<int> &neighbours);
+    void _smoothTriangleMeshThread(int startidx, int endidx, double value, int iterations,
+                                   std::vector<bool> *isSmooth,
+                                   std::vector<int> *offsets,
+                                   std::vector<int> *neighbours,
+                                   std::vector<vmath::vec3> *buffer,
+                                   ThreadUtils::Barrier *barrier);
     void _getBoolVectorOfSmoothedVertices(std::vector<int> &verts, 
                                           std::vector<bool> &isSmooth);
     int _numDigitsInInteger(int num);
 
     void _getPolyhedra(std::vector<std::vector<int> > &polyList);
-    void _getPolyhedronFromTriangle(int triangle, 
-                                    std::vector<bool> &visitedTriangles,
-                                    std::vector<int> &polyhedron);
+    void _unionTriangleVerticesThread(int startidx, int endidx, UnionFind *vertexSets);
     double _getSignedTriangleVolume(unsigned int tidx);
     double _getPolyhedronVolume(std::vector<int> &polyhedron);
     bool _isPolyhedronHole(std::vector<int> &poly);
@@ -163,6 +174,9 @@ private:
     std::vector<double> _triangleAreas;
 
     Array3d<std::vector<int>> _triGrid;
+
+    int _minTrianglesPerThread = 20000;
+    int _minVerticesPerThread = 20000;
 };
 
 #endif
@@ -0,0 +1,192 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "tricubickernels.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+    #define TRICUBICKERNELS_X86_SIMD 1
+    #include <immintrin.h>
+#else
+    #define TRICUBICKERNELS_X86_SIMD 0
+#endif
+
+namespace TricubicKernels {
+
+/* 
+    Catmull-Rom weights. For samples p[0..3], 
+
+        cubic_interpolate(p, x) = w[0]*p[0] + w[1]*p[1] + w[2]*p[2] + w[3]*p[3]
+
+    which allows the 64 point stencil to be evaluated as a separable 
+    weighted sum.
+*/
+static inline void _getCubicWeights(float x, float w[4]) {
+    float x2 = x*x;
+    float x3 = x2*x;
+    w[0] = 0.5f*(-x + 2.0f*x2 - x3);
+    w[1] = 1.0f + 0.5f*(-5.0f*x2 + 3.0f*x3);
+    w[2] = 0.5f*(x + 4.0f*x2 - 3.0f*x3);
+    w[3] = 0.5f*(-x2 + x3);
+}
+
+}
+
+float TricubicKernels::interpolateScalar(const float *data, int jstride, int kstride,
+                                         float x, float y, float z) {
+    float wx[4], wy[4], wz[4];
+    _getCubicWeights(x, wx);
+    _getCubicWeights(y, wy);
+    _getCubicWeights(z, wz);
+
+    float sum = 0.0f;
+    for (int k = 0; k < 4; k++) {
+        float sumk = 0.0f;
+        for (int j = 0; j < 4; j++) {
+            const float *row = data + j*jstride + k*kstride;
+            float sumj = wx[0]*row[0] + wx[1]*row[1] + wx[2]*row[2] + wx[3]*row[3];
+            sumk += wy[j]*sumj;
+        }
+        sum += wz[k]*sumk;
+    }
+
+    return sum;
+}
+
+#if TRICUBICKERNELS_X86_SIMD
+
+/*
+    Each 4-wide row of the stencil is loaded into a 128-bit lane. The AVX2 
+    kernel evaluates two k-slices per instruction and the AVX-512 kernel 
+    evaluates all four k-slices per instruction.
+*/
+__attribute__((target("avx2,fma")))
+float TricubicKernels::interpolateAVX2(const float *data, int jstride, int kstride,
+                                       float x, float y, float z) {
+    float wx[4], wy[4], wz[4];
+    _getCubicWeights(x, wx);
+    _getCubicWeights(y, wy);
+    _getCubicWeights(z, wz);
+
+    __m256 acc01 = _mm256_setzero_ps();
+    __m256 acc23 = _mm256_setzero_ps();
+    for (int j = 0; j < 4; j++) {
+        const float *row = data + j*jstride;
+        __m256 wyj = _mm256_set1_ps(wy[j]);
+        __m256 r01 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(row)),
+                                          _mm_loadu_ps(row + kstride), 1);
+        __m256 r23 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(row + 2*kstride)),
+                                          _mm_loadu_ps(row + 3*kstride), 1);
+        acc01 = _mm256_fmadd_ps(wyj, r01, acc01);
+        acc23 = _mm256_fmadd_ps(wyj, r23, acc23);
+    }
+
+    __m256 wz01 = _mm256_set_ps(wz[1], wz[1], wz[1], wz[1], wz[0], wz[0], wz[0], wz[0]);
+    __m256 wz23 = _mm256_set_ps(wz[3], wz[3], wz[3], wz[3], wz[2], wz[2], wz[2], wz[2]);
+    __m256 sum = _mm256_fmadd_ps(acc23, wz23, _mm256_mul_ps(acc01, wz01));
+
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+    s = _mm_mul_ps(s, _mm_loadu_ps(wx));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 0x55));
+
+    return _mm_cvtss_f32(s);
+}
+
+// GCC's AVX-512 reduction intrinsics trigger a false -Wuninitialized warning
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+
+__attribute__((target("avx512f")))
+float TricubicKernels::interpolateAVX512(const float *data, int jstride, int kstride,
+                                         float x, float y, float z) {
+    float wx[4], wy[4], wz[4];
+    _getCubicWeights(x, wx);
+    _getCubicWeights(y, wy);
+    _getCubicWeights(z, wz);
+
+    __m512 acc = _mm512_setzero_ps();
+    for (int j = 0; j < 4; j++) {
+        const float *row = data + j*jstride;
+        __m512 r = _mm512_castps128_ps512(_mm_loadu_ps(row));
+        r = _mm512_insertf32x4(r, _mm_loadu_ps(row + kstride), 1);
+        r = _mm512_insertf32x4(r, _mm_loadu_ps(row + 2*kstride), 2);
+        r = _mm512_insertf32x4(r, _mm_loadu_ps(row + 3*kstride), 3);
+        acc = _mm512_fmadd_ps(_mm512_set1_ps(wy[j]), r, acc);
+    }
+
+    __m512 wxz = _mm512_set_ps(wz[3]*wx[3], wz[3]*wx[2], wz[3]*wx[1], wz[3]*wx[0],
+                               wz[2]*wx[3], wz[2]*wx[2], wz[2]*wx[1], wz[2]*wx[0],
+                               wz[1]*wx[3], wz[1]*wx[2], wz[1]*wx[1], wz[1]*wx[0],
+                               wz[0]*wx[3], wz[0]*wx[2], wz[0]*wx[1], wz[0]*wx[0]);
+
+    return _mm512_reduce_add_ps(_mm512_mul_ps(acc, wxz));
+}
+
+#pragma GCC diagnostic pop
+
+bool TricubicKernels::isAVX2Supported() {
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+bool TricubicKernels::isAVX512Supported() {
+    return __builtin_cpu_supports("avx512f");
+}
+
+#else
+
+float TricubicKernels::interpolateAVX2(const float *data, int jstride, int kstride,
+                                       float x, float y, float z) {
+    return interpolateScalar(data, jstride, kstride, x, y, z);
+}
+
+float TricubicKernels::interpolateAVX512(const float *data, int jstride, int kstride,
+                                         float x, float y, float z) {
+    return interpolateScalar(data, jstride, kstride, x, y, z);
+}
+
+bool TricubicKernels::isAVX2Supported() {
+    return false;
+}
+
+bool TricubicKernels::isAVX512Supported() {
+    return false;
+}
+
+#endif
+
+TricubicKernels::InterpolationKernel TricubicKernels::getInterpolationKernel() {
+    if (isAVX512Supported()) {
+        return interpolateAVX512;
+    } else if (isAVX2Supported()) {
+        return interpolateAVX2;
+    }
+
+    return interpolateScalar;
+}
+
+std::string TricubicKernels::getInterpolationKernelName() {
+    if (isAVX512Supported()) {
+        return "AVX-512";
+    } else if (isAVX2Supported()) {
+        return "AVX2";
+    }
+
+    return "SCALAR";
+}
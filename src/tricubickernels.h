@@ -0,0 +1,56 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef TRICUBICKERNELS_H
+#define TRICUBICKERNELS_H
+
+#include <string>
+#include <math.h>
+
+/*
+    Tricubic interpolation kernels used by the native ParticleAdvector 
+    backend. Each kernel interpolates the 4x4x4 block of values beginning
+    at data[0], where consecutive i values are adjacent in memory, consecutive
+    j values are jstride apart and consecutive k values are kstride apart.
+    x, y, z are in [0,1] and the volume between the second and third sample 
+    in each dimension is interpolated, matching tricubicinterpolate.cl.
+
+    The best kernel supported by the host CPU is selected at runtime.
+*/
+namespace TricubicKernels {
+
+    typedef float (*InterpolationKernel)(const float *data, 
+                                         int jstride, int kstride,
+                                         float x, float y, float z);
+
+    extern float interpolateScalar(const float *data, int jstride, int kstride,
+                                   float x, float y, float z);
+    extern float interpolateAVX2(const float *data, int jstride, int kstride,
+                                 float x, float y, float z);
+    extern float interpolateAVX512(const float *data, int jstride, int kstride,
+                                   float x, float y, float z);
+
+    extern bool isAVX2Supported();
+    extern bool isAVX512Supported();
+
+    extern InterpolationKernel getInterpolationKernel();
+    extern std::string getInterpolationKernelName();
+}
+
+#endif
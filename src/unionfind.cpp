@@ -0,0 +1,160 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#include "unionfind.h"
+
+UnionFind::UnionFind() {
+}
+
+UnionFind::UnionFind(int size) {
+    reset(size);
+}
+
+UnionFind::~UnionFind() {
+}
+
+void UnionFind::reset(int size) {
+    assert(size >= 0);
+    _parents = std::vector<std::atomic<int> >(size);
+    for (int i = 0; i < size; i++) {
+        _parents[i].store(i, std::memory_order_relaxed);
+    }
+}
+
+int UnionFind::size() {
+    return (int)_parents.size();
+}
+
+int UnionFind::findRoot(int idx) {
+    assert(idx >= 0 && idx < (int)_parents.size());
+
+    // Path halving. A failed exchange only means another thread has 
+    // already moved idx closer to the root.
+    int parent = _parents[idx].load();
+    while (parent != idx) {
+        int grandparent = _parents[parent].load();
+        if (grandparent != parent) {
+            int expected = parent;
+            _parents[idx].compare_exchange_weak(expected, grandparent);
+        }
+        idx = parent;
+        parent = grandparent;
+    }
+
+    return idx;
+}
+
+void UnionFind::unionElements(int idx1, int idx2) {
+    for (;;) {
+        idx1 = findRoot(idx1);
+        idx2 = findRoot(idx2);
+        if (idx1 == idx2) {
+            return;
+        }
+
+        if (idx1 > idx2) {
+            std::swap(idx1, idx2);
+        }
+
+        // Link the larger root under the smaller. Retry if another thread 
+        // has linked idx2 in the meantime.
+        int expected = idx2;
+        if (_parents[idx2].compare_exchange_strong(expected, idx1)) {
+            return;
+        }
+    }
+}
+
+bool UnionFind::isConnected(int idx1, int idx2) {
+    for (;;) {
+        idx1 = findRoot(idx1);
+        idx2 = findRoot(idx2);
+        if (idx1 == idx2) {
+            return true;
+        }
+
+        // idx1 is still a root, so the sets were disjoint at this point
+        if (_parents[idx1].load() == idx1) {
+            return false;
+        }
+    }
+}
+
+int UnionFind::getComponentLabels(std::vector<int> &labels) {
+    int n = (int)_parents.size();
+    labels = std::vector<int>(n, -1);
+    if (n == 0) {
+        return 0;
+    }
+
+    int numthreads = (int)fmin(ThreadUtils::getMaxThreadCount(), 
+                               ceil((double)n / (double)_minElementsPerThread));
+    numthreads = (int)fmax(numthreads, 1);
+
+    std::vector<std::thread> threads(numthreads);
+    std::vector<int> intervals = ThreadUtils::splitRangeIntoIntervals(0, n, numthreads);
+    for (int i = 0; i < numthreads; i++) {
+        threads[i] = std::thread(&UnionFind::_findRootsThread, this,
+                                 intervals[i], intervals[i + 1], &labels);
+    }
+    for (int i = 0; i < numthreads; i++) {
+        threads[i].join();
+    }
+
+    // A root is the smallest element of its set, so it is always visited 
+    // before the other elements that refer to it.
+    int numComponents = 0;
+    for (int i = 0; i < n; i++) {
+        int root = labels[i];
+        if (root == i) {
+            labels[i] = numComponents;
+            numComponents++;
+        } else {
+            labels[i] = labels[root];
+        }
+    }
+
+    return numComponents;
+}
+
+void UnionFind::getComponents(std::vector<std::vector<int> > &components) {
+    std::vector<int> labels;
+    int numComponents = getComponentLabels(labels);
+
+    std::vector<int> counts(numComponents, 0);
+    for (unsigned int i = 0; i < labels.size(); i++) {
+        counts[labels[i]]++;
+    }
+
+    int offset = (int)components.size();
+    components.resize(offset + numComponents);
+    for (int i = 0; i < numComponents; i++) {
+        components[offset + i].reserve(counts[i]);
+    }
+
+    for (unsigned int i = 0; i < labels.size(); i++) {
+        components[offset + labels[i]].push_back(i);
+    }
+}
+
+void UnionFind::_findRootsThread(int startidx, int endidx, std::vector<int> *roots) {
+    for (int i = startidx; i < endidx; i++) {
+        (*roots)[i] = findRoot(i);
+    }
+}
@@ -0,0 +1,70 @@
+/*
+Copyright (c) 2016 Ryan L. Guy
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgement in the product documentation would be
+   appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef UNIONFIND_H
+#define UNIONFIND_H
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <assert.h>
+
+#include "threadutils.h"
+
+/*
+    Disjoint set forest over the elements [0, size). unionElements and 
+    findRoot are lock free and may be called concurrently from any number 
+    of threads. Roots are always linked under the smaller root, so the 
+    root of a set is its smallest element and labelling does not depend on 
+    the order in which unions were made.
+*/
+class UnionFind
+{
+public:
+    UnionFind();
+    UnionFind(int size);
+    ~UnionFind();
+
+    void reset(int size);
+    int size();
+    int findRoot(int idx);
+    void unionElements(int idx1, int idx2);
+    bool isConnected(int idx1, int idx2);
+
+    /*
+        Labels every element with the index of its component and returns 
+        the number of components. Components are numbered in order of their
+        smallest element.
+    */
+    int getComponentLabels(std::vector<int> &labels);
+
+    /*
+        Lists the elements of each component in ascending order. Components 
+        are ordered by their smallest element.
+    */
+    void getComponents(std::vector<std::vector<int> > &components);
+
+private:
+    void _findRootsThread(int startidx, int endidx, std::vector<int> *roots);
+
+    std::vector<std::atomic<int> > _parents;
+    int _minElementsPerThread = 50000;
+};
+
+#endif